@@ -0,0 +1,95 @@
+/**
+ *
+ * rs485 bus module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * multi drop bus, every clock has its address, commands are lines
+ * "@aa<command>" (aa .. hex address, FF .. broadcast), unit answers only
+ * commands addressed to it
+ *
+ * answers to broadcast commands are sent in time slots of units, all
+ * clocks are synchronized by dcf77 so the slots derived from the second
+ * don't collide, slot n starts at (n%16)/16 s of the (n/16+1)-th second
+ * after the command, unit without good time doesn't answer broadcasts
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "rtc.h"
+#include "uart.h"
+#include "event.h"
+#include "bus.h" // self
+
+// reply slots, reply (status line) starts guard after slot start, a unit early or late
+// by the time error bound stays inside its slot: guard >= error bound and guard + reply
+// + driver turn around + error bound <= slot
+#define BUS_SLOT_TICKS (RTC_SAMPLING_FREQV/16) // 62.5ms
+#define BUS_SLOTS_PER_SECOND (RTC_SAMPLING_FREQV/BUS_SLOT_TICKS)
+#define BUS_SLOT_MS (1000/BUS_SLOTS_PER_SECOND)
+#define BUS_REPLY_MS 16 // 15 chars at 9600Bd
+#define BUS_TURN_MS 1 // driver released in the tick after the last char
+#define BUS_MAX_ERR_MS ((BUS_SLOT_MS-BUS_REPLY_MS-BUS_TURN_MS)/2) // time error bound needed for slot reply (22ms)
+#define BUS_GUARD_TICKS ((BUS_MAX_ERR_MS*RTC_SAMPLING_FREQV+999)/1000) // 12 ticks (23.4ms)
+#if ((BUS_GUARD_TICKS*1000L/RTC_SAMPLING_FREQV)+BUS_REPLY_MS+BUS_TURN_MS+BUS_MAX_ERR_MS)>(BUS_SLOT_TICKS*1000L/RTC_SAMPLING_FREQV)
+#error "bus reply doesn't fit the slot"
+#endif
+
+uint8_t bus_address = BUS_ADDRESS_DEFAULT;
+
+// get unit address
+uint8_t bus_get_address(void)
+{
+    return bus_address;
+}
+
+// set unit address
+void bus_set_address(uint8_t a)
+{
+    if (a!=BUS_BROADCAST) bus_address = a;
+}
+
+// bus line filter, returns command (line without address) or 0 if it's for another unit
+char *bus_filter(char *line, int *len, bool *broadcast)
+{
+    int8_t h, l;
+    if ((*len<3)||(line[0]!='@')) return 0;
+    h = c2h(line[1]);
+    l = c2h(line[2]);
+    if ((h<0)||(l<0)) return 0;
+    uint8_t a = (h<<4)|l;
+    *broadcast = (a==BUS_BROADCAST);
+    if ((a!=bus_address)&&(!*broadcast)) return 0;
+    *len -= 3;
+    return &line[3];
+}
+
+// schedule reply into unit slot (EVENT_BUS)
+bool bus_reply_slot(void)
+{
+    uint16_t err;
+    if ((rtc_get_quality(&err)==RTC_QUALITY_UNSYNC)||(err>BUS_MAX_ERR_MS)) return false;
+    uint16_t delay = RTC_SAMPLING_FREQV-rtc_get_subsecond(); // to the next second
+    delay += (bus_address/BUS_SLOTS_PER_SECOND)*RTC_SAMPLING_FREQV;
+    delay += (bus_address%BUS_SLOTS_PER_SECOND)*BUS_SLOT_TICKS+BUS_GUARD_TICKS;
+    event_post_delayed(EVENT_BUS,delay);
+    return true;
+}
+
+// status line "aa hh:mm:ss q" (q .. time quality 0 unsync., 1 hold, 2 synchronized)
+int bus_status(char *s, int len)
+{
+    tstruct t;
+    uint16_t err;
+    if (len<16) return -1;
+    rtc_get_time(&t);
+    s[0] = h2c(bus_address>>4); s[1] = h2c(bus_address); s[2] = ' ';
+    s[3] = h2c(t.hour/10); s[4] = h2c(t.hour%10); s[5] = ':';
+    s[6] = h2c(t.minute/10); s[7] = h2c(t.minute%10); s[8] = ':';
+    s[9] = h2c(t.second/10); s[10] = h2c(t.second%10); s[11] = ' ';
+    s[12] = h2c(rtc_get_quality(&err));
+    s[13] = '\r'; s[14] = '\n'; s[15] = '\0';
+    return 0;
+}
@@ -0,0 +1,23 @@
+/**
+ *
+ * rs485 bus module header
+ *
+ **/
+
+#ifndef __BUS_H__
+#define __BUS_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// addresses (0x00..0xFE unit address, 0xFF broadcast)
+#define BUS_BROADCAST 0xFF
+#define BUS_ADDRESS_DEFAULT 0x01
+
+uint8_t bus_get_address(void); // unit address
+void bus_set_address(uint8_t a); // set unit address (broadcast address ignored)
+char *bus_filter(char *line, int *len, bool *broadcast); // command addressed to unit (0 .. not for us)
+bool bus_reply_slot(void); // schedule broadcast reply into unit time slot (EVENT_BUS), false if time not good enough
+int bus_status(char *s, int len); // status line (address, time, quality)
+
+#endif
@@ -5,62 +5,146 @@
  * author: ondrejh DOT ck AT gmail DOT com
  * date: 5.10.2012
  *
- * leave sleep mode when any of 3 buttons pressed
- * last pressed buttons buffered (access by get_button function)
+ * the first press edge of any of 3 buttons starts debouncing (port interrupt
+ * disabled then, so contact bounces don't wake the cpu), buttons are sampled
+ * in rtc timer isr and press, release, long press and auto repeat events are
+ * queued for the main loop (EVENT_BUTTON), when all buttons are released port
+ * interrupt is enabled again
  *
  **/
 
 /// include section
 #include <msp430g2553.h>
+#include <stdbool.h>
 #include "button.h" // self
+#include "rtc.h"
+#include "duty.h"
+#include "event.h"
 
 // buttons connected (port1)
 #define BTN1 BIT3
 #define BTN2 BIT4
 #define BTN3 BIT7
+#define BTN_ALL (BTN1|BTN2|BTN3)
 
-// last pressed button buffer
-uint8_t btn = 0;
+// timing (samples)
+#define BUTTON_SAMPLE_TICKS (RTC_SAMPLING_FREQV/64) // sampling period (~16ms)
+#define BUTTON_DEBOUNCE_SAMPLES 2 // equal samples to accept change
+#define BUTTON_LONG_SAMPLES 64 // long press (1s)
+#define BUTTON_REPEAT_SAMPLES 13 // auto repeat period (200ms)
 
-// get last pressed button
-uint8_t get_button(void)
+// event queue length (power of 2)
+#define BUTTON_QUEUE_LEN 4
+#define BUTTON_QUEUE_MASK (BUTTON_QUEUE_LEN-1)
+
+// debouncing state (isr)
+volatile bool btn_active = false; // sampling (port interrupt disabled)
+uint8_t btn_ticks = 0; // ticks to next sample
+uint8_t btn_last = 0; // last sample
+uint8_t btn_stable = 0; // equal samples counter
+uint8_t btn_state = 0; // debounced buttons state
+uint8_t btn_hold = 0; // samples since the last state change (saturated)
+
+// event queue (written by isr only: head, read by main only: tail)
+uint8_t btn_queue[BUTTON_QUEUE_LEN];
+volatile uint8_t btn_queue_head = 0, btn_queue_tail = 0;
+
+/** local functions section **/
+
+// queue events of all buttons in mask (dropped if queue full)
+void button_queue(uint8_t mask, button_event_type type)
 {
-    if (btn)
+    const uint8_t pins[3] = {BTN1,BTN2,BTN3};
+    uint8_t i;
+    for (i=0;i<3;i++)
     {
-        if (btn&BTN1)
-        {
-            btn=0;
-            return 1;
-        }
-        if (btn&BTN2)
-        {
-            btn=0;
-            return 2;
-        }
-        if (btn&BTN3)
+        if ((mask&pins[i])==0) continue;
+        uint8_t next = (btn_queue_head+1)&BUTTON_QUEUE_MASK;
+        if (next==btn_queue_tail) return;
+        btn_queue[btn_queue_head] = BUTTON_EVENT(i+1,type);
+        btn_queue_head = next;
+        event_post(EVENT_BUTTON);
+    }
+}
+
+/** global functions section **/
+
+// get next button event (0 .. no event)
+uint8_t button_get_event(void)
+{
+    if (btn_queue_tail==btn_queue_head) return 0;
+    uint8_t e = btn_queue[btn_queue_tail];
+    btn_queue_tail = (btn_queue_tail+1)&BUTTON_QUEUE_MASK;
+    return e;
+}
+
+// debouncing (rtc timer isr, every tick)
+void button_tick(void)
+{
+    if (!btn_active) return;
+    if (++btn_ticks<BUTTON_SAMPLE_TICKS) return;
+    btn_ticks = 0;
+
+    uint8_t s = ~P1IN&BTN_ALL;
+    if (s!=btn_last)
+    {
+        btn_last = s;
+        btn_stable = 0;
+        return;
+    }
+    if (btn_stable<BUTTON_DEBOUNCE_SAMPLES) btn_stable++;
+    if (btn_stable<BUTTON_DEBOUNCE_SAMPLES) return;
+
+    // debounced state change
+    if (s!=btn_state)
+    {
+        button_queue(s&~btn_state,BUTTON_PRESS);
+        button_queue(btn_state&~s,BUTTON_RELEASE);
+        btn_state = s;
+        btn_hold = 0;
+    }
+    else if (s)
+    {
+        // long press and auto repeat
+        if (btn_hold<255) btn_hold++;
+        if (btn_hold==BUTTON_LONG_SAMPLES) button_queue(s,BUTTON_LONG);
+        else if (btn_hold==(BUTTON_LONG_SAMPLES+BUTTON_REPEAT_SAMPLES))
         {
-            btn=0;
-            return 3;
+            button_queue(s,BUTTON_REPEAT);
+            btn_hold = BUTTON_LONG_SAMPLES;
         }
     }
-    return 0;
+
+    // all released .. wait for the next press edge
+    if (btn_state==0)
+    {
+        btn_active = false;
+        P1IFG &= ~BTN_ALL;
+        P1IE |= BTN_ALL;
+    }
 }
 
 // initialize buttons
 void buttons_init(void)
 {
-    P1DIR &= ~(BTN1 | BTN2 | BTN3); // inputs
-    P1REN |= (BTN1 | BTN2 | BTN3); // pullups
-    P1IES |= (BTN1 | BTN2 | BTN3); // hi/lo edge
-    P1IE |= (BTN1 | BTN2 | BTN3); // interrupt enable
-    P1IFG &= ~(BTN1 | BTN2 | BTN3); // clear interrupt flags
+    P1DIR &= ~BTN_ALL; // inputs
+    P1OUT |= BTN_ALL; // pullups
+    P1REN |= BTN_ALL;
+    P1IES |= BTN_ALL; // hi/lo edge
+    P1IFG &= ~BTN_ALL; // clear interrupt flags
+    P1IE |= BTN_ALL; // interrupt enable
 }
 
-// Port 1 interrupt service routine
+// Port 1 interrupt service routine (press edge, start debouncing)
 #pragma vector=PORT1_VECTOR
 __interrupt void Port_1(void)
 {
-    btn = ~P1IN & (BTN1 | BTN2 | BTN3);
-    P1IFG &= ~(BTN1 | BTN2 | BTN3); // clear IFG
-    __bic_SR_register_on_exit(CPUOFF); // Clear CPUOFF bit from 0(SR)
+    DUTY_BEGIN(duty);
+    P1IE &= ~BTN_ALL; // no more interrupts (bounces) until released
+    P1IFG &= ~BTN_ALL; // clear IFG
+    btn_ticks = 0;
+    btn_last = ~P1IN&BTN_ALL;
+    btn_stable = 0;
+    btn_active = true;
+    DUTY_END(DUTY_BUTTON,duty);
 }
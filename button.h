@@ -9,7 +9,14 @@
 
 #include <inttypes.h>
 
-uint8_t get_button(void);
+// button events (button number 1..3 in high nibble, event type in low nibble)
+typedef enum {BUTTON_PRESS=1,BUTTON_RELEASE,BUTTON_LONG,BUTTON_REPEAT} button_event_type;
+#define BUTTON_EVENT(b,t) (((b)<<4)|(t))
+#define BUTTON_NUM(e) ((e)>>4)
+#define BUTTON_TYPE(e) ((e)&0x0F)
+
+uint8_t button_get_event(void); // next button event (0 .. none), main loop
+void button_tick(void); // debouncing (rtc timer isr)
 void buttons_init(void);
 
 #endif
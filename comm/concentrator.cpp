@@ -0,0 +1,467 @@
+/**
+ *
+ * clocks concentrator
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * reads many clocks at once: serial ports or ptys served by one epoll loop,
+ * received lines go to a pool of parser threads (lines of one port always
+ * to the same thread, so they are parsed in order), parsers keep a table of
+ * units (last time, offset against host clock, time quality, signal quality)
+ *
+ * a line is stamped when its terminator arrives: a read is stamped when it
+ * returns and every char after the terminator takes one char time off, the
+ * unit second start is then the stamp minus the line on the wire; stamps are
+ * late, never early (driver, scheduling), so the offset is the largest one of
+ * OFFSET_WINDOW lines in a row
+ *
+ * understands:
+ *   time line       "Po 12:34:56 S"   (point to point, every second)
+ *   bus status      "05 12:34:56 2"   (UART_BUS build, answer to "@FFT" broadcast)
+ *   link timecode   "#1234560226"     (time link master)
+ *   minute summary  "M 5A 3C 00 01"   (first line of "Q" report, signal quality mean and min %)
+ *
+ * snapshot of the table (csv) is written every few seconds and at exit
+ *
+ * usage: concentrator [-b] [-q period] [-w workers] [-o file] [-e period] [-t seconds] [-l list] [port ...]
+ *   -b .. RS485 bus, units polled by "@FFT" broadcast every 10 s
+ *   -q .. point to point units asked for reception statistics every period s (default 60, 0 .. never)
+ *   -w .. parser threads (default 4)
+ *   -o .. snapshot file (default clocks.csv)
+ *   -e .. snapshot period (s, default 5)
+ *   -t .. run time (s, default until SIGINT or SIGTERM)
+ *   -l .. file with port names (one per line), more than the command line takes
+ *
+ **/
+
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <csignal>
+#include <ctime>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/epoll.h>
+
+#define PORT_SPEED B9600
+#define CHAR_TIME (10.0/9600) // one char on the wire (s)
+#define LINE_MAX 32 // longer lines are dropped
+#define BUS_POLL_PERIOD 10.0 // bus broadcast poll period (s)
+#define BUS_SLOT (1.0/16) // bus reply slot (bus.c BUS_SLOT_MS)
+#define BUS_GUARD (12.0/512) // bus reply start in slot (bus.c BUS_GUARD_TICKS)
+#define OFFSET_WINDOW 8 // lines per offset estimate
+
+// one clock (point to point unit or bus unit), compact row of the table
+struct unit_type {
+    uint16_t port;
+    int16_t addr; // bus address (-1 .. point to point)
+    bool master; // time link master (timecode instead of time line)
+    uint8_t quality; // 0 unsync., 1 hold, 2 synchronized (0xFF .. none yet)
+    uint8_t mean_q, min_q; // last minute signal quality (%, 0xFF .. none yet)
+    uint32_t time; // last time (s of day)
+    int32_t offset_us; // unit time minus host time
+    int32_t window_us; // the largest offset of lines in current window
+    uint8_t window; // lines in current window
+    uint32_t lines, errors; // parsed and not understood lines
+    double seen; // host time of the last line
+};
+
+// received line (stamp .. host time of its terminator)
+struct line_type {
+    uint16_t port;
+    uint8_t len;
+    char s[LINE_MAX+1];
+    double stamp;
+};
+
+// port (endpoint) and its line being received
+struct port_type {
+    std::string name;
+    int fd;
+    char buf[LINE_MAX+1];
+    int len; // -1 .. line too long, dropped until its end
+};
+
+// units table, rows owned by the parser of their port, the lock keeps snapshots consistent
+struct table_type {
+    std::mutex lock;
+    std::vector<unit_type> units;
+    std::map<uint32_t,size_t> index; // port<<16 | address -> row
+};
+
+// parser thread queue
+struct worker_type {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<line_type> lines;
+    bool quit = false;
+    std::thread thread;
+};
+
+const char *quality_name[] = {"unsync","hold","synced"};
+
+std::vector<port_type> ports;
+table_type table;
+volatile sig_atomic_t stop = 0;
+
+// host time (s)
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME,&ts);
+    return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+void on_signal(int sig)
+{
+    stop = 1;
+}
+
+// table row of unit (created when seen first), table locked
+unit_type &unit_of(int port, int addr)
+{
+    uint32_t key = ((uint32_t)port<<16)|(uint16_t)addr;
+    auto it = table.index.find(key);
+    if (it!=table.index.end()) return table.units[it->second];
+    unit_type u;
+    memset(&u,0,sizeof(u));
+    u.port = port;
+    u.addr = addr;
+    u.quality = u.mean_q = u.min_q = 0xFF;
+    table.index[key] = table.units.size();
+    table.units.push_back(u);
+    return table.units.back();
+}
+
+// unit second start minus host time (wrapped into +-12h, dcf77 gives local time)
+double time_offset(uint32_t time, double start)
+{
+    time_t sec = (time_t)floor(start);
+    struct tm t;
+    localtime_r(&sec,&t);
+    double host = t.tm_hour*3600+t.tm_min*60+t.tm_sec+(start-sec);
+    double diff = time-host;
+    if (diff>43200) diff -= 86400;
+    if (diff<-43200) diff += 86400;
+    return diff;
+}
+
+// "hh:mm:ss" -> s of day (-1 .. not a time)
+int32_t parse_hms(const char *s)
+{
+    int i;
+    for (i=0;i<8;i++) if ((i%3==2)?(s[i]!=':'):((s[i]<'0')||(s[i]>'9'))) return -1;
+    int h = (s[0]-'0')*10+s[1]-'0', m = (s[3]-'0')*10+s[4]-'0', sec = (s[6]-'0')*10+s[7]-'0';
+    if ((h>23)||(m>59)||(sec>59)) return -1;
+    return h*3600+m*60+sec;
+}
+
+int hex(char c)
+{
+    if ((c>='0')&&(c<='9')) return c-'0';
+    if ((c>='A')&&(c<='F')) return c-'A'+10;
+    return -1;
+}
+
+// time of unit (second start at start)
+void update_time(int port, int addr, bool master, int32_t time, int quality, double start, double stamp)
+{
+    std::lock_guard<std::mutex> l(table.lock);
+    unit_type &u = unit_of(port,addr);
+    u.master = master;
+    u.time = time;
+    int32_t offset = (int32_t)lround(time_offset(time,start)*1e6);
+    if ((u.window==0)||(offset>u.window_us)) u.window_us = offset;
+    if (u.lines==0) u.offset_us = offset; // the first estimate at once
+    if (++u.window>=OFFSET_WINDOW)
+    {
+        u.offset_us = u.window_us;
+        u.window = 0;
+    }
+    u.quality = quality;
+    u.lines++;
+    u.seen = stamp;
+}
+
+// parse one line (parser thread)
+void parse_line(const line_type &ln)
+{
+    const char *s = ln.s;
+    int len = ln.len;
+    // the first char started the line on the wire (terminator is the char after the line)
+    double start = ln.stamp-(len+1)*CHAR_TIME;
+    int32_t time;
+
+    // link timecode (checksum xor of the chars before)
+    if ((len==11)&&(s[0]=='#'))
+    {
+        int i, x = 0;
+        for (i=0;i<9;i++) x ^= s[i];
+        int hi = hex(s[9]), lo = hex(s[10]);
+        bool ok = (hi>=0)&&(lo>=0)&&(((hi<<4)|lo)==x);
+        for (i=1;i<9;i++) if ((s[i]<'0')||(s[i]>'9')) ok = false;
+        if (ok&&(s[8]<='2'))
+        {
+            int h = (s[1]-'0')*10+s[2]-'0', m = (s[3]-'0')*10+s[4]-'0', sec = (s[5]-'0')*10+s[6]-'0';
+            if ((h<=23)&&(m<=59)&&(sec<=59))
+            {
+                update_time(ln.port,-1,true,h*3600+m*60+sec,s[8]-'0',start,ln.stamp);
+                return;
+            }
+        }
+    }
+    // time line
+    if ((len==13)&&(s[2]==' ')&&(s[11]==' ')&&((time=parse_hms(&s[3]))>=0)&&(strchr("?HS",s[12])!=0))
+    {
+        update_time(ln.port,-1,false,time,strchr("?HS",s[12])-"?HS",start,ln.stamp);
+        return;
+    }
+    // bus status (reply starts guard after slot start, the slot is address%16 of the second)
+    if ((len==13)&&(s[2]==' ')&&(s[11]==' ')&&(hex(s[0])>=0)&&(hex(s[1])>=0)&&((time=parse_hms(&s[3]))>=0)&&(s[12]>='0')&&(s[12]<='2'))
+    {
+        int addr = (hex(s[0])<<4)|hex(s[1]);
+        update_time(ln.port,addr,false,time,s[12]-'0',start-(addr%16)*BUS_SLOT-BUS_GUARD,ln.stamp);
+        return;
+    }
+    // minute summary "M qq mm nn ss"
+    if ((len==13)&&(s[0]=='M'))
+    {
+        int q = (hex(s[2])<<4)|hex(s[3]), m = (hex(s[5])<<4)|hex(s[6]);
+        if ((q>=0)&&(m>=0))
+        {
+            std::lock_guard<std::mutex> l(table.lock);
+            unit_type &u = unit_of(ln.port,-1);
+            u.mean_q = q;
+            u.min_q = m;
+            u.seen = ln.stamp;
+            return;
+        }
+    }
+    // rest of reception statistics report
+    if ((len>=7)&&(strchr("DHTNSC",s[0])!=0)&&((s[1]==' ')||(hex(s[1])>=0))) return;
+
+    std::lock_guard<std::mutex> l(table.lock);
+    unit_type &u = unit_of(ln.port,-1);
+    u.errors++;
+    u.seen = ln.stamp;
+}
+
+void worker(worker_type *w)
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> l(w->lock);
+        w->ready.wait(l,[w]{return w->quit||!w->lines.empty();});
+        if (w->lines.empty()) break;
+        line_type ln = w->lines.front();
+        w->lines.pop_front();
+        l.unlock();
+        parse_line(ln);
+    }
+}
+
+// write table snapshot (replaced at once, readers never see half written file)
+void snapshot(const char *filename)
+{
+    std::string tmp = std::string(filename)+".tmp";
+    FILE *f = fopen(tmp.c_str(),"w");
+    if (f==0) return;
+    fprintf(f,"unit,kind,time,offset,quality,mean_q,min_q,lines,errors,seen\n");
+    {
+        std::lock_guard<std::mutex> l(table.lock);
+        std::vector<unit_type> units = table.units;
+        std::sort(units.begin(),units.end(),[](const unit_type &a, const unit_type &b)
+            {return (a.port!=b.port)?(a.port<b.port):(a.addr<b.addr);});
+        for (const unit_type &u : units)
+        {
+            fprintf(f,"%s",ports[u.port].name.c_str());
+            if (u.addr>=0) fprintf(f,"@%02X",u.addr);
+            fprintf(f,",%s,",(u.addr>=0)?"bus":(u.master?"master":"line"));
+            if (u.lines>0) fprintf(f,"%02u:%02u:%02u,%.6f,%s",u.time/3600,u.time/60%60,u.time%60,u.offset_us*1e-6,quality_name[u.quality]);
+            else fprintf(f,",,");
+            if (u.mean_q!=0xFF) fprintf(f,",%u,%u",u.mean_q,u.min_q);
+            else fprintf(f,",,");
+            fprintf(f,",%u,%u,%.3f\n",u.lines,u.errors,u.seen);
+        }
+    }
+    fclose(f);
+    rename(tmp.c_str(),filename);
+}
+
+// open serial port or pty (raw, 9600Bd)
+int port_open(const char *name)
+{
+    int fd = open(name,O_RDWR|O_NOCTTY|O_NONBLOCK);
+    if (fd<0) return -1;
+    struct termios t;
+    if (tcgetattr(fd,&t)==0)
+    {
+        cfmakeraw(&t);
+        cfsetispeed(&t,PORT_SPEED);
+        cfsetospeed(&t,PORT_SPEED);
+        t.c_cflag |= CLOCAL|CREAD;
+        tcsetattr(fd,TCSANOW,&t);
+    }
+    return fd;
+}
+
+// send command to every open port
+void send_all(const char *cmd)
+{
+    for (port_type &p : ports) if (p.fd>=0) (void)!write(p.fd,cmd,strlen(cmd));
+}
+
+int main(int argc, char **argv)
+{
+    bool bus = false;
+    double poll_q = 60.0, snapshot_period = 5.0, run_time = -1.0;
+    int nworkers = 4, opt;
+    const char *filename = "clocks.csv", *list = 0;
+    while ((opt=getopt(argc,argv,"bq:w:o:e:t:l:"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'b': bus = true; break;
+            case 'q': poll_q = atof(optarg); break;
+            case 'w': nworkers = atoi(optarg); break;
+            case 'o': filename = optarg; break;
+            case 'e': snapshot_period = atof(optarg); break;
+            case 't': run_time = atof(optarg); break;
+            case 'l': list = optarg; break;
+            default:
+                fprintf(stderr,"usage: concentrator [-b] [-q period] [-w workers] [-o file] [-e period] [-t seconds] [-l list] [port ...]\n");
+                return 2;
+        }
+    }
+    std::vector<std::string> names(argv+optind,argv+argc);
+    if (list!=0)
+    {
+        FILE *f = fopen(list,"r");
+        char name[256];
+        if (f==0) {perror(list);return 2;}
+        while (fscanf(f,"%255s",name)==1) names.push_back(name);
+        fclose(f);
+    }
+    if (names.empty()||(nworkers<1))
+    {
+        fprintf(stderr,"usage: concentrator [-b] [-q period] [-w workers] [-o file] [-e period] [-t seconds] [-l list] [port ...]\n");
+        return 2;
+    }
+    if (bus) poll_q = 0.0; // bus reports aren't addressed, they can't be told apart
+
+    int ep = epoll_create1(0);
+    for (const std::string &name : names)
+    {
+        port_type p;
+        p.name = name;
+        p.len = 0;
+        p.fd = port_open(name.c_str());
+        if (p.fd<0) {perror(name.c_str());return 1;}
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = ports.size();
+        epoll_ctl(ep,EPOLL_CTL_ADD,p.fd,&ev);
+        ports.push_back(p);
+    }
+
+    std::vector<worker_type> workers(nworkers);
+    for (worker_type &w : workers) w.thread = std::thread(worker,&w);
+
+    signal(SIGINT,on_signal);
+    signal(SIGTERM,on_signal);
+    double t = now(), end = (run_time>=0)?t+run_time:INFINITY;
+    double next_bus = t, next_q = t+1.0, next_snapshot = t+snapshot_period;
+    struct epoll_event events[64];
+    while ((!stop)&&(t<end))
+    {
+        double next = std::min(end,next_snapshot);
+        if (bus) next = std::min(next,next_bus);
+        if (poll_q>0) next = std::min(next,next_q);
+        int n = epoll_wait(ep,events,64,(int)std::max(0.0,ceil((next-t)*1000)));
+        int i;
+        for (i=0;i<n;i++)
+        {
+            port_type &p = ports[events[i].data.u32];
+            char buf[256];
+            int len = read(p.fd,buf,sizeof(buf)), j;
+            double stamp = now();
+            if ((len<=0)&&((len==0)||(errno!=EAGAIN)))
+            {
+                // other side closed
+                epoll_ctl(ep,EPOLL_CTL_DEL,p.fd,0);
+                close(p.fd);
+                p.fd = -1;
+                continue;
+            }
+            for (j=0;j<len;j++)
+            {
+                char c = buf[j];
+                if ((c!='\r')&&(c!='\n'))
+                {
+                    if (p.len<0) continue;
+                    if (p.len>=LINE_MAX) p.len = -1;
+                    else p.buf[p.len++] = c;
+                    continue;
+                }
+                // terminator arrived chars after it ago
+                if (p.len>0)
+                {
+                    line_type ln;
+                    ln.port = events[i].data.u32;
+                    ln.len = p.len;
+                    memcpy(ln.s,p.buf,p.len);
+                    ln.s[p.len] = '\0';
+                    ln.stamp = stamp-(len-1-j)*CHAR_TIME;
+                    worker_type &w = workers[ln.port%nworkers];
+                    {
+                        std::lock_guard<std::mutex> l(w.lock);
+                        w.lines.push_back(ln);
+                    }
+                    w.ready.notify_one();
+                }
+                p.len = 0;
+            }
+        }
+        t = now();
+        if (bus&&(t>=next_bus))
+        {
+            send_all("@FFT\r");
+            next_bus = t+BUS_POLL_PERIOD;
+        }
+        if ((poll_q>0)&&(t>=next_q))
+        {
+            send_all("Q\r");
+            next_q = t+poll_q;
+        }
+        if (t>=next_snapshot)
+        {
+            snapshot(filename);
+            next_snapshot = t+snapshot_period;
+        }
+    }
+
+    for (worker_type &w : workers)
+    {
+        {
+            std::lock_guard<std::mutex> l(w.lock);
+            w.quit = true;
+        }
+        w.ready.notify_one();
+        w.thread.join();
+    }
+    for (port_type &p : ports) if (p.fd>=0) close(p.fd);
+    snapshot(filename);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/**
+ *
+ * fake clocks (concentrator test)
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * every clock is a pty (slave names go to the list file) with its own offset
+ * against the host clock, time quality and signal quality, it sends what the
+ * firmware does: time line at its second start ("Po 12:34:56 S"), or link
+ * timecode ("#1234560226", every 8th clock is a time link master, skipped when
+ * its uart is busy), "Q" is answered by the reception statistics report right
+ * after the next time line, back to back
+ *
+ * chars go out at 9600Bd as from a uart into a receive fifo: in chunks of up
+ * to fifo chars, each one written when its last char is due (reads return line
+ * ends together with the next line starts)
+ *
+ * with -c the concentrator snapshot is checked at the end: every clock is in,
+ * kind, time quality and signal quality match, offset within tolerance,
+ * returns 1 when not
+ *
+ * usage: fakeclocks [-n clocks] [-t seconds] [-l list] [-f fifo] [-c snapshot] [-a tolerance] [-s seed]
+ *   -n .. number of clocks (default 100)
+ *   -t .. run time (s, default 20)
+ *   -l .. pty names file (default fakeclocks.txt, written when all of them are open)
+ *   -f .. receive fifo (chars, default 16)
+ *   -c .. concentrator snapshot to check at the end
+ *   -a .. offset tolerance (ms, default 1)
+ *   -s .. random seed (default 1)
+ *
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+
+#define CHAR_TIME (10.0/9600) // one char on the wire (s)
+#define MASTER_EVERY 8 // every 8th clock is time link master
+
+// one fake clock
+struct clock_type {
+    int fd, slave_fd; // pty master (clock side) and slave (kept open, raw)
+    std::string name;
+    double offset; // clock time minus host time (s)
+    int quality; // 0 unsync., 1 hold, 2 synchronized
+    bool master; // time link master
+    int mean_q, min_q; // last minute signal quality (%)
+    bool report; // "Q" received, report goes after the next time line
+    std::string out; // chars on the wire, out[0] starts at out_start
+    double out_start;
+    size_t sent; // chars written to pty
+    std::string in; // command line being received
+    double next_second; // host time of the next clock second start
+    long lines, lost; // lines sent, chars lost (pty full)
+};
+
+std::vector<clock_type> clocks;
+uint32_t seed = 1;
+
+// host time (s)
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME,&ts);
+    return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+// xorshift32, uniform 0..1
+double uniform(void)
+{
+    seed ^= seed<<13;
+    seed ^= seed>>17;
+    seed ^= seed<<5;
+    return (double)seed/4294967296.0;
+}
+
+char h2c(unsigned int h)
+{
+    return "0123456789ABCDEF"[h&0xF];
+}
+
+// host time of char end (k .. index in out)
+double char_due(const clock_type &c, size_t k)
+{
+    return c.out_start+(k+1)*CHAR_TIME;
+}
+
+// host time when the wire is free (all chars out)
+double wire_free(const clock_type &c)
+{
+    return c.out_start+c.out.size()*CHAR_TIME;
+}
+
+// put line on the wire (after the chars being sent, or at t when idle)
+void send_line(clock_type &c, const std::string &line, double t)
+{
+    if (wire_free(c)<=t)
+    {
+        c.out.clear();
+        c.sent = 0;
+        c.out_start = t;
+    }
+    else if (c.sent>0)
+    {
+        // drop what's out already
+        c.out.erase(0,c.sent);
+        c.out_start += c.sent*CHAR_TIME;
+        c.sent = 0;
+    }
+    c.out += line+"\r\n";
+    c.lines++;
+}
+
+// reception statistics report (minute summary, decoding results, hours, threshold)
+void send_report(clock_type &c, double t)
+{
+    char s[16];
+    int i;
+    snprintf(s,sizeof(s),"M %02X %02X 00 01",c.mean_q,c.min_q);
+    send_line(c,s,t);
+    for (i=0;i<6;i++) {snprintf(s,sizeof(s),"D%d %04X",i,i?i:40);send_line(c,s,t);}
+    for (i=0;i<24;i++) {snprintf(s,sizeof(s),"H%02d %04X",i,0);send_line(c,s,t);}
+    send_line(c,"T 01C0 0040",t);
+    send_line(c,"N 0080 0020",t);
+    send_line(c,"S 01F0 0008",t);
+}
+
+// second start of clock (host time t, clock time whole second)
+void second(clock_type &c, double t)
+{
+    time_t sec = (time_t)llround(t+c.offset);
+    struct tm tm;
+    char s[16];
+    localtime_r(&sec,&tm);
+    int dayow = (tm.tm_wday+6)%7; // monday first
+    if (c.master)
+    {
+        // timecode only when uart is idle (the latency would be different)
+        if (wire_free(c)>t) return;
+        int x = 0, i;
+        snprintf(s,sizeof(s),"#%02d%02d%02d%d%d",tm.tm_hour,tm.tm_min,tm.tm_sec,dayow,c.quality);
+        for (i=0;i<9;i++) x ^= s[i];
+        s[9] = h2c(x>>4);
+        s[10] = h2c(x);
+        s[11] = '\0';
+    }
+    else snprintf(s,sizeof(s),"%.2s %02d:%02d:%02d %c","PoUtStCtPaSoNe"+2*dayow,tm.tm_hour,tm.tm_min,tm.tm_sec,"?HS"[c.quality]);
+    send_line(c,s,t);
+    if (c.report) send_report(c,t);
+    c.report = false;
+}
+
+// next chunk write time (the last char of the chunk is due)
+double chunk_due(const clock_type &c, size_t fifo)
+{
+    if (c.sent>=c.out.size()) return INFINITY;
+    return char_due(c,std::min(c.sent+fifo,c.out.size())-1);
+}
+
+// compare concentrator snapshot with clocks, returns failures
+int check(const char *filename, double tolerance)
+{
+    FILE *f = fopen(filename,"r");
+    char row[256];
+    int failed = 0;
+    double sum = 0.0, max = 0.0;
+    long checked = 0;
+    std::vector<bool> found(clocks.size(),false);
+    if (f==0) {perror(filename);return 1;}
+    while (fgets(row,sizeof(row),f)!=0)
+    {
+        char unit[128], kind[16], time[16], quality[16];
+        double offset;
+        int mean_q, min_q;
+        long lines, errors;
+        size_t i;
+        if (sscanf(row,"%127[^,],%15[^,],%15[^,],%lf,%15[^,],%d,%d,%ld,%ld",unit,kind,time,&offset,quality,&mean_q,&min_q,&lines,&errors)!=9) continue;
+        for (i=0;i<clocks.size();i++) if (clocks[i].name==unit) break;
+        if (i>=clocks.size()) continue;
+        clock_type &c = clocks[i];
+        const char *qname[] = {"unsync","hold","synced"};
+        double err = fabs(offset-c.offset)*1000.0;
+        found[i] = true;
+        checked++;
+        sum += err;
+        if (err>max) max = err;
+        if ((strcmp(kind,c.master?"master":"line")!=0)||(strcmp(quality,qname[c.quality])!=0)||
+            (mean_q!=c.mean_q)||(min_q!=c.min_q)||(errors!=0)||(err>tolerance))
+        {
+            printf("%s: %s %s offset %.3f ms off, quality %d %d, errors %ld (clock %s %s %d %d)\n",unit,kind,quality,
+                err,mean_q,min_q,errors,c.master?"master":"line",qname[c.quality],c.mean_q,c.min_q);
+            failed++;
+        }
+    }
+    fclose(f);
+    size_t i;
+    for (i=0;i<clocks.size();i++) if (!found[i]) {printf("%s: not in snapshot\n",clocks[i].name.c_str());failed++;}
+    printf("clocks %zu in snapshot %ld, offset error mean %.3f ms max %.3f ms, %d failed\n",
+        clocks.size(),checked,checked?sum/checked:0.0,max,failed);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 100, opt;
+    size_t fifo = 16;
+    double run_time = 20.0, tolerance = 1.0;
+    const char *list = "fakeclocks.txt", *snapshot = 0;
+    while ((opt=getopt(argc,argv,"n:t:l:f:c:a:s:"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'n': n = atoi(optarg); break;
+            case 't': run_time = atof(optarg); break;
+            case 'l': list = optarg; break;
+            case 'f': fifo = atoi(optarg); break;
+            case 'c': snapshot = optarg; break;
+            case 'a': tolerance = atof(optarg); break;
+            case 's': seed = strtoul(optarg,0,0); break;
+            default:
+                fprintf(stderr,"usage: fakeclocks [-n clocks] [-t seconds] [-l list] [-f fifo] [-c snapshot] [-a tolerance] [-s seed]\n");
+                return 2;
+        }
+    }
+    if ((n<1)||(fifo<1)||(seed==0))
+    {
+        fprintf(stderr,"usage: fakeclocks [-n clocks] [-t seconds] [-l list] [-f fifo] [-c snapshot] [-a tolerance] [-s seed]\n");
+        return 2;
+    }
+
+    // open ptys (slave raw: no echo, no line end translation)
+    double t = now();
+    clocks.resize(n);
+    std::vector<struct pollfd> fds(n);
+    int i;
+    for (i=0;i<n;i++)
+    {
+        clock_type &c = clocks[i];
+        c.fd = posix_openpt(O_RDWR|O_NOCTTY|O_NONBLOCK);
+        if ((c.fd<0)||(grantpt(c.fd)!=0)||(unlockpt(c.fd)!=0)) {perror("pty");return 1;}
+        c.name = ptsname(c.fd);
+        c.slave_fd = open(c.name.c_str(),O_RDWR|O_NOCTTY);
+        struct termios tio;
+        if ((c.slave_fd<0)||(tcgetattr(c.slave_fd,&tio)!=0)) {perror(c.name.c_str());return 1;}
+        cfmakeraw(&tio);
+        tcsetattr(c.slave_fd,TCSANOW,&tio);
+        c.offset = floor((uniform()*4.0-2.0)*1e6)*1e-6;
+        c.quality = (int)(uniform()*3);
+        c.master = (i%MASTER_EVERY)==MASTER_EVERY-1;
+        c.mean_q = 30+(int)(uniform()*70);
+        c.min_q = (int)(uniform()*c.mean_q);
+        c.report = false;
+        c.out_start = t;
+        c.sent = 0;
+        c.next_second = ceil(t+c.offset)-c.offset;
+        c.lines = c.lost = 0;
+        fds[i].fd = c.fd;
+        fds[i].events = POLLIN;
+    }
+    std::string tmp = std::string(list)+".tmp";
+    FILE *f = fopen(tmp.c_str(),"w");
+    if (f==0) {perror(list);return 1;}
+    for (const clock_type &c : clocks) fprintf(f,"%s\n",c.name.c_str());
+    fclose(f);
+    rename(tmp.c_str(),list);
+
+    double end = t+run_time;
+    while (t<end)
+    {
+        // the nearest second start or chunk
+        double next = end;
+        for (const clock_type &c : clocks) next = std::min(next,std::min(c.next_second,chunk_due(c,fifo)));
+        struct timespec ts;
+        double wait = std::max(0.0,next-now());
+        ts.tv_sec = (time_t)wait;
+        ts.tv_nsec = (long)((wait-ts.tv_sec)*1e9);
+        int ready = ppoll(fds.data(),n,&ts,0);
+        t = now();
+        for (i=0;i<n;i++)
+        {
+            clock_type &c = clocks[i];
+            // commands (only "Q" is served)
+            if ((ready>0)&&(fds[i].revents&POLLIN))
+            {
+                char buf[64];
+                int len = read(c.fd,buf,sizeof(buf)), j;
+                for (j=0;j<len;j++)
+                {
+                    if ((buf[j]=='\r')||(buf[j]=='\n'))
+                    {
+                        if (c.in=="Q") c.report = true;
+                        c.in.clear();
+                    }
+                    else if (c.in.size()<32) c.in += buf[j];
+                }
+            }
+            while (c.next_second<=t)
+            {
+                second(c,c.next_second);
+                c.next_second = llround(c.next_second+c.offset)+1-c.offset;
+            }
+            // chunks due (written late when the loop was late, still together)
+            while (chunk_due(c,fifo)<=t)
+            {
+                size_t len = std::min(c.sent+fifo,c.out.size())-c.sent;
+                int w = write(c.fd,c.out.data()+c.sent,len);
+                if (w<(int)len) c.lost += len-std::max(w,0);
+                c.sent += len;
+            }
+        }
+    }
+
+    long lines = 0, lost = 0;
+    for (const clock_type &c : clocks) {lines += c.lines;lost += c.lost;}
+    printf("clocks %d lines %ld chars lost %ld\n",n,lines,lost);
+    int failed = (snapshot!=0)?check(snapshot,tolerance):0;
+    for (const clock_type &c : clocks) {close(c.fd);close(c.slave_fd);}
+    return failed?1:0;
+}
@@ -14,6 +14,10 @@
  *      input char decoding with fine sync. and hold over
  *      minute block decoding and verifiing
  *
+ * detected symbols are passed from timer isr to main loop through
+ * a small single producer single consumer ring (filled by isr, emptied by main),
+ * minute block decoding and rtc synchronization run in main loop (dcf77_process)
+ *
  **/
 
 /// include section
@@ -21,12 +25,56 @@
 #include <string.h>
 #include "rtc.h"
 #include "dcf77.h" // self
+#include "event.h"
+#include "evlog.h"
+#include "stats.h"
+#include "uart.h" // UART_BUS
 
-// input init (pull up resistor)
-//#define DCF77_INPUT_INIT() {P1DIR&=~BIT7;P1OUT|=BIT7;P1REN|=BIT7;}
-#define DCF77_INPUT_INIT() {P1DIR&=~BIT5;P1OUT|=BIT5;}
-// input reading (result true if input pulled down)
-#define DCF77_INPUT() (((P1IN&BIT5)==0)?true:false)
+// receivers (input port registers and pin with pull up, input true if pulled down)
+// the second receiver (e.g. other antenna orientation) on the only spare pin P1.6, it's
+// the bus driver enable of the UART_BUS build (lcd takes P2.0..5, the crystal P2.6..7),
+// two receivers don't fit the ram of the g2553 (static data and stack 80 bytes over),
+// they run in the host build (test_dual)
+#ifndef DCF77_CHANNELS
+#define DCF77_CHANNELS 1
+#endif
+#if (DCF77_CHANNELS>2)||((DCF77_CHANNELS>1)&&UART_BUS)
+#error "no spare pin for another receiver"
+#endif
+typedef struct {
+    const volatile uint8_t *in;
+    volatile uint8_t *dir, *out;
+    uint8_t bit;
+} dcf77_input_type;
+const dcf77_input_type dcf77_inputs[DCF77_CHANNELS] = {
+    {&P1IN,&P1DIR,&P1OUT,BIT5},
+    #if DCF77_CHANNELS>1
+    {&P1IN,&P1DIR,&P1OUT,BIT6},
+    #endif
+};
+
+// input filter (glitch suppression between sampling and symbol detection)
+//  DCF77_FILTER_NONE .. raw input
+//  DCF77_FILTER_MAJORITY .. k of n majority of last n samples (shift register)
+//  DCF77_FILTER_HYSTERESIS .. up/down counter 0..n, output changes at the limits (Schmitt like)
+//  DCF77_FILTER_GLITCH .. output changes after n equal samples
+// every filter delays rising and falling edge the same, so pulse length is kept
+#define DCF77_FILTER_NONE 0
+#define DCF77_FILTER_MAJORITY 1
+#define DCF77_FILTER_HYSTERESIS 2
+#define DCF77_FILTER_GLITCH 3
+#ifndef DCF77_FILTER
+#define DCF77_FILTER DCF77_FILTER_MAJORITY
+#endif
+#ifndef DCF77_FILTER_N
+#define DCF77_FILTER_N 5 // filter length (samples, max. 8 for majority)
+#endif
+#ifndef DCF77_FILTER_K
+#define DCF77_FILTER_K 3 // majority needed
+#endif
+#if (DCF77_FILTER==DCF77_FILTER_MAJORITY)&&((DCF77_FILTER_N>8)||(DCF77_FILTER_K>DCF77_FILTER_N))
+#error "majority filter needs DCF77_FILTER_K <= DCF77_FILTER_N <= 8"
+#endif
 
 #define DCF77_LED 0
 #if DCF77_LED
@@ -48,30 +96,203 @@
 #define DCF77_DETECT_PERIOD RTC_SAMPLING_FREQV
 #define DCF77_S0_PERIOD (RTC_SAMPLING_FREQV/10)
 #define DCF77_S1_PERIOD (RTC_SAMPLING_FREQV/5)
+// decoder parameters can be overridden for parameter sweeps (make DEFINES="-DDCF77_...=n")
 // fine synchronization offset (in dcf77 timer ticks)
+#ifndef DCF77_FINESYNC_OFFSET
 #define DCF77_FINESYNC_OFFSET 3
+#endif
 // minimul quality of signal (out of 1000)
+#ifndef DCF77_MIN_SIGNAL_QUALITY
 #define DCF77_MIN_SIGNAL_QUALITY (RTC_SAMPLING_FREQV/10*9)
+#endif
+// adaptive signal quality threshold (1 .. on, 0 .. fixed DCF77_MIN_SIGNAL_QUALITY)
+// noise and signal quality distributions are tracked (exponentially weighted mean
+// and mean absolute deviation), threshold is set K deviations above noise mean
+// and kept within limits, K is given by the target rate of accepted noise symbols
+// (normal distribution, deviation is 0.8 sigma: K = 1.25 z), the filtered input
+// without carrier has a longer tail, K of the small rates is a fifth bigger (1.5 z,
+// host/noise -m 30 gives 0.30 % instead of 1.19 % at 1 %, the big rates are below
+// their targets at the threshold low limit)
+#ifndef DCF77_ADAPTIVE_THRESHOLD
+#define DCF77_ADAPTIVE_THRESHOLD 1
+#endif
+#if DCF77_FALSE_ACCEPT>=1000
+#define DCF77_ADAPT_K4 6 // K in quarters (z 1.28)
+#elif DCF77_FALSE_ACCEPT>=500
+#define DCF77_ADAPT_K4 8 // z 1.64
+#elif DCF77_FALSE_ACCEPT>=100
+#define DCF77_ADAPT_K4 15 // z 2.33
+#elif DCF77_FALSE_ACCEPT>=10
+#define DCF77_ADAPT_K4 19 // z 3.09
+#else
+#define DCF77_ADAPT_K4 23 // z 3.72
+#endif
+#define DCF77_ADAPT_SHIFT 4 // averaging (1/16 new value), fixed point of means and deviations
+#define DCF77_ADAPT_MIN (RTC_SAMPLING_FREQV/10*6) // threshold limits
+#define DCF77_ADAPT_MAX (RTC_SAMPLING_FREQV/100*97)
+#define DCF77_ADAPT_NOISE_INIT (RTC_SAMPLING_FREQV/100*55) // initial noise distribution (random input)
+#define DCF77_ADAPT_NOISE_DEV_INIT (RTC_SAMPLING_FREQV/100*10)
 // hold over and fine synchronization timing
-#define DCF77_MAX_HOLD_SYMBOLS 300 // 5minutes
+#define DCF77_MAX_HOLD_SYMBOLS 300 // 5minutes (without pll)
+#ifndef DCF77_FINETUNE_SYMCOUNT
 #define DCF77_FINETUNE_SYMCOUNT 10
+#endif
 #define DCF77_FINETUNE_SHIFT 1
+// fine synchronization by digital pll (1 .. on, 0 .. early/late votes of three detectors)
+// pulse edge phase error is measured every second, proportional-integral filtered
+// correction accumulates in fractional tick (1/65536) accumulator and detectors are
+// shifted by whole ticks, integrator holds frequency offset (crystal drift)
+#ifndef DCF77_PLL
+#define DCF77_PLL 1
+#endif
+#define DCF77_PLL_WINDOW 8 // edge search window (+-ticks around expected edge)
+#define DCF77_PLL_KP_SHIFT 2 // proportional gain 1/4
+#define DCF77_PLL_KI_SHIFT 6 // integral gain 1/64 (critically damped with KP 1/4)
+#define DCF77_PLL_ONE 65536L // one tick in accumulator units
+#define DCF77_PLL_INTEG_MAX (DCF77_PLL_ONE/2) // max. frequency offset (half tick per second, ~1000ppm)
+// pll hold over, phase is propagated by integrator (frequency) only, hold lasts while
+// the error bound (frequency uncertainty * hold time) fits within the edge search window
+#define DCF77_PLL_HOLD_UNCERT 67L // frequency uncertainty (accumulator units per second, ~2ppm)
+#define DCF77_PLL_MAX_HOLD_SYMBOLS ((int)(DCF77_PLL_WINDOW*DCF77_PLL_ONE/DCF77_PLL_HOLD_UNCERT))
+// loss of lock, fine sync. symbols without edge in the search window (signal phase jumped,
+// pulses are still detected as symbols but the loop can't see them), back to coarse sync.
+#define DCF77_PLL_LOCK_LOSS 10
+
+// symbol detector windows (symbol 0 pulse, symbol 1 pulse, rest .. signal quality),
+// fine sync. shifts have to stay inside the first window
+#if (DCF77_S0_PERIOD<=0)||(DCF77_S1_PERIOD<=DCF77_S0_PERIOD)||(DCF77_DETECT_PERIOD<=DCF77_S1_PERIOD)
+#error "dcf77 detector windows have to be ascending and not empty"
+#endif
+// detectors per channel, pll shifts the one detector, early/late votes need three
+// of them (sooner, now, later)
+#if DCF77_PLL
+#define DCF77_DETECTORS 1
+#define DCF77_NOW 0
+#else
+#define DCF77_DETECTORS 3
+#define DCF77_NOW 1
+#endif
+#if DCF77_PLL
+#if (DCF77_PLL_WINDOW+2+DCF77_FINESYNC_OFFSET+DCF77_PLL_WINDOW/4+1)>=DCF77_S0_PERIOD
+#error "dcf77 pll shifts have to stay inside the first detector window"
+#endif
+#else
+#if (2*DCF77_FINESYNC_OFFSET+DCF77_FINETUNE_SHIFT+1)>=DCF77_S0_PERIOD
+#error "dcf77 fine sync. shifts have to stay inside the first detector window"
+#endif
+#endif
+
+// coarse synchronization (histogram of rising edge phases within second)
+#define DCF77_COARSE_BINS 32 // histogram bins (power of 2, two per byte)
+#define DCF77_COARSE_BIN_MAX 15 // bin saturation (4 bits)
+#define DCF77_COARSE_BIN_TICKS (DCF77_DETECT_PERIOD/DCF77_COARSE_BINS)
+#define DCF77_COARSE_SECONDS 5 // evaluation period (seconds)
+#define DCF77_COARSE_MIN_HITS 4 // edges needed in the peak (two neighbour bins)
+#define DCF77_COARSE_GATE_TIMEOUT 10 // seconds without edge in gate (restart histogram)
+#define DCF77_COARSE_GATE_HITS 2 // edges in locked gate (detectors aligned) before fine sync.
 
-// dcf strobe variables
-typedef enum {DCF77SYNC_COARSE,DCF77SYNC_FINE,DCF77SYNC_HOLD} dcf77_sync_mode_type;
-dcf77_sync_mode_type dcf77_sync_mode = DCF77SYNC_COARSE;
+// diversity combining (more channels), symbols of synchronized channels are weighted
+// by their quality margin (sigQ above threshold), combined DCF77_COMBINE_DELAY ticks
+// after the primary channel symbol (others may lag by filter delay or sync. offset),
+// primary channel (rtc timing, sync. mode) is the one with the best quality score
+#define DCF77_COMBINE_DELAY ((DCF77_CHANNELS>1)?16:0)
+#define DCF77_SCORE_SHIFT 3 // quality score averaging (1/8 new value), fixed point
+#define DCF77_SCORE_HYST (RTC_SAMPLING_FREQV/50) // primary channel switch hysteresis
 
-typedef enum {DCF77_SYMBOL_NONE,DCF77_SYMBOL_0,DCF77_SYMBOL_1,DCF77_SYMBOL_MINUTE} dcf77_symbol_type;
+// successful minute block decodings and fine sync. corrections counters
+uint16_t dcf77_decodes = 0;
+volatile uint16_t dcf77_shifts = 0;
 
-// detector context type
+// symbol queue (one symbol per second is taken by main loop within milliseconds, the
+// second slot covers main loop held longer than a second), isr writes the head, main
+// loop the tail (free running 8 bit indexes, one byte writes are atomic), symbols
+// arriving to the full queue are dropped and counted
+#define DCF77_QUEUE_SIZE 2 // power of 2
+#define DCF77_QUEUE_SYM_SHIFT 10 // item packing: signal quality (bits 0..9), symbol, sync. mode
+#define DCF77_QUEUE_MODE_SHIFT 12
+#if (DCF77_QUEUE_SIZE&(DCF77_QUEUE_SIZE-1))!=0
+#error "dcf77 queue size has to be power of 2"
+#endif
+#if DCF77_DETECT_PERIOD>=(1<<DCF77_QUEUE_SYM_SHIFT)
+#error "dcf77 signal quality doesn't fit the queue item"
+#endif
 typedef struct {
-    int cnt; // counter
-    dcf77_symbol_type sym; // last symbol buffer
-    int sigQcnt,sigQ; // signal quality
-    bool ready; // just detected flag
+    uint16_t tick; // rtc tick of symbol end
+    uint16_t item; // signal quality, symbol and sync. mode
+} dcf77_queue_item;
 
-    int s0cnt,s1cnt,sMcnt; // symbol counters (very internal)
-} dcf77_detector_context;
+dcf77_queue_item dcf77_queue[DCF77_QUEUE_SIZE];
+volatile uint8_t dcf77_queue_head = 0, dcf77_queue_tail = 0;
+volatile uint16_t dcf77_queue_drops = 0;
+// tick and sync. mode of the symbol being processed (used by decoder to align rtc)
+uint16_t dcf77_symbol_tick;
+dcf77_sync_mode_type dcf77_process_mode = DCF77SYNC_COARSE;
+uint16_t dcf77_hold_symbols = 0; // hold over duration (symbols)
+
+// minute block memory (symbols of current minute)
+typedef struct {
+    uint16_t data[4]; // symbol 1 bits
+    uint16_t valid[4]; // missing symbol bits
+    uint8_t cnt, dcnt; // symbols counter, word index
+    uint16_t mask; // bit mask in word
+} dcf77_minute_memory;
+
+dcf77_minute_memory dcf77_minute;
+
+// input filter state
+typedef struct {
+    uint8_t reg, cnt; // shift register, counter
+    bool out;
+} dcf77_filter_state;
+
+// receiver channel (everything from input sampling to symbol detection)
+typedef struct {
+    dcf77_filter_state filter;
+    bool last_sig; // last filtered input (edge detection)
+    dcf77_detector_context detector[DCF77_DETECTORS];
+    dcf77_sync_mode_type sync_mode;
+    int hold_counter;
+    #if !DCF77_PLL
+    int FineTune; // fine synchronization early/late votes
+    #endif
+    #if DCF77_PLL
+    // pll state (accumulator units, 1/65536 tick)
+    int32_t pll_integ; // frequency offset (per second)
+    int32_t pll_frac; // fractional phase correction
+    int pll_err; // last phase error (ticks)
+    bool pll_edge; // edge found in current second
+    bool pll_filtered; // loop filter done in current second
+    uint8_t pll_miss; // fine sync. seconds without edge in window (loss of lock)
+    #endif
+    #if DCF77_ADAPTIVE_THRESHOLD
+    dcf77_adapt_state adapt; // signal quality threshold
+    #endif
+    // coarse synchronization (histogram of rising edge phases)
+    uint8_t coarse_hist[DCF77_COARSE_BINS/2]; // 4 bit bins (even bin in low nibble)
+    int coarse_phase; // ticks within (free running) second
+    uint8_t coarse_seconds;
+    int8_t coarse_gate; // first bin of locked peak (-1 .. not locked)
+    uint8_t coarse_hits; // edges in locked gate
+    // last symbol (diversity combining) and quality score
+    dcf77_symbol_type sym;
+    int sigQ;
+    uint16_t sym_tick; // rtc tick of symbol end
+    #if DCF77_CHANNELS>1
+    int score; // averaged sigQ when synchronized (fixed point)
+    #endif
+} dcf77_channel;
+
+dcf77_channel dcf77_ch[DCF77_CHANNELS];
+uint8_t dcf77_primary = 0; // best channel
+uint8_t dcf77_combine_cnt = 0; // ticks to symbols combining (0 .. idle)
+uint16_t dcf77_combine_tick; // primary channel symbol tick
+
+// signal quality threshold
+#if DCF77_ADAPTIVE_THRESHOLD
+#define DCF77_THRESHOLD(c) ((c)->adapt.thr)
+#else
+#define DCF77_THRESHOLD(c) DCF77_MIN_SIGNAL_QUALITY
+#endif
 
 // function finding index and value of the biggest value from three values
 // it is used in symbol matching (dcf77_detect) and fine synchronization (dcf77_strobe)
@@ -123,91 +344,108 @@ uint8_t getlongparity(uint16_t dat0, uint16_t dat1)
 }
 #endif
 
-// function decode dcf data
-void dcf77_decode(uint16_t *data,uint16_t *valid)
+// function decode dcf data (minute block to time, no side effects)
+dcf77_decode_result dcf77_decode_frame(uint16_t *data,uint16_t *valid,tstruct *t)
 {
     int i;
-    tstruct dcf77_time;
     uint8_t bcd;
 
     // (first time) decode only when all data valid
-    for (i=0;i<4;i++) if (valid[i]!=0) return;
+    for (i=0;i<4;i++) if (valid[i]!=0) return DCF77_DECODE_INVALID;
 
     #if DCF77_TEST_PARITY
     // test M = 0 (bit 0)
-    if ((data[0]&0x0001)!=0) return;
+    if ((data[0]&0x0001)!=0) return DCF77_DECODE_MARKER;
     // test S = 1 (bit 20)
-    if ((data[1]&0x0010)==0) return;
+    if ((data[1]&0x0010)==0) return DCF77_DECODE_MARKER;
     #endif
 
     // minute (bit 21 .. 27) / bit 28 parity
     bcd = (data[1]>>5)&0x007F;
     #if DCF77_TEST_PARITY
-    if (((data[1]&0x1000)?1:0)!=getparity(dcf77_time.minute)) return;
+    if (((data[1]&0x1000)?1:0)!=getparity(bcd)) return DCF77_DECODE_PARITY;
     #endif
-    dcf77_time.minute = bcd2bin(bcd);
+    t->minute = bcd2bin(bcd);
     #if DCF77_TEST_PARITY
-    if (dcf77_time.minute>59) return;
+    if (t->minute>59) return DCF77_DECODE_RANGE;
     #endif
 
     // hour (bit 29 .. 34) / bit 35 parity
     bcd = (data[1]>>13)|((data[2]&0x0007)<<3);
     #if DCF77_TEST_PARITY
-    if (((data[2]&0x0008)?1:0)!=getparity(dcf77_time.hour)) return;
+    if (((data[2]&0x0008)?1:0)!=getparity(bcd)) return DCF77_DECODE_PARITY;
     #endif
-    dcf77_time.hour = bcd2bin(bcd);
+    t->hour = bcd2bin(bcd);
     #if DCF77_TEST_PARITY
-    if (dcf77_time.hour>23) return;
+    if (t->hour>23) return DCF77_DECODE_RANGE;
     #endif
 
     // day of week (bit 42 .. 44)
     bcd = (data[2]>>10)&0x07;
     #if DCF77_TEST_PARITY
-    if (((data[3]&0x0400)?1:0)!=getlongparity((data[2]&0xFFF0)>>4,data[3]&0x03FF)) return;
+    if (((data[3]&0x0400)?1:0)!=getlongparity((data[2]&0xFFF0)>>4,data[3]&0x03FF)) return DCF77_DECODE_PARITY;
     #endif
-    dcf77_time.dayow = bcd2bin(bcd)-1;
+    t->dayow = bcd2bin(bcd)-1;
     #if DCF77_TEST_PARITY
-    if (dcf77_time.dayow==7) return;
+    if (t->dayow==7) return DCF77_DECODE_RANGE;
     #endif
 
-    dcf77_time.second = 0;
+    t->second = 0;
+
+    return DCF77_DECODE_OK;
+}
+
+// function decode dcf data and synchronize rtc
+dcf77_decode_result dcf77_decode(uint16_t *data,uint16_t *valid)
+{
+    tstruct dcf77_time;
+    dcf77_decode_result res = dcf77_decode_frame(data,valid,&dcf77_time);
+    if (res!=DCF77_DECODE_OK) return res;
+
+    dcf77_decodes++;
 
-    // use decoded value here
-    rtc_set_time(&dcf77_time); // RTC is synchronized HERE !!!
+    // use decoded value here (aligned to the tick of minute symbol end)
+    int16_t corr = rtc_set_time_aligned(&dcf77_time,rtc_get_ticks()-dcf77_symbol_tick); // RTC is synchronized HERE !!!
+    if (corr>127) corr=127;
+    if (corr<-128) corr=-128;
+    evlog_add(EVLOG_CORRECTION,(uint8_t)corr);
+
+    return DCF77_DECODE_OK;
 }
 
 // function memorize one minute symbols
 void dcf77_symbol_memory(dcf77_symbol_type symbol)
 {
-    static uint16_t data[4];
-    static uint16_t valid[4];
-    static int cnt = 0, dcnt = 0;
-    static uint16_t mask = 1;
+    dcf77_minute_memory *m = &dcf77_minute;
 
     // save symbol
-    if (symbol==DCF77_SYMBOL_1) data[dcnt]|=mask;
-    if (symbol==DCF77_SYMBOL_NONE) valid[dcnt]|=mask;
+    if (symbol==DCF77_SYMBOL_1) m->data[m->dcnt]|=m->mask;
+    if (symbol==DCF77_SYMBOL_NONE) m->valid[m->dcnt]|=m->mask;
 
     // increase counter & mask
-    mask<<=1;
-    if (mask==0) {dcnt++;mask=1;};
-    cnt++;
+    m->mask<<=1;
+    if (m->mask==0) {m->dcnt++;m->mask=1;};
+    m->cnt++;
 
     // test if symbol counter == 60 and symbol != "0" or "1"
-    if ((cnt==60)&&((symbol==DCF77_SYMBOL_MINUTE)||(symbol==DCF77_SYMBOL_NONE)))
+    if ((m->cnt==60)||(symbol==DCF77_SYMBOL_MINUTE))
     {
+        dcf77_decode_result res = DCF77_DECODE_LENGTH;
         // try to decode
-        dcf77_decode(data,valid);
+        if ((m->cnt==60)&&((symbol==DCF77_SYMBOL_MINUTE)||(symbol==DCF77_SYMBOL_NONE)))
+            res = dcf77_decode(m->data,m->valid);
+        stats_decode(res);
+        // log it (only when symbol detector synchronized)
+        if (res==DCF77_DECODE_OK) evlog_add(EVLOG_DECODE_OK,0);
+        else if (dcf77_process_mode!=DCF77SYNC_COARSE) evlog_add(EVLOG_DECODE_FAIL,res);
     }
 
     // if minute symbol or counter == 60 => reset counter
-    if ((cnt==60)||(symbol==DCF77_SYMBOL_MINUTE))
+    if ((m->cnt==60)||(symbol==DCF77_SYMBOL_MINUTE))
     {
-        // reset counter
-        cnt=0; mask=1; dcnt=0;
-        // clear data and valid buffer
-        memset(data,0,4*sizeof(uint16_t));
-        memset(valid,0,4*sizeof(uint16_t));
+        // reset counter, clear data and valid buffer
+        memset(m,0,sizeof(dcf77_minute_memory));
+        m->mask=1;
     }
 }
 
@@ -223,10 +461,11 @@ void dcf77_reset_context(dcf77_detector_context *detector,int offset)
 }
 
 // dcf signal detect function
-void dcf77_detect(dcf77_detector_context *detector, bool signal)
+void dcf77_detect(dcf77_detector_context *detector, bool signal, int thr)
 {
-    // if cnt full, reset context
-    if (detector->cnt>=DCF77_DETECT_PERIOD)
+    // after period end reset context (fine sync. shift at the end is the next start offset,
+    // counter may be back below the period, windows are done anyway)
+    if (detector->ready)
         dcf77_reset_context(detector,detector->cnt-DCF77_DETECT_PERIOD);
 
     // test symbols
@@ -267,153 +506,608 @@ void dcf77_detect(dcf77_detector_context *detector, bool signal)
         // save overall signal quality value (symbol and pause)
         detector->sigQ = detector->sigQcnt+symQ;
         // decode symbol
-        if (detector->sigQ >= DCF77_MIN_SIGNAL_QUALITY)
+        if (detector->sigQ >= thr)
             detector->sym=symI+1;
         else
             detector->sym=DCF77_SYMBOL_NONE;
-        /*switch (symI)
-        {
-            case 0: detector->sym=DCF77_SYMBOL_0; break;
-            case 1: detector->sym=DCF77_SYMBOL_1; break;
-            case 2: detector->sym=DCF77_SYMBOL_MINUTE; break;
-            default: detector->sym=DCF77_SYMBOL_NONE; break;
-        }*/
 
         // rise it's ready flag
         detector->ready=true;
     }
 }
 
-// strobe function
-void dcf77_strobe(void)
+#if DCF77_ADAPTIVE_THRESHOLD
+// symbol margin (detected symbol match above the second best one, detector just ready)
+int dcf77_symbol_margin(dcf77_detector_context *detector)
 {
-    // dcf detectors (3 for fine synchronization: sooner, now, later)
-    static dcf77_detector_context detector[3];
+    int q0 = detector->s0cnt, q1 = detector->s1cnt, qm = detector->sMcnt;
+    int best, second;
+    if (q0>=q1) {best=q0;second=q1;} else {best=q1;second=q0;}
+    if (qm>best) {second=best;best=qm;}
+    else if (qm>second) second=qm;
+    return best-second;
+}
 
-    static bool last_dcf77sig = false;
-    bool dcf77sig = DCF77_INPUT();
-    int i;
+// initial quality distributions (noise of random input, signal at the fixed threshold)
+void dcf77_adapt_init(dcf77_adapt_state *a)
+{
+    a->thr = DCF77_MIN_SIGNAL_QUALITY;
+    a->noise_mean = DCF77_ADAPT_NOISE_INIT<<DCF77_ADAPT_SHIFT;
+    a->noise_dev = DCF77_ADAPT_NOISE_DEV_INIT<<DCF77_ADAPT_SHIFT;
+    a->signal_mean = DCF77_MIN_SIGNAL_QUALITY<<DCF77_ADAPT_SHIFT;
+    a->signal_dev = DCF77_ADAPT_NOISE_DEV_INIT<<DCF77_ADAPT_SHIFT;
+    a->margin = 0;
+}
 
-    static int FineTune = 0;
+// update quality distributions, symbol margin and threshold (once per symbol)
+void dcf77_adapt_update(dcf77_adapt_state *a, dcf77_detector_context *detector)
+{
+    int x = detector->sigQ<<DCF77_ADAPT_SHIFT;
+    int *mean, *dev, d;
 
-    static int hold_counter = 0;
+    // margin of accepted symbols
+    if (detector->sym!=DCF77_SYMBOL_NONE)
+        a->margin += ((dcf77_symbol_margin(detector)<<DCF77_ADAPT_SHIFT)-a->margin)>>DCF77_ADAPT_SHIFT;
 
+    // nearest cluster (noise or signal)
+    if (x<((a->noise_mean+a->signal_mean)>>1))
+    {
+        mean = &a->noise_mean;
+        dev = &a->noise_dev;
+    }
+    else
+    {
+        mean = &a->signal_mean;
+        dev = &a->signal_dev;
+    }
+    d = x-*mean;
+    *mean += d>>DCF77_ADAPT_SHIFT;
+    if (d<0) d=-d;
+    *dev += (d-*dev)>>DCF77_ADAPT_SHIFT;
 
-    // coarse synchronization
-    if (dcf77_sync_mode == DCF77SYNC_COARSE)
+    // threshold above noise
+    int thr = (a->noise_mean+(int)(((long)DCF77_ADAPT_K4*a->noise_dev)>>2))>>DCF77_ADAPT_SHIFT;
+    if (thr<DCF77_ADAPT_MIN) thr=DCF77_ADAPT_MIN;
+    if (thr>DCF77_ADAPT_MAX) thr=DCF77_ADAPT_MAX;
+    a->thr = thr;
+}
+#endif
+
+// input filter
+bool dcf77_filter(dcf77_filter_state *f, bool in)
+{
+    #if DCF77_FILTER==DCF77_FILTER_MAJORITY
+    // incremental count of ones in shift register
+    f->cnt += (in?1:0)-((f->reg>>(DCF77_FILTER_N-1))&0x01);
+    f->reg = ((f->reg<<1)|(in?1:0))&((1<<DCF77_FILTER_N)-1);
+    if (f->cnt>=DCF77_FILTER_K) f->out = true;
+    else if (f->cnt<=(DCF77_FILTER_N-DCF77_FILTER_K)) f->out = false;
+    return f->out;
+    #elif DCF77_FILTER==DCF77_FILTER_HYSTERESIS
+    if (in) {if (f->cnt<DCF77_FILTER_N) f->cnt++;}
+    else {if (f->cnt>0) f->cnt--;}
+    if (f->cnt==DCF77_FILTER_N) f->out = true;
+    if (f->cnt==0) f->out = false;
+    return f->out;
+    #elif DCF77_FILTER==DCF77_FILTER_GLITCH
+    if (in==f->out) f->cnt = 0;
+    else if (++f->cnt>=DCF77_FILTER_N) {f->out = in; f->cnt = 0;}
+    return f->out;
+    #else
+    return in;
+    #endif
+}
+
+// restart coarse synchronization
+void dcf77_coarse_reset(dcf77_channel *c)
+{
+    memset(c->coarse_hist,0,sizeof(c->coarse_hist));
+    c->coarse_seconds = 0;
+    c->coarse_gate = -1;
+    c->coarse_hits = 0;
+}
+
+// coarse histogram bin
+uint8_t dcf77_coarse_bin(dcf77_channel *c, int i)
+{
+    uint8_t b = c->coarse_hist[i>>1];
+    return (i&1)?(b>>4):(b&0x0F);
+}
+
+// coarse synchronization (call every tick in coarse mode)
+// rising edges are accumulated into phase histogram, when there is significant
+// peak (two neighbour bins) the gate is locked and only edges inside it
+// resynchronize detectors (returns true then), so random spikes are ignored
+bool dcf77_coarse(dcf77_channel *c, bool edge)
+{
+    bool sync = false;
+    int i, bin = c->coarse_phase/DCF77_COARSE_BIN_TICKS;
+
+    if (edge)
     {
-        if (detector[0].ready==true)
+        if (c->coarse_gate<0)
+        {
+            if (dcf77_coarse_bin(c,bin)<DCF77_COARSE_BIN_MAX) c->coarse_hist[bin>>1] += (bin&1)?0x10:0x01;
+        }
+        else if ((bin==c->coarse_gate)||(bin==((c->coarse_gate+1)&(DCF77_COARSE_BINS-1))))
+        {
+            sync = true;
+            c->coarse_seconds = 0;
+            if (c->coarse_hits<255) c->coarse_hits++;
+        }
+    }
+
+    if (++c->coarse_phase>=DCF77_DETECT_PERIOD)
+    {
+        c->coarse_phase = 0;
+        c->coarse_seconds++;
+        if (c->coarse_gate<0)
         {
-            if ((detector[0].sym!=DCF77_SYMBOL_MINUTE)&&(detector[0].sym!=DCF77_SYMBOL_NONE))
+            if (c->coarse_seconds>=DCF77_COARSE_SECONDS)
             {
-                dcf77_sync_mode=DCF77SYNC_FINE;
-                DCF77_LED_ON();
+                // find the biggest peak and the biggest one not overlapping it
+                int best=0, bi=0, second=0;
+                for (i=0;i<DCF77_COARSE_BINS;i++)
+                {
+                    int sum = dcf77_coarse_bin(c,i)+dcf77_coarse_bin(c,(i+1)&(DCF77_COARSE_BINS-1));
+                    if (sum>best) {best=sum;bi=i;}
+                }
+                for (i=0;i<DCF77_COARSE_BINS;i++)
+                {
+                    int sum = dcf77_coarse_bin(c,i)+dcf77_coarse_bin(c,(i+1)&(DCF77_COARSE_BINS-1));
+                    int d = (i-bi)&(DCF77_COARSE_BINS-1);
+                    if ((d>1)&&(d<(DCF77_COARSE_BINS-1))&&(sum>second)) second=sum;
+                }
+                if ((best>=DCF77_COARSE_MIN_HITS)&&(best>=(2*second)))
+                {
+                    c->coarse_gate = bi; // locked
+                }
+                else
+                {
+                    // not significant yet, age histogram
+                    for (i=0;i<(DCF77_COARSE_BINS/2);i++) c->coarse_hist[i] = (c->coarse_hist[i]>>1)&0x77;
+                }
+                c->coarse_seconds = 0;
             }
         }
-        else
+        else if (c->coarse_seconds>DCF77_COARSE_GATE_TIMEOUT)
+        {
+            dcf77_coarse_reset(c); // signal lost, start again
+        }
+    }
+
+    return sync;
+}
+
+#if DCF77_PLL
+// seed pll frequency from rtc crystal drift estimate (positive drift .. edges come late)
+void dcf77_pll_seed(dcf77_channel *c)
+{
+    int16_t drift;
+    if (rtc_get_drift(&drift))
+        c->pll_integ = (int32_t)drift*(RTC_SAMPLING_FREQV*DCF77_PLL_ONE/100000L)/100L;
+    c->pll_frac = 0;
+    c->pll_miss = 0;
+}
+
+// pll (every tick in fine mode), returns detectors shift in ticks
+// phase error is edge position relative to center detector period start, it's
+// measured within +-DCF77_PLL_WINDOW and the loop filter runs when the window
+// closes (all detectors in the middle of period, so they can be shifted)
+int dcf77_pll(dcf77_channel *c, bool edge)
+{
+    int shift = 0;
+    int idx = c->detector[DCF77_NOW].cnt-1; // sample index within period
+    if (idx>=(DCF77_DETECT_PERIOD/2)) idx-=DCF77_DETECT_PERIOD;
+
+    // phase detector (the first edge in window)
+    if (edge&&(!c->pll_edge)&&(idx<=DCF77_PLL_WINDOW)&&(idx>=-DCF77_PLL_WINDOW))
+    {
+        c->pll_err = idx;
+        c->pll_edge = true;
+    }
+
+    // loop filter (once, shift may return index back)
+    if (idx<0) c->pll_filtered = false;
+    if ((idx==(DCF77_PLL_WINDOW+1))&&(!c->pll_filtered))
+    {
+        c->pll_filtered = true;
+        if (c->pll_edge)
         {
-            if ((dcf77sig!=last_dcf77sig)&&dcf77sig) // detect rising edge
+            c->pll_integ += ((int32_t)c->pll_err*DCF77_PLL_ONE)>>DCF77_PLL_KI_SHIFT;
+            if (c->pll_integ>DCF77_PLL_INTEG_MAX) c->pll_integ=DCF77_PLL_INTEG_MAX;
+            if (c->pll_integ<-DCF77_PLL_INTEG_MAX) c->pll_integ=-DCF77_PLL_INTEG_MAX;
+            c->pll_frac += ((int32_t)c->pll_err*DCF77_PLL_ONE)>>DCF77_PLL_KP_SHIFT;
+            c->pll_miss = 0;
+        }
+        else if ((c->sync_mode==DCF77SYNC_FINE)&&(c->pll_miss<255)) c->pll_miss++; // hold over doesn't count
+        c->pll_frac += c->pll_integ; // frequency offset applies even without edge
+        while (c->pll_frac>=DCF77_PLL_ONE) {c->pll_frac-=DCF77_PLL_ONE;shift--;}
+        while (c->pll_frac<=-DCF77_PLL_ONE) {c->pll_frac+=DCF77_PLL_ONE;shift++;}
+        c->pll_edge = false;
+    }
+    return shift;
+}
+#endif
+
+#if !DCF77_PLL
+// early/late votes (all three detectors ready), returns detectors shift in ticks
+// the best quality detector votes, shift after more than symcount votes to one side
+int dcf77_finetune(dcf77_detector_context *detector, int *ft, int symcount)
+{
+    int Q,b;
+    b=find_biggest(detector[0].sigQ,detector[1].sigQ,detector[2].sigQ,&Q);
+    if (b==0)
+    {
+        (*ft)--;
+        if (*ft<-symcount)
+        {
+            *ft=0;
+            return DCF77_FINETUNE_SHIFT;
+        }
+    }
+    if (b==2)
+    {
+        (*ft)++;
+        if (*ft>symcount)
+        {
+            *ft=0;
+            return -DCF77_FINETUNE_SHIFT;
+        }
+    }
+    return 0;
+}
+#endif
+
+// shift all channel detectors (fine sync. correction)
+void dcf77_shift(dcf77_channel *c, int shift, bool primary)
+{
+    int i;
+    if (shift==0) return;
+    if (primary) dcf77_shifts++;
+    for (i=0;i<DCF77_DETECTORS;i++) c->detector[i].cnt+=shift;
+}
+
+// one channel strobe (sync. modes and symbol detection), returns true when symbol detected
+bool dcf77_strobe_channel(dcf77_channel *c, bool in, bool primary)
+{
+    dcf77_detector_context *detector = c->detector;
+    bool dcf77sig = dcf77_filter(&c->filter,in);
+    bool edge = (dcf77sig!=c->last_sig)&&dcf77sig; // rising edge
+    int i;
+
+    // coarse synchronization
+    if (c->sync_mode == DCF77SYNC_COARSE)
+    {
+        bool sync = dcf77_coarse(c,edge);
+        if (detector[0].ready==true)
+        {
+            // detectors aligned by gate edges (free running ones detect symbols at any phase)
+            if ((c->coarse_gate>=0)&&(c->coarse_hits>=DCF77_COARSE_GATE_HITS)&&
+                (detector[0].sym!=DCF77_SYMBOL_MINUTE)&&(detector[0].sym!=DCF77_SYMBOL_NONE))
             {
-                // reset contexts
-                dcf77_reset_context(&detector[0],+DCF77_FINESYNC_OFFSET);
-                dcf77_reset_context(&detector[1],0);
-                dcf77_reset_context(&detector[2],-DCF77_FINESYNC_OFFSET);
-                //DCF77_LED_SWAP(); // debug
+                #if DCF77_PLL
+                dcf77_pll_seed(c);
+                #endif
+                c->sync_mode=DCF77SYNC_FINE;
+                if (primary) DCF77_LED_ON();
             }
         }
+        else if (sync)
+        {
+            // reset contexts
+            #if DCF77_PLL
+            dcf77_reset_context(&detector[0],0);
+            #else
+            dcf77_reset_context(&detector[0],+DCF77_FINESYNC_OFFSET);
+            dcf77_reset_context(&detector[1],0);
+            dcf77_reset_context(&detector[2],-DCF77_FINESYNC_OFFSET);
+            #endif
+        }
     }
 
-    // detection and decoding
-    for (i=0;i<3;i++) dcf77_detect(&detector[i],dcf77sig); // detection
-    //if (detector[1].ready==true) dcf77_decode(detector[1].sym);
-    if (detector[1].ready == true)
+    // detection
+    for (i=0;i<DCF77_DETECTORS;i++) dcf77_detect(&detector[i],dcf77sig,DCF77_THRESHOLD(c));
+    if (detector[DCF77_NOW].ready == true)
     {
-        dcf77_symbol_memory(detector[1].sym);
-        #if DCF77_DEBUG
-        last_symbol = detector[1].sym;
-        finetune = FineTune;
-        last_Q = detector[1].sigQ;
-        symbol_ready = true;
+        #if DCF77_ADAPTIVE_THRESHOLD
+        dcf77_adapt_update(&c->adapt,&detector[DCF77_NOW]);
         #endif
+        c->sym = detector[DCF77_NOW].sym;
+        c->sigQ = detector[DCF77_NOW].sigQ;
+        c->sym_tick = rtc_get_ticks();
     }
 
     // fine synchronization
-    if (dcf77_sync_mode==DCF77SYNC_FINE)
+    if (c->sync_mode==DCF77SYNC_FINE)
     {
-        if (detector[1].ready==true)
+        if (detector[DCF77_NOW].ready==true)
         {
-            if (detector[1].sym==DCF77_SYMBOL_NONE)
+            if (detector[DCF77_NOW].sym==DCF77_SYMBOL_NONE)
             {
-                dcf77_sync_mode=DCF77SYNC_HOLD;
-                hold_counter=0;
+                c->sync_mode=DCF77SYNC_HOLD;
+                c->hold_counter=0;
             }
         }
-        if (detector[2].ready==true)
+        #if DCF77_PLL
+        dcf77_shift(c,dcf77_pll(c,edge),primary);
+        if (c->pll_miss>=DCF77_PLL_LOCK_LOSS)
         {
-            int Q,b;
-            b=find_biggest(detector[0].sigQ,detector[1].sigQ,detector[2].sigQ,&Q);
-            if (b==0)
-            {
-                FineTune--;
-                if (FineTune<-DCF77_FINETUNE_SYMCOUNT)
-                {
-                    FineTune=0;
-                    detector[0].cnt+=DCF77_FINETUNE_SHIFT;
-                    detector[1].cnt+=DCF77_FINETUNE_SHIFT;
-                    detector[2].cnt+=DCF77_FINETUNE_SHIFT;
-                }
-            }
-            if (b==2)
-            {
-                FineTune++;
-                if (FineTune>DCF77_FINETUNE_SYMCOUNT)
-                {
-                    FineTune=0;
-                    detector[0].cnt-=DCF77_FINETUNE_SHIFT;
-                    detector[1].cnt-=DCF77_FINETUNE_SHIFT;
-                    detector[2].cnt-=DCF77_FINETUNE_SHIFT;
-                }
-            }
+            c->sync_mode=DCF77SYNC_COARSE;
+            dcf77_coarse_reset(c);
+            if (primary) DCF77_LED_OFF();
         }
+        #else
+        if (detector[2].ready==true)
+            dcf77_shift(c,dcf77_finetune(detector,&c->FineTune,DCF77_FINETUNE_SYMCOUNT),primary);
+        #endif
     }
 
     // hold over
-    if (dcf77_sync_mode==DCF77SYNC_HOLD)
+    if (c->sync_mode==DCF77SYNC_HOLD)
     {
-        if (detector[1].ready==true)
+        #if DCF77_PLL
+        // free running phase propagation (no edges, noise would pull the loop)
+        dcf77_shift(c,dcf77_pll(c,false),primary);
+        #endif
+        if (detector[DCF77_NOW].ready==true)
         {
-            DCF77_LED_SWAP();
-            if ((detector[1].sym==DCF77_SYMBOL_NONE)||(detector[1].sym==DCF77_SYMBOL_MINUTE))
+            if (primary) DCF77_LED_SWAP();
+            if ((detector[DCF77_NOW].sym==DCF77_SYMBOL_NONE)||(detector[DCF77_NOW].sym==DCF77_SYMBOL_MINUTE))
             {
-                hold_counter++;
-                if (hold_counter>DCF77_MAX_HOLD_SYMBOLS)
+                c->hold_counter++;
+                #if DCF77_PLL
+                if (c->hold_counter>DCF77_PLL_MAX_HOLD_SYMBOLS)
+                #else
+                if (c->hold_counter>DCF77_MAX_HOLD_SYMBOLS)
+                #endif
                 {
-                    dcf77_sync_mode=DCF77SYNC_COARSE;
-                    DCF77_LED_OFF();
+                    c->sync_mode=DCF77SYNC_COARSE;
+                    dcf77_coarse_reset(c);
+                    if (primary) DCF77_LED_OFF();
                 }
             }
             else
             {
                 // symbol found (0 or 1) - back to fine sync.
-                dcf77_sync_mode=DCF77SYNC_FINE;
-                DCF77_LED_ON();
+                c->sync_mode=DCF77SYNC_FINE;
+                if (primary) DCF77_LED_ON();
             }
         }
     }
 
-    // save last input (for coarse sync.)
-    last_dcf77sig = dcf77sig;
+    // save last input (edge detection)
+    c->last_sig = dcf77sig;
+
+    return detector[DCF77_NOW].ready;
+}
+
+// combine channel symbols and pass the result to main loop
+void dcf77_combine(void)
+{
+    dcf77_channel *p = &dcf77_ch[dcf77_primary];
+    dcf77_symbol_type sym = p->sym;
+    int sigQ = p->sigQ;
+
+    #if DCF77_CHANNELS>1
+    int weight[4] = {0,0,0,0};
+    int best_q[4] = {0,0,0,0};
+    uint8_t ch, best = dcf77_primary;
+    for (ch=0;ch<DCF77_CHANNELS;ch++)
+    {
+        dcf77_channel *c = &dcf77_ch[ch];
+        // quality score (averaged quality, zero when not synchronized)
+        int q = (c->sync_mode==DCF77SYNC_COARSE)?0:c->sigQ;
+        c->score += ((q<<DCF77_SCORE_SHIFT)-c->score)>>DCF77_SCORE_SHIFT;
+        if (c->score>dcf77_ch[best].score) best=ch;
+        // symbols of synchronized channels close to the primary one (within half second)
+        int margin = c->sigQ-DCF77_THRESHOLD(c);
+        if ((c->sync_mode==DCF77SYNC_COARSE)||(margin<=0)||(c->sym==DCF77_SYMBOL_NONE)) continue;
+        if ((uint16_t)(c->sym_tick-dcf77_combine_tick+(RTC_SAMPLING_FREQV/2))>=RTC_SAMPLING_FREQV) continue;
+        weight[c->sym] += margin;
+        if (c->sigQ>best_q[c->sym]) best_q[c->sym]=c->sigQ;
+    }
+    // combined symbol (the primary one when it's not synchronized)
+    if (p->sync_mode!=DCF77SYNC_COARSE)
+    {
+        int i, w = 0;
+        sym = DCF77_SYMBOL_NONE;
+        for (i=DCF77_SYMBOL_0;i<=DCF77_SYMBOL_MINUTE;i++)
+            if (weight[i]>w) {w=weight[i];sym=i;sigQ=best_q[i];}
+    }
+    // primary channel selection
+    if (dcf77_ch[best].score>(p->score+(DCF77_SCORE_HYST<<DCF77_SCORE_SHIFT))) dcf77_primary=best;
+    #endif
 
+    // pass symbol to main loop (dropped when the queue is full)
+    uint8_t head = dcf77_queue_head;
+    if ((uint8_t)(head-dcf77_queue_tail)<DCF77_QUEUE_SIZE)
+    {
+        dcf77_queue_item *item = &dcf77_queue[head&(DCF77_QUEUE_SIZE-1)];
+        item->tick = dcf77_combine_tick;
+        item->item = sigQ|((uint16_t)sym<<DCF77_QUEUE_SYM_SHIFT)|((uint16_t)p->sync_mode<<DCF77_QUEUE_MODE_SHIFT);
+        dcf77_queue_head = head+1;
+    }
+    else dcf77_queue_drops++;
+    event_post(EVENT_SYMBOL);
     #if DCF77_DEBUG
-    tunestatus=dcf77_sync_mode;
+    last_symbol = sym;
+    last_Q = sigQ;
+    symbol_ready = true;
+    #endif
+}
+
+// strobe function
+void dcf77_strobe(void)
+{
+    uint8_t ch;
+    for (ch=0;ch<DCF77_CHANNELS;ch++)
+    {
+        const dcf77_input_type *in = &dcf77_inputs[ch];
+        bool primary = (ch==dcf77_primary);
+        if (dcf77_strobe_channel(&dcf77_ch[ch],((*in->in)&in->bit)==0,primary)&&primary)
+        {
+            dcf77_combine_tick = dcf77_ch[ch].sym_tick;
+            dcf77_combine_cnt = DCF77_COMBINE_DELAY+1;
+        }
+    }
+
+    // symbols combining (delayed after primary channel)
+    if (dcf77_combine_cnt!=0)
+    {
+        if (--dcf77_combine_cnt==0) dcf77_combine();
+    }
+
+}
+
+// process symbols from queue (main loop)
+void dcf77_process(void)
+{
+    while (dcf77_queue_tail!=dcf77_queue_head)
+    {
+        uint8_t tail = dcf77_queue_tail;
+        dcf77_queue_item *item = &dcf77_queue[tail&(DCF77_QUEUE_SIZE-1)];
+        dcf77_sync_mode_type mode = (item->item>>DCF77_QUEUE_MODE_SHIFT)&0x03;
+        dcf77_symbol_type sym = (item->item>>DCF77_QUEUE_SYM_SHIFT)&0x03;
+
+        // sync. mode changes and hold over duration
+        if (mode!=dcf77_process_mode)
+        {
+            if (dcf77_process_mode==DCF77SYNC_HOLD)
+                evlog_add(EVLOG_HOLD,(dcf77_hold_symbols>(2*255))?255:(dcf77_hold_symbols>>1));
+            evlog_add(EVLOG_MODE,mode);
+            dcf77_process_mode = mode;
+            dcf77_hold_symbols = 0;
+        }
+        if (dcf77_process_mode==DCF77SYNC_HOLD) dcf77_hold_symbols++;
+
+        // reception statistics
+        stats_symbol(sym,item->item&((1<<DCF77_QUEUE_SYM_SHIFT)-1));
+
+        dcf77_symbol_tick = item->tick;
+        dcf77_symbol_memory(sym);
+        dcf77_queue_tail = tail+1;
+    }
+}
+
+// get synchronization mode (primary channel)
+dcf77_sync_mode_type dcf77_get_sync_mode(void)
+{
+    return dcf77_ch[dcf77_primary].sync_mode;
+}
+
+// get fine synchronization state (votes, or pll frequency offset in 1/256 tick per second)
+int dcf77_get_finetune(void)
+{
+    #if DCF77_PLL
+    return (int)(dcf77_ch[dcf77_primary].pll_integ>>8);
+    #else
+    return dcf77_ch[dcf77_primary].FineTune;
+    #endif
+}
+
+// set fine synchronization state (warm start, all channels)
+void dcf77_set_finetune(int ft)
+{
+    uint8_t ch;
+    #if !DCF77_PLL
+    if (ft>DCF77_FINETUNE_SYMCOUNT) ft=DCF77_FINETUNE_SYMCOUNT;
+    if (ft<-DCF77_FINETUNE_SYMCOUNT) ft=-DCF77_FINETUNE_SYMCOUNT;
+    #endif
+    for (ch=0;ch<DCF77_CHANNELS;ch++)
+    {
+        #if DCF77_PLL
+        dcf77_ch[ch].pll_integ = (int32_t)ft<<8;
+        #else
+        dcf77_ch[ch].FineTune = ft;
+        #endif
+    }
+}
+
+// get signal quality threshold state (sigQ units, primary channel)
+void dcf77_get_adapt(dcf77_adapt_state *a)
+{
+    #if DCF77_ADAPTIVE_THRESHOLD
+    dcf77_adapt_state *s = &dcf77_ch[dcf77_primary].adapt;
+    __disable_interrupt();
+    a->thr = s->thr;
+    a->noise_mean = s->noise_mean>>DCF77_ADAPT_SHIFT;
+    a->noise_dev = s->noise_dev>>DCF77_ADAPT_SHIFT;
+    a->signal_mean = s->signal_mean>>DCF77_ADAPT_SHIFT;
+    a->signal_dev = s->signal_dev>>DCF77_ADAPT_SHIFT;
+    a->margin = s->margin>>DCF77_ADAPT_SHIFT;
+    __enable_interrupt();
+    #else
+    a->thr = DCF77_MIN_SIGNAL_QUALITY;
+    a->noise_mean = a->noise_dev = a->signal_mean = a->signal_dev = a->margin = 0;
+    #endif
+}
+
+// get number of channels and primary (best) channel
+uint8_t dcf77_get_channels(uint8_t *primary)
+{
+    *primary = dcf77_primary;
+    return DCF77_CHANNELS;
+}
+
+// get channel quality score (sigQ units, 0 .. not synchronized)
+int dcf77_get_channel_score(uint8_t ch)
+{
+    if (ch>=DCF77_CHANNELS) return 0;
+    #if DCF77_CHANNELS>1
+    return dcf77_ch[ch].score>>DCF77_SCORE_SHIFT;
+    #else
+    return (dcf77_ch[ch].sync_mode==DCF77SYNC_COARSE)?0:dcf77_ch[ch].sigQ;
     #endif
 }
 
+// get fine sync. corrections counter
+uint16_t dcf77_get_shifts(void)
+{
+    return dcf77_shifts;
+}
+
+// get symbols dropped by full queue (main loop didn't take them in time)
+uint16_t dcf77_get_queue_drops(void)
+{
+    return dcf77_queue_drops;
+}
+
+// get successful decodings counter
+uint16_t dcf77_get_decodes(void)
+{
+    return dcf77_decodes;
+}
+
 /// module initialization function
-// input (only) init
+// inputs and channels init (resets all module state, there are no function statics)
 void dcf77_init(void)
 {
-    // input init
-    DCF77_INPUT_INIT();
+    uint8_t ch, i;
+    dcf77_queue_head = 0;
+    dcf77_queue_tail = 0;
+    dcf77_queue_drops = 0;
+    dcf77_process_mode = DCF77SYNC_COARSE;
+    dcf77_hold_symbols = 0;
+    memset(&dcf77_minute,0,sizeof(dcf77_minute_memory));
+    dcf77_minute.mask = 1;
+    dcf77_primary = 0;
+    dcf77_combine_cnt = 0;
+    dcf77_decodes = 0;
+    dcf77_shifts = 0;
+    for (ch=0;ch<DCF77_CHANNELS;ch++)
+    {
+        const dcf77_input_type *in = &dcf77_inputs[ch];
+        dcf77_channel *c = &dcf77_ch[ch];
+        *in->dir &= ~in->bit;
+        *in->out |= in->bit;
+        memset(c,0,sizeof(dcf77_channel));
+        for (i=0;i<DCF77_DETECTORS;i++) dcf77_reset_context(&c->detector[i],0);
+        c->sync_mode = DCF77SYNC_COARSE;
+        c->coarse_gate = -1;
+        #if DCF77_ADAPTIVE_THRESHOLD
+        dcf77_adapt_init(&c->adapt);
+        #endif
+    }
     DCF77_LED_INIT(); // debug led (en/dis by DCF77_LED macro value)
 }
@@ -13,17 +13,59 @@
 // code size and performace controll
 #define DCF77_TEST_PARITY 0 // set 1 to test parities and static bits in dcf77 code
 #define DCF77_DEBUG 1 // set 1 to output some debug variables
+#ifndef DCF77_FALSE_ACCEPT
+#define DCF77_FALSE_ACCEPT 100 // adaptive threshold target of false accepted noise symbols (per 10000)
+#endif
 
 #if DCF77_DEBUG
 // debug variables
 volatile uint8_t last_symbol;
 int last_Q;
 volatile bool symbol_ready;
-int tunestatus;
-int finetune;
 #endif
 
+// synchronization modes and symbols
+typedef enum {DCF77SYNC_COARSE,DCF77SYNC_FINE,DCF77SYNC_HOLD} dcf77_sync_mode_type;
+typedef enum {DCF77_SYMBOL_NONE,DCF77_SYMBOL_0,DCF77_SYMBOL_1,DCF77_SYMBOL_MINUTE} dcf77_symbol_type;
+// minute block decoding result (failure reason)
+typedef enum {DCF77_DECODE_OK,DCF77_DECODE_INVALID,DCF77_DECODE_LENGTH,DCF77_DECODE_MARKER,DCF77_DECODE_PARITY,DCF77_DECODE_RANGE} dcf77_decode_result;
+
+// signal quality threshold state (adaptive threshold)
+typedef struct {
+    int thr; // current threshold
+    int noise_mean, noise_dev; // noise quality distribution (mean, mean absolute deviation)
+    int signal_mean, signal_dev; // signal quality distribution
+    int margin; // accepted symbols margin (mean, match above the second best symbol)
+} dcf77_adapt_state;
+
+// symbol detector context
+typedef struct {
+    int cnt; // counter
+    dcf77_symbol_type sym; // last symbol buffer
+    int sigQcnt,sigQ; // signal quality
+    bool ready; // just detected flag
+
+    int s0cnt,s1cnt,sMcnt; // symbol counters (very internal)
+} dcf77_detector_context;
+
 void dcf77_init(void);
-void dcf77_strobe(void);
+void dcf77_strobe(void); // sampling and symbol detection (rtc timer isr)
+void dcf77_process(void); // minute block decoding (main loop)
+dcf77_sync_mode_type dcf77_get_sync_mode(void); // synchronization mode
+int dcf77_get_finetune(void); // fine synchronization votes
+void dcf77_set_finetune(int ft); // set fine synchronization votes (warm start)
+uint16_t dcf77_get_decodes(void); // successful decodings counter
+uint16_t dcf77_get_shifts(void); // fine sync. corrections counter
+uint16_t dcf77_get_queue_drops(void); // symbols dropped by full isr to main loop queue
+void dcf77_get_adapt(dcf77_adapt_state *a); // signal quality threshold state
+uint8_t dcf77_get_channels(uint8_t *primary); // number of receiver channels and primary (best) one
+int dcf77_get_channel_score(uint8_t ch); // channel quality score (0 .. not synchronized)
+// receiver parts (host batch engine runs them per trace as its scalar reference)
+void dcf77_reset_context(dcf77_detector_context *detector, int offset); // period start (offset ticks in)
+void dcf77_detect(dcf77_detector_context *detector, bool signal, int thr); // one sample (ready at period end)
+int dcf77_finetune(dcf77_detector_context *detector, int *ft, int symcount); // early/late votes (DCF77_PLL 0), shift
+void dcf77_symbol_memory(dcf77_symbol_type symbol); // minute block memory and decoding
+void dcf77_adapt_init(dcf77_adapt_state *a); // initial threshold state (fixed point, DCF77_ADAPTIVE_THRESHOLD 1)
+void dcf77_adapt_update(dcf77_adapt_state *a, dcf77_detector_context *detector); // one symbol (now detector ready)
 
 #endif
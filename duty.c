@@ -0,0 +1,116 @@
+/**
+ *
+ * duty cycle (cpu awake time) accounting module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * uses: Timer1_A (SMCLK/8, continuous mode)
+ *
+ * every accounted section reads timer at begin and end, the difference
+ * minus time accounted by nested sections (interrupts, lcd inside main)
+ * is added to subsystem counter
+ *
+ * timer is clocked from SMCLK, so it stops in LPM3 (nothing to count
+ * there) and its resolution is 1us instead of 30us of the 32kHz ACLK,
+ * which is too coarse for isr running few microseconds
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "uart.h"
+#include "power.h"
+#include "duty.h" // self
+
+#if DUTY_ACCT
+// awake time counters
+volatile uint32_t duty_ticks[DUTY_SUBSYSTEMS];
+// worst case section duration
+volatile uint16_t duty_max[DUTY_SUBSYSTEMS];
+// sum of all accounted time (wrapping, used for nested sections)
+volatile uint16_t duty_nested = 0;
+
+// report line names (subsystems and power modes)
+const char duty_names[DUTY_SUBSYSTEMS+POWER_MODES] = {'T','R','X','B','L','M','a','0','3'};
+
+// section begin (call with interrupts disabled or inside isr)
+void duty_begin(duty_stamp *stamp)
+{
+    stamp->start = TA1R;
+    stamp->nested = duty_nested;
+}
+
+// section end (call with interrupts disabled or inside isr)
+void duty_end(duty_subsystem_type sub, duty_stamp *stamp)
+{
+    uint16_t net = (TA1R-stamp->start)-(duty_nested-stamp->nested);
+    duty_ticks[sub] += net;
+    if (net>duty_max[sub]) duty_max[sub] = net;
+    duty_nested += net;
+}
+#endif
+
+// init Timer1_A
+void duty_init(void)
+{
+    #if DUTY_ACCT
+    TA1CTL = TASSEL_2 + ID_3 + MC_2 + TACLR; // SMCLK, /8, continuous
+    #endif
+}
+
+// get awake ticks of subsystem
+uint32_t duty_get_ticks(duty_subsystem_type sub)
+{
+    #if DUTY_ACCT
+    uint32_t t;
+    __disable_interrupt();
+    t = duty_ticks[sub];
+    __enable_interrupt();
+    return t;
+    #else
+    return 0;
+    #endif
+}
+
+// get worst case section duration of subsystem
+uint16_t duty_get_max(duty_subsystem_type sub)
+{
+    #if DUTY_ACCT
+    return duty_max[sub];
+    #else
+    return 0;
+    #endif
+}
+
+// format report line "N hhhhhhhh\r\n", subsystem counters first, then power mode ticks
+// and subsystem worst case durations at last ("N^hhhhhhhh\r\n")
+int duty_report(int line, char *s, int len)
+{
+    #if DUTY_ACCT
+    uint32_t v;
+    int i;
+
+    if ((line>=(2*DUTY_SUBSYSTEMS+POWER_MODES))||(len<13)) return -1;
+    s[1] = ' ';
+    if (line<DUTY_SUBSYSTEMS)
+        v = duty_get_ticks(line);
+    else if (line<(DUTY_SUBSYSTEMS+POWER_MODES))
+        v = power_get_ticks(line-DUTY_SUBSYSTEMS);
+    else
+    {
+        line -= DUTY_SUBSYSTEMS+POWER_MODES;
+        v = duty_get_max(line);
+        s[1] = '^';
+    }
+
+    s[0] = duty_names[line];
+    for (i=0;i<8;i++) s[2+i] = h2c((unsigned int)(v>>(28-4*i)));
+    s[10] = '\r';
+    s[11] = '\n';
+    s[12] = '\0';
+    return 0;
+    #else
+    return -1;
+    #endif
+}
@@ -0,0 +1,61 @@
+/**
+ *
+ * duty cycle (cpu awake time) accounting module header
+ *
+ **/
+
+#ifndef __DUTY_H__
+#define __DUTY_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// set 1 to count cpu active time per subsystem and power mode (diagnostic builds,
+// make DEFINES="-DDUTY_ACCT=1", counters take 50 bytes of ram)
+#ifndef DUTY_ACCT
+#define DUTY_ACCT 0
+#endif
+
+// accounted subsystems
+typedef enum {
+    DUTY_TIMER, // Timer_A isr (rtc + dcf77_strobe)
+    DUTY_UART_RX, // USCI RX isr
+    DUTY_UART_TX, // USCI TX isr
+    DUTY_BUTTON, // Port_1 isr
+    DUTY_LCD, // lcd writes
+    DUTY_MAIN, // main loop body (without the above)
+    DUTY_SUBSYSTEMS
+} duty_subsystem_type;
+
+// counting frequency (Timer1_A, SMCLK/8)
+#define DUTY_TICK_FREQV 1000000
+
+#if DUTY_ACCT
+// section start stamp
+typedef struct {
+    uint16_t start; // timer value at section begin
+    uint16_t nested; // accounted time at section begin
+} duty_stamp;
+
+// use inside isr
+#define DUTY_BEGIN(stamp) duty_stamp stamp; duty_begin(&stamp);
+#define DUTY_END(sub,stamp) duty_end(sub,&stamp);
+// use outside isr (interrupts enabled)
+#define DUTY_BEGIN_MAIN(stamp) duty_stamp stamp; __disable_interrupt(); duty_begin(&stamp); __enable_interrupt();
+#define DUTY_END_MAIN(sub,stamp) __disable_interrupt(); duty_end(sub,&stamp); __enable_interrupt();
+
+void duty_begin(duty_stamp *stamp);
+void duty_end(duty_subsystem_type sub, duty_stamp *stamp);
+#else
+#define DUTY_BEGIN(stamp)
+#define DUTY_END(sub,stamp)
+#define DUTY_BEGIN_MAIN(stamp)
+#define DUTY_END_MAIN(sub,stamp)
+#endif
+
+void duty_init(void); // start timer
+uint32_t duty_get_ticks(duty_subsystem_type sub); // awake ticks of subsystem
+uint16_t duty_get_max(duty_subsystem_type sub); // worst case section duration (ticks)
+int duty_report(int line, char *s, int len); // format one report line (returns -1 after last line)
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ *
+ * event queue module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * every event has one pending flag (posting the same event twice before
+ * it's processed does it only once) and optional countdown timer for
+ * delayed posting, counted in rtc timer ticks
+ *
+ * isr posts an event and wakes main loop, main loop takes pending events
+ * one by one in priority order and sleeps when there is nothing to do
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "power.h"
+#include "event.h" // self
+
+// pending events (bit mask)
+volatile uint8_t event_flags = 0;
+// delayed events (bit mask of running timers and the timers)
+volatile uint8_t event_timer_flags = 0;
+uint16_t event_timer[EVENT_COUNT];
+
+// post event (isr)
+void event_post(event_type ev)
+{
+    event_flags |= (1<<ev);
+}
+
+// post event after given number of rtc timer ticks (main loop, 0 .. post it now)
+void event_post_delayed(event_type ev, uint16_t ticks)
+{
+    __disable_interrupt();
+    if (ticks==0)
+    {
+        event_flags |= (1<<ev);
+    }
+    else
+    {
+        event_timer[ev] = ticks;
+        event_timer_flags |= (1<<ev);
+    }
+    __enable_interrupt();
+}
+
+// cancel event (both pending and delayed, main loop)
+void event_cancel(event_type ev)
+{
+    __disable_interrupt();
+    event_flags &= ~(1<<ev);
+    event_timer_flags &= ~(1<<ev);
+    __enable_interrupt();
+}
+
+// test if any event pending
+bool event_pending(void)
+{
+    return (event_flags!=0);
+}
+
+// count down delayed events (rtc timer isr)
+bool event_tick(void)
+{
+    uint8_t m = event_timer_flags;
+    bool posted = false;
+    int i;
+
+    for (i=0;m!=0;i++,m>>=1)
+    {
+        if ((m&0x01)==0) continue;
+        if (--event_timer[i]==0)
+        {
+            event_timer_flags &= ~(1<<i);
+            event_flags |= (1<<i);
+            posted = true;
+        }
+    }
+    return posted;
+}
+
+// take pending event with the highest priority (interrupts disabled, EVENT_NONE if none)
+event_type event_first(void)
+{
+    uint8_t f = event_flags;
+    event_type ev = 0;
+    if (f==0) return EVENT_NONE;
+    while ((f&0x01)==0) {f>>=1;ev++;}
+    event_flags &= ~(1<<ev);
+    return ev;
+}
+
+// take pending event with the highest priority (EVENT_NONE if there is none)
+event_type event_take(void)
+{
+    __disable_interrupt();
+    event_type ev = event_first();
+    __enable_interrupt();
+    return ev;
+}
+
+// take pending event with the highest priority (sleep while there is none)
+event_type event_wait(void)
+{
+    while (1)
+    {
+        __disable_interrupt(); // no event between test and sleep
+        event_type ev = event_first();
+        if (ev!=EVENT_NONE)
+        {
+            __enable_interrupt();
+            return ev;
+        }
+        power_sleep(); // enters sleep with interrupts enabled
+    }
+}
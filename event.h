@@ -0,0 +1,33 @@
+/**
+ *
+ * event queue module header
+ *
+ **/
+
+#ifndef __EVENT_H__
+#define __EVENT_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// events (lower number .. higher priority, max. 8 events)
+typedef enum {
+    EVENT_SYMBOL, // dcf77 symbol detected
+    EVENT_SECOND, // rtc second passed (or time set)
+    EVENT_BUTTON, // button pressed
+    EVENT_UART, // uart command received
+    EVENT_REPORT, // next line of uart report
+    EVENT_BUS, // bus reply slot
+    EVENT_COUNT,
+    EVENT_NONE = EVENT_COUNT
+} event_type;
+
+void event_post(event_type ev); // post event (isr only)
+void event_post_delayed(event_type ev, uint16_t ticks); // post event after ticks of rtc timer (main loop)
+void event_cancel(event_type ev); // cancel pending and delayed event (main loop)
+bool event_pending(void); // any event pending (use in isr to decide about wakeup)
+bool event_tick(void); // delayed events timing (call from rtc timer isr), true if some event posted
+event_type event_take(void); // pending event with the highest priority (EVENT_NONE if none, no sleep)
+event_type event_wait(void); // wait (sleep) for event with the highest priority
+
+#endif
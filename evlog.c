@@ -0,0 +1,59 @@
+/**
+ *
+ * event log module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * circular log of synchronization events in ram (the oldest entry is
+ * overwritten), time stamped by rtc time of day with 2s resolution
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "rtc.h"
+#include "uart.h"
+#include "evlog.h" // self
+
+#define EVLOG_MASK (EVLOG_LEN-1)
+
+evlog_entry evlog[EVLOG_LEN];
+uint8_t evlog_head = 0; // next entry to write
+uint8_t evlog_count = 0; // valid entries
+
+// add entry
+void evlog_add(evlog_type type, uint8_t arg)
+{
+    tstruct t;
+    rtc_get_time(&t);
+    evlog[evlog_head].stamp = ((uint16_t)(t.hour*60+t.minute)<<5)|(t.second>>1);
+    evlog[evlog_head].type = type;
+    evlog[evlog_head].arg = arg;
+    evlog_head = (evlog_head+1)&EVLOG_MASK;
+    if (evlog_count<EVLOG_LEN) evlog_count++;
+}
+
+// format entry "hhmmss T AA\r\n" (time, type, argument in hex), the oldest first
+int evlog_report(int line, char *s, int len)
+{
+    if ((line>=evlog_count)||(len<14)) return -1;
+    evlog_entry *e = &evlog[(evlog_head-evlog_count+line)&EVLOG_MASK];
+    uint16_t m = e->stamp>>5;
+    uint8_t sec = (e->stamp&0x1F)<<1;
+    s[0] = h2c(m/600);
+    s[1] = h2c(m/60%10);
+    s[2] = h2c(m%60/10);
+    s[3] = h2c(m%10);
+    s[4] = h2c(sec/10);
+    s[5] = h2c(sec%10);
+    s[6] = ' ';
+    s[7] = h2c(e->type);
+    s[8] = ' ';
+    s[9] = h2c(e->arg>>4);
+    s[10] = h2c(e->arg);
+    s[11] = '\r';
+    s[12] = '\n';
+    s[13] = '\0';
+    return 0;
+}
@@ -0,0 +1,39 @@
+/**
+ *
+ * event log module header
+ *
+ **/
+
+#ifndef __EVLOG_H__
+#define __EVLOG_H__
+
+#include <inttypes.h>
+
+// log length (entries, power of 2, 4 bytes each)
+#ifndef EVLOG_LEN
+#define EVLOG_LEN 8
+#endif
+
+// logged events (argument meaning)
+typedef enum {
+    EVLOG_MODE, // sync. mode change (new mode)
+    EVLOG_DECODE_OK, // minute block decoded (0)
+    EVLOG_DECODE_FAIL, // minute block decoding failed (reason)
+    EVLOG_CORRECTION, // rtc corrected by dcf77 (offset in ticks, int8 saturated)
+    EVLOG_HOLD, // hold over finished (duration in seconds/2, saturated)
+    EVLOG_QUALITY, // minute signal quality summary (mean quality in %)
+    EVLOG_RESET, // device reset (0 .. cold start, 1 .. warm start)
+    EVLOG_LINK // rtc corrected by time link master (offset in ticks, int8 saturated)
+} evlog_type;
+
+// log entry
+typedef struct {
+    uint16_t stamp; // minute of day (bits 5..15), second/2 (bits 0..4)
+    uint8_t type; // evlog_type
+    uint8_t arg; // argument
+} evlog_entry;
+
+void evlog_add(evlog_type type, uint8_t arg); // add entry (main loop only)
+int evlog_report(int line, char *s, int len); // format one entry, oldest first (returns -1 after last one)
+
+#endif
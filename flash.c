@@ -0,0 +1,58 @@
+/**
+ *
+ * flash (information memory) module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * erase and write of information memory segments B, C, D
+ *
+ * cpu is held while flash controller erases (~12ms) or writes, no interrupt
+ * can run meanwhile (vectors and isrs are in flash too), so the rtc ticks
+ * lost during the hold are added afterwards (rtc_hold_end), uart chars
+ * received meanwhile overrun the rx buffer, uart drops such line
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "rtc.h"
+#include "flash.h" // self
+
+// flash timing generator: MCLK/20 = 400kHz (8MHz DCO, 257..476kHz required)
+#define FLASH_CLOCK (FSSEL_1+FN4+FN1+FN0)
+
+// scratch segment (aligned whole segment in code memory, contents erased before use)
+const uint8_t flash_scratch[FLASH_MAIN_SEGMENT_SIZE]
+    __attribute__((section(".text.flash_scratch"),aligned(FLASH_MAIN_SEGMENT_SIZE))) = {0xFF};
+
+// erase segment
+void flash_erase(uint8_t *segment)
+{
+    __disable_interrupt();
+    uint16_t stamp = rtc_get_stamp();
+    FCTL2 = FWKEY + FLASH_CLOCK;
+    FCTL3 = FWKEY; // unlock (LOCKA unchanged)
+    FCTL1 = FWKEY + ERASE; // segment erase
+    *segment = 0; // dummy write starts erase
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY + LOCK; // lock
+    rtc_hold_end(stamp,FLASH_ERASE_US);
+    __enable_interrupt();
+}
+
+// write data into (erased) flash
+void flash_write(uint8_t *dst, const uint8_t *src, int len)
+{
+    int i;
+    __disable_interrupt();
+    uint16_t stamp = rtc_get_stamp();
+    FCTL2 = FWKEY + FLASH_CLOCK;
+    FCTL3 = FWKEY; // unlock
+    FCTL1 = FWKEY + WRT; // byte write
+    for (i=0;i<len;i++) dst[i] = src[i];
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY + LOCK; // lock
+    rtc_hold_end(stamp,len*FLASH_BYTE_US);
+    __enable_interrupt();
+}
@@ -0,0 +1,34 @@
+/**
+ *
+ * flash (information memory) module header
+ *
+ **/
+
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include <inttypes.h>
+
+// information memory segments (64 bytes each, segment A holds calibration data - never use it)
+#define FLASH_SEGMENT_SIZE 64
+#ifndef FLASH_INFO
+#define FLASH_INFO ((uint8_t*)0x1000) // information memory start (segment D, host build has its own)
+#endif
+#define FLASH_INFO_B (FLASH_INFO+0x80)
+#define FLASH_INFO_C (FLASH_INFO+0x40)
+#define FLASH_INFO_D (FLASH_INFO)
+// main memory segment reserved as scratch (information segment rewrites without ram copy)
+#define FLASH_MAIN_SEGMENT_SIZE 512
+#ifndef FLASH_SCRATCH
+extern const uint8_t flash_scratch[FLASH_MAIN_SEGMENT_SIZE];
+#define FLASH_SCRATCH ((uint8_t*)flash_scratch)
+#endif
+
+// cpu hold time (flash timing generator 400kHz, segment erase 4819 and byte write 30 cycles)
+#define FLASH_ERASE_US 12048
+#define FLASH_BYTE_US 75
+
+void flash_erase(uint8_t *segment); // erase segment
+void flash_write(uint8_t *dst, const uint8_t *src, int len); // write erased flash
+
+#endif
@@ -0,0 +1,473 @@
+/**
+ *
+ * host build bit-sliced batch receiver (many traces, one instruction stream)
+ *
+ * firmware symbol detectors (early/late votes build, DCF77_PLL 0) run over BATCH_LANES
+ * traces at once, every lane with its own parameters (fixed or adaptive threshold,
+ * detectors offset, votes to shift), high samples counters are bit-sliced (plane i of
+ * a counter holds bit i of all lanes) and window ends are lane masks in a calendar of
+ * ticks, so one tick of all lanes is a few vector operations, the rest is per lane once
+ * per second (symbol from window counts, threshold update, votes and shifts, minute
+ * memory, firmware decoder)
+ *
+ * it's bit exact with firmware functions (dcf77_detect, dcf77_adapt_update,
+ * dcf77_finetune and dcf77_symbol_memory run by batch_reference), traces are aligned
+ * by the coarse acquisition first (batch_align, histogram and gate of dcf77_coarse),
+ * then lanes stay in fine sync. (no hold over and coarse sync. again), the shipped
+ * pll build (DCF77_PLL 1) isn't modelled, its receiver runs in noise and fleet
+ *
+ **/
+
+#include <string.h>
+#include <math.h>
+#include "hw.h"
+#include "signal.h"
+#include "batch.h"
+
+// detector timing (as dcf77.c, window lengths follow start offset and shifts there)
+#define BATCH_PERIOD RTC_SAMPLING_FREQV
+#define BATCH_S0 (RTC_SAMPLING_FREQV/10)
+#define BATCH_S1 (RTC_SAMPLING_FREQV/5)
+#define BATCH_SHIFT 1 // DCF77_FINETUNE_SHIFT
+// coarse acquisition (as dcf77.c)
+#define BATCH_BINS 32 // DCF77_COARSE_BINS
+#define BATCH_BIN_TICKS (BATCH_PERIOD/BATCH_BINS)
+#define BATCH_BIN_MAX 15 // DCF77_COARSE_BIN_MAX
+#define BATCH_ACQ_SECONDS 5 // DCF77_COARSE_SECONDS
+#define BATCH_ACQ_MIN_HITS 4 // DCF77_COARSE_MIN_HITS
+#define BATCH_FILTER_N 5 // edges of the default input filter output (DCF77_FILTER_MAJORITY)
+#define BATCH_FILTER_K 3
+// adaptive threshold lanes (firmware functions, not in the fixed threshold build)
+#if defined(DCF77_ADAPTIVE_THRESHOLD)&&!DCF77_ADAPTIVE_THRESHOLD
+#define BATCH_ADAPTIVE 0
+#else
+#define BATCH_ADAPTIVE 1
+#endif
+
+// firmware decoder and its state (fw_fine.o)
+dcf77_decode_result dcf77_decode_frame(uint16_t *data, uint16_t *valid, tstruct *t);
+extern uint16_t stats_decodes[];
+extern uint16_t dcf77_symbol_tick;
+
+/** bit-sliced counters **/
+
+static inline bool batch_any(batch_vec v)
+{
+    int i;
+    uint64_t a = 0;
+    for (i=0;i<BATCH_WORDS;i++) a |= v[i];
+    return a!=0;
+}
+
+// counter +1 in lanes of m (carry stops early, counters don't overflow)
+static inline void batch_inc(batch_vec *c, batch_vec m)
+{
+    int i;
+    for (i=0;(i<BATCH_BITS)&&batch_any(m);i++)
+    {
+        batch_vec carry = c[i]&m;
+        c[i] ^= m;
+        m = carry;
+    }
+}
+
+// one lane counter
+static int batch_get(const batch_vec *c, int lane)
+{
+    int i, v = 0;
+    for (i=0;i<BATCH_BITS;i++) v |= (int)((c[i][lane>>6]>>(lane&63))&1)<<i;
+    return v;
+}
+
+static uint32_t batch_hash(uint32_t h, uint32_t v)
+{
+    return (h^v)*16777619u;
+}
+
+/** per lane (once per second) **/
+
+// lane threshold (fixed or adaptive one)
+static inline int batch_thr(const batch_state *b, int lane)
+{
+    return b->param[lane].thr?b->param[lane].thr:b->adapt[lane].thr;
+}
+
+// period end, symbol from window counts (dcf77_detect)
+static void batch_symbol(batch_detector *det, int lane, int thr)
+{
+    int high0 = batch_get(det->high[0],lane), high1 = batch_get(det->high[1],lane);
+    int low0 = det->len0[lane]-high0;
+    int low1 = (BATCH_S1-BATCH_S0)-high1;
+    int16_t *q = det->match[lane];
+    int symI = 0, symQ;
+    q[0] = high0+low1;
+    q[1] = high0+high1;
+    q[2] = low0+low1;
+    symQ = q[0];
+    if (q[1]>symQ) {symQ=q[1];symI=1;}
+    if (q[2]>symQ) {symQ=q[2];symI=2;}
+    det->sigQ[lane] = (BATCH_PERIOD-BATCH_S1)-batch_get(det->cnt,lane)+symQ;
+    det->sym[lane] = (det->sigQ[lane]>=thr)?symI+1:DCF77_SYMBOL_NONE;
+}
+
+#if BATCH_ADAPTIVE
+// threshold update by the now detector symbol (dcf77_adapt_update)
+static void batch_adapt(batch_state *b, int lane)
+{
+    dcf77_detector_context c;
+    const int16_t *q = b->detector[1].match[lane];
+    memset(&c,0,sizeof(c));
+    c.s0cnt = q[0];
+    c.s1cnt = q[1];
+    c.sMcnt = q[2];
+    c.sigQ = b->detector[1].sigQ[lane];
+    c.sym = b->detector[1].sym[lane];
+    dcf77_adapt_update(&b->adapt[lane],&c);
+    b->result[lane].thr = b->adapt[lane].thr;
+}
+#endif
+
+// minute memory and decoding (dcf77_symbol_memory)
+static void batch_memory(batch_minute *m, batch_result *r, dcf77_symbol_type symbol)
+{
+    if (symbol==DCF77_SYMBOL_1) m->data[m->dcnt]|=m->mask;
+    if (symbol==DCF77_SYMBOL_NONE) m->valid[m->dcnt]|=m->mask;
+    m->mask<<=1;
+    if (m->mask==0) {m->dcnt++;m->mask=1;}
+    m->cnt++;
+
+    if ((m->cnt==60)||(symbol==DCF77_SYMBOL_MINUTE))
+    {
+        dcf77_decode_result res = DCF77_DECODE_LENGTH;
+        tstruct t;
+        if ((m->cnt==60)&&((symbol==DCF77_SYMBOL_MINUTE)||(symbol==DCF77_SYMBOL_NONE)))
+        {
+            res = dcf77_decode_frame(m->data,m->valid,&t);
+            if (res==DCF77_DECODE_OK) r->time = t;
+        }
+        r->decodes[res]++;
+        memset(m,0,sizeof(batch_minute));
+        m->mask = 1;
+    }
+}
+
+// early/late votes (dcf77_finetune), returns shift
+static int batch_votes(batch_state *b, int lane)
+{
+    int *ft = &b->result[lane].ft, symcount = b->param[lane].symcount;
+    int q0 = b->detector[0].sigQ[lane], q1 = b->detector[1].sigQ[lane], q2 = b->detector[2].sigQ[lane];
+    if ((q0>=q1)&&(q0>=q2))
+    {
+        if (--(*ft)<-symcount) {*ft=0;return BATCH_SHIFT;}
+    }
+    else if ((q2>q1)&&(q2>q0))
+    {
+        if (++(*ft)>symcount) {*ft=0;return -BATCH_SHIFT;}
+    }
+    return 0;
+}
+
+// shift lane detectors (first window end, the later detector has just started it)
+static void batch_shift(batch_state *b, int lane, int shift)
+{
+    int d;
+    uint64_t bit = 1ULL<<(lane&63);
+    for (d=0;d<BATCH_DETECTORS;d++)
+    {
+        batch_detector *det = &b->detector[d];
+        det->end[det->end0[lane]][lane>>6] &= ~bit;
+        det->end0[lane] = (det->end0[lane]-shift)&(BATCH_SLOTS-1);
+        det->end[det->end0[lane]][lane>>6] |= bit;
+        det->len0[lane] -= shift;
+    }
+    b->result[lane].shifts++;
+    b->result[lane].hash = batch_hash(batch_hash(b->result[lane].hash,b->tick),0x80000000u|(uint16_t)shift);
+}
+
+// lanes of mask (lane index to l)
+#define BATCH_FOR_LANES(mask,l) \
+    for (int _i=0;_i<BATCH_WORDS;_i++) \
+        for (uint64_t _m=(mask)[_i];_m&&((l=_i*64+__builtin_ctzll(_m)),1);_m&=_m-1)
+
+/** engine **/
+
+// one sample of all lanes
+static void batch_tick(batch_state *b, const batch_vec *sig)
+{
+    static const batch_vec none;
+    batch_vec ended[BATCH_DETECTORS];
+    int slot = b->tick&(BATCH_SLOTS-1), d, l, i;
+
+    for (d=0;d<BATCH_DETECTORS;d++)
+    {
+        batch_detector *det = &b->detector[d];
+        // count high samples, lanes with window end
+        batch_inc(det->cnt,*sig);
+        batch_vec z = det->end[slot];
+        ended[d] = z&det->win[2];
+        if (!batch_any(z)) continue;
+        det->end[slot] = none;
+
+        // next window, period end (symbol, next period)
+        batch_vec e0 = z&det->win[0], e1 = z&det->win[1];
+        for (i=0;i<BATCH_BITS;i++)
+        {
+            det->high[0][i] = (det->high[0][i]&~e0)|(det->cnt[i]&e0);
+            det->high[1][i] = (det->high[1][i]&~e1)|(det->cnt[i]&e1);
+        }
+        det->win[0] = (det->win[0]&~e0)|ended[d];
+        det->win[1] = (det->win[1]&~e1)|e0;
+        det->win[2] = (det->win[2]&~ended[d])|e1;
+        det->end[(slot+BATCH_S1-BATCH_S0)&(BATCH_SLOTS-1)] |= e0;
+        det->end[(slot+BATCH_PERIOD-BATCH_S1)&(BATCH_SLOTS-1)] |= e1;
+        if (batch_any(ended[d]))
+        {
+            BATCH_FOR_LANES(ended[d],l)
+            {
+                batch_symbol(det,l,batch_thr(b,l));
+                det->len0[l] = BATCH_S0;
+                det->end0[l] = (slot+BATCH_S0)&(BATCH_SLOTS-1);
+            }
+            det->end[(slot+BATCH_S0)&(BATCH_SLOTS-1)] |= ended[d];
+        }
+        for (i=0;i<BATCH_BITS;i++) det->cnt[i] &= ~z;
+    }
+
+    // symbols of now detector, votes when the later one is ready
+    BATCH_FOR_LANES(ended[1],l)
+    {
+        batch_result *r = &b->result[l];
+        dcf77_symbol_type sym = b->detector[1].sym[l];
+        #if BATCH_ADAPTIVE
+        if (b->param[l].thr==0) batch_adapt(b,l);
+        #endif
+        r->symbols[sym]++;
+        r->hash = batch_hash(batch_hash(r->hash,b->tick),((uint32_t)sym<<16)|(uint16_t)b->detector[1].sigQ[l]);
+        batch_memory(&b->minute[l],r,sym);
+    }
+    BATCH_FOR_LANES(ended[2],l)
+    {
+        int shift = batch_votes(b,l);
+        if (shift!=0) batch_shift(b,l,shift);
+    }
+    b->tick++;
+}
+
+// 64x64 bit matrix transpose (bit j of a[i] to bit i of a[j])
+static void batch_transpose(uint64_t a[64])
+{
+    int j, k;
+    uint64_t m = 0x00000000FFFFFFFFULL, t;
+    for (j=32;j!=0;j>>=1,m^=m<<j)
+    {
+        for (k=0;k<64;k=((k|j)+1)&~j)
+        {
+            t = ((a[k]>>j)^a[k|j])&m;
+            a[k] ^= t<<j;
+            a[k|j] ^= t;
+        }
+    }
+}
+
+int batch_init(batch_state *b, const batch_param *param, int lanes)
+{
+    int l, d;
+    if ((lanes<1)||(lanes>BATCH_LANES)) return -1;
+    memset(b,0,sizeof(batch_state));
+    b->lanes = lanes;
+    for (l=0;l<lanes;l++)
+    {
+        const batch_param *p = &param[l];
+        // shifts have to stay inside the first detector window (dcf77.c #error)
+        if ((p->offset<0)||((2*p->offset+BATCH_SHIFT+1)>=BATCH_S0)||(p->symcount<0)) return -1;
+        if ((p->thr<0)||((p->thr==0)&&!BATCH_ADAPTIVE)) return -1;
+        b->param[l] = *p;
+        b->active[l>>6] |= 1ULL<<(l&63);
+        b->minute[l].mask = 1;
+        b->result[l].hash = 2166136261u;
+        #if BATCH_ADAPTIVE
+        dcf77_adapt_init(&b->adapt[l]);
+        #endif
+        b->result[l].thr = batch_thr(b,l);
+        // detectors period start (dcf77_reset_context with +offset, 0, -offset)
+        for (d=0;d<BATCH_DETECTORS;d++)
+        {
+            batch_detector *det = &b->detector[d];
+            det->len0[l] = BATCH_S0-(1-d)*p->offset;
+            det->end0[l] = det->len0[l]-1;
+            det->end[det->end0[l]][l>>6] |= 1ULL<<(l&63);
+        }
+    }
+    for (d=0;d<BATCH_DETECTORS;d++) b->detector[d].win[0] = b->active;
+    return 0;
+}
+
+void batch_run(batch_state *b, const uint64_t *const *trace, long ticks)
+{
+    static uint64_t block[BATCH_WORDS][64];
+    long k;
+    int i, l, n;
+    for (k=0;k<ticks;k+=64)
+    {
+        // 64 ticks of all lanes, transposed to a lane bit per tick
+        for (i=0;i<BATCH_WORDS;i++)
+        {
+            for (l=0;l<64;l++)
+                block[i][l] = ((i*64+l)<b->lanes)?trace[i*64+l][k>>6]:0;
+            batch_transpose(block[i]);
+        }
+        n = (ticks-k<64)?ticks-k:64;
+        for (l=0;l<n;l++)
+        {
+            batch_vec sig;
+            for (i=0;i<BATCH_WORDS;i++) sig[i] = block[i][l];
+            batch_tick(b,&sig);
+        }
+    }
+}
+
+void batch_reference(const batch_param *param, const uint64_t *trace, long ticks, batch_result *r)
+{
+    dcf77_detector_context det[BATCH_DETECTORS];
+    dcf77_adapt_state a;
+    long k;
+    int i, thr = param->thr;
+
+    hw_init();
+    main_init();
+    memset(det,0,sizeof(det));
+    memset(r,0,sizeof(batch_result));
+    r->hash = 2166136261u;
+    #if BATCH_ADAPTIVE
+    dcf77_adapt_init(&a);
+    if (thr==0) thr = a.thr;
+    #endif
+    dcf77_reset_context(&det[0],+param->offset);
+    dcf77_reset_context(&det[1],0);
+    dcf77_reset_context(&det[2],-param->offset);
+    for (k=0;k<ticks;k++)
+    {
+        bool s = (trace[k>>6]>>(k&63))&1;
+        for (i=0;i<BATCH_DETECTORS;i++) dcf77_detect(&det[i],s,thr);
+        if (det[1].ready)
+        {
+            #if BATCH_ADAPTIVE
+            if (param->thr==0)
+            {
+                dcf77_adapt_update(&a,&det[1]);
+                thr = a.thr;
+            }
+            #endif
+            uint16_t ok = stats_decodes[DCF77_DECODE_OK];
+            r->symbols[det[1].sym]++;
+            r->hash = batch_hash(batch_hash(r->hash,k),((uint32_t)det[1].sym<<16)|(uint16_t)det[1].sigQ);
+            dcf77_symbol_tick = rtc_get_ticks();
+            dcf77_symbol_memory(det[1].sym);
+            if (stats_decodes[DCF77_DECODE_OK]!=ok) rtc_get_time(&r->time);
+        }
+        if (det[2].ready)
+        {
+            int shift = dcf77_finetune(det,&r->ft,param->symcount);
+            if (shift!=0)
+            {
+                // as dcf77_shift
+                for (i=0;i<BATCH_DETECTORS;i++) det[i].cnt += shift;
+                r->shifts++;
+                r->hash = batch_hash(batch_hash(r->hash,k),0x80000000u|(uint16_t)shift);
+            }
+        }
+    }
+    for (i=DCF77_DECODE_OK;i<=DCF77_DECODE_RANGE;i++) r->decodes[i] = stats_decodes[i];
+    r->thr = thr;
+}
+
+bool batch_equal(const batch_result *a, const batch_result *b)
+{
+    return (a->hash==b->hash)&&(a->ft==b->ft)&&(a->shifts==b->shifts)&&(a->thr==b->thr)&&
+        (memcmp(a->symbols,b->symbols,sizeof(a->symbols))==0)&&(memcmp(a->decodes,b->decodes,sizeof(a->decodes))==0)&&
+        (a->time.minute==b->time.minute)&&(a->time.hour==b->time.hour)&&(a->time.dayow==b->time.dayow);
+}
+
+void batch_trace(uint64_t *trace, long ticks, uint32_t seed, double noise, double ppm, double second)
+{
+    signal_type s;
+    long k;
+    signal_init(&s,2,10,0,second,seed?seed:1);
+    s.noise = noise;
+    memset(trace,0,((ticks+63)/64)*sizeof(uint64_t));
+    for (k=0;k<ticks;k++)
+        if (signal_input(&s,k*(1.0+ppm*1e-6)/RTC_SAMPLING_FREQV)) trace[k>>6] |= 1ULL<<(k&63);
+}
+
+static inline bool batch_sample(const uint64_t *trace, long k)
+{
+    return (k>=0)&&((trace[k>>6]>>(k&63))&1);
+}
+
+// rising edges phase histogram of the majority filtered trace, evaluated every
+// BATCH_ACQ_SECONDS (peak of two neighbour bins, twice the biggest one not overlapping
+// it, aged when not significant), the detectors see the trace itself, so the second
+// mark is the filtered edge less the filter delay
+long batch_acquire(const uint64_t *trace, long ticks)
+{
+    uint8_t hist[BATCH_BINS];
+    int gate = -1, i, cnt = 0;
+    bool out = false;
+    long k;
+
+    memset(hist,0,sizeof(hist));
+    for (k=0;k<ticks;k++)
+    {
+        int bin = (k%BATCH_PERIOD)/BATCH_BIN_TICKS;
+        bool edge = false;
+        cnt += batch_sample(trace,k)-batch_sample(trace,k-BATCH_FILTER_N);
+        if ((cnt>=BATCH_FILTER_K)&&!out) out = edge = true;
+        else if (cnt<=(BATCH_FILTER_N-BATCH_FILTER_K)) out = false;
+        if (edge)
+        {
+            if (gate<0)
+            {
+                if (hist[bin]<BATCH_BIN_MAX) hist[bin]++;
+            }
+            else if (((bin==gate)||(bin==((gate+1)&(BATCH_BINS-1))))&&(k>=BATCH_FILTER_N-BATCH_FILTER_K))
+                return k-(BATCH_FILTER_N-BATCH_FILTER_K);
+        }
+        if ((gate<0)&&(((k+1)%(BATCH_ACQ_SECONDS*BATCH_PERIOD))==0))
+        {
+            int best = 0, bi = 0, second = 0;
+            for (i=0;i<BATCH_BINS;i++)
+            {
+                int sum = hist[i]+hist[(i+1)&(BATCH_BINS-1)];
+                if (sum>best) {best=sum;bi=i;}
+            }
+            for (i=0;i<BATCH_BINS;i++)
+            {
+                int sum = hist[i]+hist[(i+1)&(BATCH_BINS-1)];
+                int d = (i-bi)&(BATCH_BINS-1);
+                if ((d>1)&&(d<(BATCH_BINS-1))&&(sum>second)) second=sum;
+            }
+            if ((best>=BATCH_ACQ_MIN_HITS)&&(best>=(2*second))) gate = bi;
+            else for (i=0;i<BATCH_BINS;i++) hist[i] >>= 1;
+        }
+    }
+    return -1;
+}
+
+long batch_align(uint64_t *trace, long ticks, long limit)
+{
+    long start = batch_acquire(trace,(limit<ticks)?limit:ticks), words, w, k;
+    int sh;
+    if (start<0) return -1;
+    ticks -= start;
+    words = (ticks+63)/64;
+    w = start>>6;
+    sh = start&63;
+    for (k=0;k<words;k++)
+    {
+        uint64_t v = trace[w+k]>>sh;
+        if ((sh!=0)&&(((w+k+1)*64)<(start+ticks))) v |= trace[w+k+1]<<(64-sh);
+        trace[k] = v;
+    }
+    if (ticks&63) trace[words-1] &= (1ULL<<(ticks&63))-1;
+    return ticks;
+}
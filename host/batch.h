@@ -0,0 +1,90 @@
+/**
+ *
+ * host build bit-sliced batch receiver header
+ *
+ **/
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "rtc.h"
+#include "dcf77.h"
+
+// traces (lanes) advanced by one instruction stream, lane is one bit of vector (gcc
+// vector extensions, one avx2 register with -mavx2, two sse2 ones otherwise)
+#define BATCH_LANES 256
+#define BATCH_WORDS (BATCH_LANES/64)
+typedef uint64_t batch_vec __attribute__((vector_size(BATCH_LANES/8)));
+#define BATCH_BITS 10 // bit-sliced counters (high samples in window)
+#define BATCH_DETECTORS 3 // sooner, now, later (early/late votes)
+#define BATCH_WINDOWS 3 // symbol 0 pulse, symbol 1 pulse, rest (signal quality)
+
+// lane parameters (firmware build time ones, different in every lane for sweeps)
+typedef struct {
+    int thr; // signal quality threshold (DCF77_MIN_SIGNAL_QUALITY, 0 .. adaptive one)
+    int offset; // sooner and later detectors offset (DCF77_FINESYNC_OFFSET)
+    int symcount; // early/late votes to shift (DCF77_FINETUNE_SYMCOUNT)
+} batch_param;
+
+// lane results
+typedef struct {
+    uint16_t symbols[DCF77_SYMBOL_MINUTE+1]; // detected symbols
+    uint16_t decodes[DCF77_DECODE_RANGE+1]; // decoder results
+    uint16_t shifts; // fine sync. shifts
+    int ft; // early/late votes
+    int thr; // signal quality threshold at the end
+    tstruct time; // last decoded time
+    uint32_t hash; // symbols (tick, symbol, signal quality) and shifts in order
+} batch_result;
+
+// bit-sliced detector (counters are arrays of bit planes, plane i holds bit i of all lanes),
+// window ends are lane masks in calendar of ticks (shift moves the lane in it)
+#define BATCH_SLOTS 512 // calendar length (power of 2, longer than any window)
+typedef struct {
+    batch_vec cnt[BATCH_BITS]; // high samples in current window
+    batch_vec high[BATCH_WINDOWS-1][BATCH_BITS]; // high samples in ended windows
+    batch_vec win[BATCH_WINDOWS]; // current window
+    batch_vec end[BATCH_SLOTS]; // lanes with current window end in tick
+    int16_t len0[BATCH_LANES]; // first window length (start offset and shifts)
+    uint16_t end0[BATCH_LANES]; // first window end (tick mod slots)
+    int16_t sigQ[BATCH_LANES]; // last symbol
+    int16_t match[BATCH_LANES][3]; // its matches (s0cnt, s1cnt, sMcnt)
+    uint8_t sym[BATCH_LANES];
+} batch_detector;
+
+// minute block memory of one lane
+typedef struct {
+    uint16_t data[4], valid[4];
+    uint8_t cnt, dcnt;
+    uint16_t mask;
+} batch_minute;
+
+typedef struct {
+    batch_detector detector[BATCH_DETECTORS];
+    batch_vec active; // used lanes
+    int lanes;
+    long tick;
+    batch_param param[BATCH_LANES];
+    batch_minute minute[BATCH_LANES];
+    dcf77_adapt_state adapt[BATCH_LANES]; // adaptive threshold lanes (firmware fixed point)
+    batch_result result[BATCH_LANES];
+} batch_state;
+
+// lanes start at detector period start (as after coarse sync., batch_align) and stay in fine sync.
+int batch_init(batch_state *b, const batch_param *param, int lanes); // -1 .. parameter out of range
+// samples of all lanes (trace[lane] bit k of word k/64 .. sample k), continues previous run
+void batch_run(batch_state *b, const uint64_t *const *trace, long ticks);
+// the same by firmware functions (one lane, fw_fine.o), reinitializes firmware
+void batch_reference(const batch_param *param, const uint64_t *trace, long ticks, batch_result *r);
+bool batch_equal(const batch_result *a, const batch_result *b); // lane results bit exact
+// synthetic trace (transmitter time second at the first sample, noise, crystal error ppm)
+void batch_trace(uint64_t *trace, long ticks, uint32_t seed, double noise, double ppm, double second);
+// coarse acquisition (as dcf77_coarse), tick of the first second mark in the locked gate (-1 .. none)
+long batch_acquire(const uint64_t *trace, long ticks);
+// trace moved to start at the second mark acquired within limit ticks (in place), returns
+// its ticks (-1 .. none)
+long batch_align(uint64_t *trace, long ticks, long limit);
+
+#endif
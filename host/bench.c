@@ -0,0 +1,178 @@
+/**
+ *
+ * per tick cost benchmark (host cpu cycles, reference and firmware receiver, whole timer isr)
+ *
+ * usage: bench [-m minutes]
+ *   -m .. simulated minutes per signal (default 10)
+ *
+ * for every signal (clean, impulse noise, no carrier) the same samples go to
+ * the detectors alone (ref_dcf77.c one and the firmware one, both count symbols
+ * every tick, the window table detector was slower and is gone) and to the whole
+ * receivers with minute memory (the firmware one also reads the port through the
+ * channel table and passes symbols through the slot), host cycles per tick of the
+ * loop over all samples, then every Timer_A isr call of the hardware model run is
+ * measured (mean, median, 99th percentile and maximum, timer overhead subtracted)
+ *
+ * host cycles are not msp430 ones (there is no msp430 toolchain for the host
+ * build), they compare versions on one machine
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <x86intrin.h>
+#include <msp430g2553.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "dcf77.h"
+#include "ref_dcf77.h"
+
+#define TICK_STEPS (HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV)
+#define HW_DCF77_PIN BIT5
+
+typedef struct {
+    uint32_t *c;
+    long n;
+} cycles_type;
+
+long ticks;
+uint64_t overhead, probe_start;
+cycles_type isr;
+
+// timestamp (ordered against the measured code)
+static inline uint64_t stamp(void)
+{
+    unsigned int aux;
+    _mm_lfence();
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+
+void add(cycles_type *c, uint64_t t)
+{
+    t = (t>overhead)?t-overhead:0;
+    if (c->n<ticks) c->c[c->n++] = (uint32_t)t;
+}
+
+int cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x>y)-(x<y);
+}
+
+void print(const char *name, cycles_type *c)
+{
+    long i;
+    double sum = 0;
+    for (i=0;i<c->n;i++) sum += c->c[i];
+    qsort(c->c,c->n,sizeof(uint32_t),cmp);
+    printf("  %-22s %6.1f  median %5u  p99 %5u  max %6u\n",name,
+        c->n?sum/c->n:0.0,c->c[c->n/2],c->c[c->n*99/100],c->c[c->n-1]);
+}
+
+// whole timer isr in model run
+void probe(void *ctx, bool end)
+{
+    if (!end) probe_start = stamp();
+    else add(&isr,stamp()-probe_start);
+}
+
+// samples of a signal (real time of tick k)
+void samples_of(uint8_t *x, double noise, bool outage)
+{
+    signal_type s;
+    long k;
+    signal_init(&s,2,10,0,0.37,7);
+    s.noise = noise;
+    if (outage) s.outage_to = 1e9;
+    for (k=0;k<ticks;k++) x[k] = signal_input(&s,(double)k/RTC_SAMPLING_FREQV);
+}
+
+// cycles per tick of a loop over all samples (the best of REPEAT runs)
+#define REPEAT 5
+#define LOOP(name,init,body) do { \
+    uint64_t best = ~0ULL; int r; \
+    for (r=0;r<REPEAT;r++) { \
+        init; \
+        uint64_t t = stamp(); \
+        for (k=0;k<ticks;k++) { body; } \
+        t = stamp()-t; \
+        if (t<best) best = t; \
+    } \
+    printf("  %-22s %6.1f\n",name,(double)best/ticks); \
+} while (0)
+
+void level(const char *name, double noise, bool outage)
+{
+    uint8_t *x = malloc(ticks);
+    ref_dcf77 ref;
+    dcf77_detector_context det;
+    long k;
+
+    printf("%s (cycles per tick)\n",name);
+    samples_of(x,noise,outage);
+
+    // detectors alone (free running, fixed threshold)
+    LOOP("detector reference",ref_init(&ref,0),ref_detect(&ref,x[k],RTC_SAMPLING_FREQV*9/10));
+    LOOP("detector firmware",dcf77_reset_context(&det,0),dcf77_detect(&det,x[k],RTC_SAMPLING_FREQV*9/10));
+
+    // receivers with minute memory (firmware one takes the symbol in main loop)
+    LOOP("receiver reference",ref_init(&ref,0),
+        if (ref_strobe(&ref,x[k])) ref_symbol(&ref,ref.detector.sym));
+    LOOP("receiver firmware",(hw_init(),main_init()),
+        P1IN = x[k]?(P1IN&~HW_DCF77_PIN):(P1IN|HW_DCF77_PIN);dcf77_strobe();dcf77_process());
+
+    // whole isr (rtc, receiver, buttons, uart), every call in model run
+    signal_type s;
+    signal_init(&s,2,10,0,0.37,7);
+    s.noise = noise;
+    if (outage) s.outage_to = 1e9;
+    isr.c = malloc(ticks*sizeof(uint32_t));
+    isr.n = 0;
+    hw_init();
+    hw_set_input(signal_input,&s);
+    hw_set_timer_probe(probe,0);
+    main_init();
+    for (k=0;k<ticks;k++) hw_run(TICK_STEPS);
+    hw_set_timer_probe(0,0);
+    print("timer isr",&isr);
+
+    free(isr.c);
+    free(x);
+}
+
+int main(int argc, char **argv)
+{
+    int minutes = 10, opt, i;
+    while ((opt=getopt(argc,argv,"m:"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'm': minutes = atoi(optarg); break;
+            default:
+                fprintf(stderr,"usage: bench [-m minutes]\n");
+                return 1;
+        }
+    }
+    ticks = (long)minutes*60*RTC_SAMPLING_FREQV;
+
+    // timer overhead (empty measurement, minimum)
+    overhead = ~0ULL;
+    for (i=0;i<10000;i++)
+    {
+        uint64_t t = stamp();
+        t = stamp()-t;
+        if (t<overhead) overhead = t;
+    }
+    printf("host cycles, %d minutes per signal, isr calls measured one by one (timer overhead %u subtracted)\n",
+        minutes,(unsigned int)overhead);
+
+    level("clean signal",0.0,false);
+    level("impulse noise 10%",0.1,false);
+    level("no carrier",0.0,true);
+    return 0;
+}
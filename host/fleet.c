@@ -0,0 +1,362 @@
+/**
+ *
+ * fleet simulator (many clocks, each one with its own signal and crystal)
+ *
+ * usage: fleet [-n clocks] [-d days] [-j workers] [-q minutes] [-s seed] [-o file]
+ *   -n .. clocks (default 64)
+ *   -d .. simulated days (default 1)
+ *   -j .. worker processes (default all cpus)
+ *   -q .. time slice (simulated minutes per task, default 60)
+ *   -s .. random seed (default 1)
+ *   -o .. per clock results (csv)
+ *
+ * every clock has random transmitter time, crystal error (+-30 ppm), receiver
+ * noise (0..8%) and one carrier outage (half of them, up to 2 hours)
+ *
+ * the firmware state is global, hwstate.c switches clocks by saving and
+ * loading it, so workers are processes (fork) and the clocks (state, signal,
+ * results) live in one shared mapping; a task is one clock for one time
+ * slice, every worker has its own deque of clocks, runs them from its bottom
+ * (the clock just run goes back there) and when it's empty it steals from
+ * the top of the others; results don't depend on workers and slices
+ *
+ * aggregate statistics over the clocks: time to the first decode, decodes
+ * per hour, time in each time quality, the largest time error while not
+ * unsynchronized and seconds it exceeded the error bound, recovery after the
+ * outage (carrier back to the next decode), uart output
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "dcf77.h"
+
+#define SECOND_STEPS (HW_ACLK/HW_STEP_CYCLES)
+
+extern bool treset; // rtc.c, time set, its second starts with the next tick
+
+// one clock (shared by all workers)
+typedef struct {
+    signal_type signal;
+    double ppm;
+    long seconds; // simulated
+    uint16_t last_decodes;
+    // results
+    double first_decode; // real time (s, -1 .. none)
+    double recovery; // outage end to the next decode (s, -1 .. none)
+    long decodes;
+    long quality_s[3]; // seconds in each rtc_quality_type
+    double max_err; // time error while not unsynchronized (ms)
+    long bound_exceeded; // seconds with the error above the bound
+    long uart_chars;
+} clock_type;
+
+// work stealing deque of clocks (items[top..bottom-1], owner end is the bottom)
+typedef struct {
+    char lock;
+    int top, bottom;
+    long tasks, steals;
+} deque_type;
+
+typedef struct {
+    int clocks, workers;
+    long seconds, slice; // per clock, per task
+    int remaining; // clocks not done yet
+    deque_type *deques;
+    int *items; // clocks of worker w at items[w*clocks ..]
+    clock_type *clock;
+    char *state; // firmware state of clock i at state+i*state_size
+} fleet_type;
+
+fleet_type *fleet;
+size_t state_size;
+
+static void lock(deque_type *d)
+{
+    while (__atomic_test_and_set(&d->lock,__ATOMIC_ACQUIRE)) usleep(50);
+}
+
+static void unlock(deque_type *d)
+{
+    __atomic_clear(&d->lock,__ATOMIC_RELEASE);
+}
+
+// put clock to the bottom of own deque
+void push(int w, int clock)
+{
+    deque_type *d = &fleet->deques[w];
+    int *items = &fleet->items[w*fleet->clocks];
+    lock(d);
+    if (d->bottom>=fleet->clocks)
+    {
+        memmove(items,items+d->top,(d->bottom-d->top)*sizeof(int));
+        d->bottom -= d->top;
+        d->top = 0;
+    }
+    items[d->bottom++] = clock;
+    unlock(d);
+}
+
+// clock from own bottom, or from the top of the others (-1 .. none now)
+int take(int w)
+{
+    int i, clock = -1;
+    for (i=0;(i<fleet->workers)&&(clock<0);i++)
+    {
+        int v = (w+i)%fleet->workers;
+        deque_type *d = &fleet->deques[v];
+        lock(d);
+        if (d->top<d->bottom)
+        {
+            if (v==w) clock = fleet->items[v*fleet->clocks+(--d->bottom)];
+            else
+            {
+                clock = fleet->items[v*fleet->clocks+(d->top++)];
+                fleet->deques[w].steals++; // thief's counter, only it writes it
+            }
+        }
+        unlock(d);
+    }
+    return clock;
+}
+
+// uart output
+void tx_count(void *ctx, char c, hw_time t)
+{
+    ((clock_type *)ctx)->uart_chars++;
+}
+
+// rtc time minus transmitter time (s, wrapped within half a week)
+double rtc_error(signal_type *s)
+{
+    tstruct t;
+    rtc_get_time(&t);
+    double rtc = t.dayow*86400.0+t.hour*3600.0+t.minute*60.0+t.second+(double)rtc_get_subsecond()/RTC_SAMPLING_FREQV;
+    double e = rtc-signal_time(s,hw_real_time());
+    if (e>3.5*86400) e -= 7*86400;
+    if (e<-3.5*86400) e += 7*86400;
+    return e;
+}
+
+// run clock for a slice (its state loaded), statistics every second
+void run_slice(clock_type *c)
+{
+    long end = c->seconds+fleet->slice;
+    if (end>fleet->seconds) end = fleet->seconds;
+    while (c->seconds<end)
+    {
+        uint16_t err;
+        hw_run(SECOND_STEPS);
+        c->seconds++;
+        double t = hw_real_time();
+        uint16_t decodes = dcf77_get_decodes();
+        if (decodes!=c->last_decodes)
+        {
+            c->decodes += (uint16_t)(decodes-c->last_decodes);
+            c->last_decodes = decodes;
+            if (c->first_decode<0) c->first_decode = t;
+            if ((c->signal.outage_to>0)&&(t>c->signal.outage_to)&&(c->recovery<0)) c->recovery = t-c->signal.outage_to;
+        }
+        rtc_quality_type q = rtc_get_quality(&err);
+        c->quality_s[q]++;
+        if ((q!=RTC_QUALITY_UNSYNC)&&(!treset)) // subsecond isn't valid until the next tick
+        {
+            double e = fabs(rtc_error(&c->signal))*1000.0;
+            if (e>c->max_err) c->max_err = e;
+            if (e>err+1000.0/RTC_SAMPLING_FREQV) c->bound_exceeded++; // a tick of rounding
+        }
+    }
+}
+
+void worker(int w)
+{
+    while (__atomic_load_n(&fleet->remaining,__ATOMIC_ACQUIRE)>0)
+    {
+        int i = take(w);
+        if (i<0)
+        {
+            usleep(50);
+            continue;
+        }
+        clock_type *c = &fleet->clock[i];
+        hw_state_load(fleet->state+i*state_size);
+        run_slice(c);
+        hw_state_save(fleet->state+i*state_size);
+        fleet->deques[w].tasks++;
+        if (c->seconds<fleet->seconds) push(w,i);
+        else __atomic_sub_fetch(&fleet->remaining,1,__ATOMIC_RELEASE);
+    }
+}
+
+// percentiles of values (sorted in place)
+int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x>y)-(x<y);
+}
+
+void percentiles(const char *name, double *v, int n)
+{
+    qsort(v,n,sizeof(double),cmp_double);
+    if (n==0) printf("  %-26s none\n",name);
+    else printf("  %-26s p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f  (%d clocks)\n",name,
+        v[n/2],v[n*9/10],v[n*99/100],v[n-1],n);
+}
+
+double wall(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    int clocks = 64, workers = (int)sysconf(_SC_NPROCESSORS_ONLN), opt, i, w;
+    double days = 1.0, slice = 60.0;
+    uint32_t seed = 1;
+    const char *output = 0;
+    while ((opt=getopt(argc,argv,"n:d:j:q:s:o:"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'n': clocks = atoi(optarg); break;
+            case 'd': days = atof(optarg); break;
+            case 'j': workers = atoi(optarg); break;
+            case 'q': slice = atof(optarg); break;
+            case 's': seed = strtoul(optarg,0,0); break;
+            case 'o': output = optarg; break;
+            default:
+                fprintf(stderr,"usage: fleet [-n clocks] [-d days] [-j workers] [-q minutes] [-s seed] [-o file]\n");
+                return 2;
+        }
+    }
+    if ((clocks<1)||(workers<1)||(days<=0)||(slice<=0)||(seed==0))
+    {
+        fprintf(stderr,"usage: fleet [-n clocks] [-d days] [-j workers] [-q minutes] [-s seed] [-o file]\n");
+        return 2;
+    }
+
+    // shared mapping (same address in all workers, so signal pointers in clock states hold)
+    state_size = hw_state_size();
+    size_t size = sizeof(fleet_type)+workers*sizeof(deque_type)+(size_t)workers*clocks*sizeof(int)+
+        clocks*sizeof(clock_type)+clocks*state_size;
+    char *shared = mmap(0,size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_ANONYMOUS,-1,0);
+    if (shared==MAP_FAILED) {perror("mmap");return 1;}
+    fleet = (fleet_type *)shared;
+    fleet->deques = (deque_type *)(shared+sizeof(fleet_type));
+    fleet->items = (int *)(fleet->deques+workers);
+    fleet->clock = (clock_type *)(fleet->items+(size_t)workers*clocks);
+    fleet->state = (char *)(fleet->clock+clocks);
+    fleet->clocks = clocks;
+    fleet->workers = workers;
+    fleet->seconds = (long)(days*86400.0);
+    fleet->slice = (long)(slice*60.0);
+    if (fleet->slice<1) fleet->slice = 1;
+    fleet->remaining = clocks;
+
+    // clocks (power on, own signal and crystal), dealt to workers in blocks
+    for (i=0;i<clocks;i++)
+    {
+        clock_type *c = &fleet->clock[i];
+        uint32_t r = signal_random(&seed);
+        signal_init(&c->signal,r%7,(r>>3)%24,(r>>8)%60,(double)(signal_random(&seed)%60000)/1000.0,signal_random(&seed));
+        c->signal.noise = (double)(signal_random(&seed)%800)/10000.0;
+        if (signal_random(&seed)&1)
+        {
+            c->signal.outage_from = (double)(signal_random(&seed)%(fleet->seconds+1));
+            c->signal.outage_to = c->signal.outage_from+1.0+signal_random(&seed)%7200;
+        }
+        c->ppm = ((double)(signal_random(&seed)%60001)-30000.0)/1000.0;
+        c->first_decode = c->recovery = -1.0;
+        hw_init();
+        hw_set_input(signal_input,&c->signal);
+        hw_set_tx(tx_count,c);
+        hw_set_ppm(c->ppm);
+        main_init();
+        c->last_decodes = dcf77_get_decodes();
+        hw_state_save(fleet->state+i*state_size);
+        w = (int)((long)i*workers/clocks);
+        fleet->items[w*clocks+fleet->deques[w].bottom++] = i;
+    }
+
+    double start = wall();
+    fflush(stdout);
+    for (w=0;w<workers;w++)
+    {
+        pid_t pid = fork();
+        if (pid<0) {perror("fork");return 1;}
+        if (pid==0)
+        {
+            worker(w);
+            _exit(0);
+        }
+    }
+    int status, failed = 0;
+    while (wait(&status)>0) if (!WIFEXITED(status)||(WEXITSTATUS(status)!=0)) failed++;
+    double elapsed = wall()-start;
+    if (failed||(fleet->remaining!=0)) {fprintf(stderr,"%d workers failed\n",failed);return 1;}
+
+    // aggregate
+    long tasks = 0, steals = 0, q[3] = {0,0,0}, exceeded = 0, exceeded_clocks = 0, chars = 0, decodes = 0;
+    int n_first = 0, n_rec = 0, n_outage = 0, n_err = 0;
+    double *first = malloc(clocks*sizeof(double)), *rec = malloc(clocks*sizeof(double)), *err = malloc(clocks*sizeof(double));
+    for (w=0;w<workers;w++) {tasks += fleet->deques[w].tasks;steals += fleet->deques[w].steals;}
+    for (i=0;i<clocks;i++)
+    {
+        clock_type *c = &fleet->clock[i];
+        if (c->first_decode>=0) first[n_first++] = c->first_decode;
+        if ((c->signal.outage_to>0)&&(c->signal.outage_to<fleet->seconds))
+        {
+            n_outage++;
+            if (c->recovery>=0) rec[n_rec++] = c->recovery;
+        }
+        if (c->quality_s[RTC_QUALITY_UNSYNC]<fleet->seconds) err[n_err++] = c->max_err;
+        for (w=0;w<3;w++) q[w] += c->quality_s[w];
+        if (c->bound_exceeded) exceeded_clocks++;
+        exceeded += c->bound_exceeded;
+        chars += c->uart_chars;
+        decodes += c->decodes;
+    }
+    double clock_days = (double)clocks*fleet->seconds/86400.0, total = (double)clocks*fleet->seconds;
+    printf("clocks %d days %.2f workers %d tasks %ld steals %ld wall %.1f s (%.2f clock days per wall s)\n",
+        clocks,fleet->seconds/86400.0,workers,tasks,steals,elapsed,clock_days/elapsed);
+    percentiles("first decode (s)",first,n_first);
+    printf("  %-26s %d of %d\n","never decoded",clocks-n_first,clocks);
+    printf("  %-26s %.1f\n","decodes per clock hour",decodes*3600.0/total);
+    printf("  %-26s synced %.1f  hold %.1f  unsync %.1f\n","time quality (%)",
+        q[RTC_QUALITY_SYNCED]*100.0/total,q[RTC_QUALITY_HOLD]*100.0/total,q[RTC_QUALITY_UNSYNC]*100.0/total);
+    percentiles("max time error (ms)",err,n_err);
+    printf("  %-26s %ld clocks, %ld s\n","error above bound",exceeded_clocks,exceeded);
+    percentiles("outage recovery (s)",rec,n_rec);
+    printf("  %-26s %d of %d\n","not recovered",n_outage-n_rec,n_outage);
+    printf("  %-26s %.0f\n","uart chars per clock hour",chars*3600.0/total);
+
+    if (output!=0)
+    {
+        FILE *f = fopen(output,"w");
+        if (f==0) {perror(output);return 1;}
+        fprintf(f,"clock,ppm,noise,outage_from,outage_to,first_decode,decodes,synced,hold,unsync,max_err,bound_exceeded,recovery,uart_chars\n");
+        for (i=0;i<clocks;i++)
+        {
+            clock_type *c = &fleet->clock[i];
+            fprintf(f,"%d,%.3f,%.4f,%.0f,%.0f,%.3f,%ld,%ld,%ld,%ld,%.3f,%ld,%.3f,%ld\n",i,c->ppm,c->signal.noise,
+                c->signal.outage_from,c->signal.outage_to,c->first_decode,c->decodes,c->quality_s[RTC_QUALITY_SYNCED],
+                c->quality_s[RTC_QUALITY_HOLD],c->quality_s[RTC_QUALITY_UNSYNC],c->max_err,c->bound_exceeded,c->recovery,c->uart_chars);
+        }
+        fclose(f);
+    }
+    free(first);
+    free(rec);
+    free(err);
+    return 0;
+}
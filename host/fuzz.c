@@ -0,0 +1,380 @@
+/**
+ *
+ * differential fuzzer (firmware receiver against the frozen reference model)
+ *
+ * usage: fuzz [-n streams] [-s seed] [-f fault] [-b budget] [-o file] [-r file] [-v]
+ *   -n .. random sample streams (default 50)
+ *   -s .. seed of the first stream (default 1, stream i has seed+i)
+ *   -f .. reference model fault (ticks, harness self test, default 0)
+ *   -b .. minimization budget (stream runs, default 2000)
+ *   -o .. reproducer file (default fuzz_repro.txt)
+ *   -r .. replay reproducer file and trace symbols of both
+ *   -v .. one line per stream
+ *
+ * the firmware (fw.o with the hardware model) and ref_dcf77.c get the same
+ * receiver output samples, before every sample the sync. mode, detected symbols
+ * (symbol and signal quality), decoder results and decoded time of both are
+ * compared, streams are second marks at random phase, drift and pulse lengths
+ * with impulse noise, phase jumps, outages and pure noise ones
+ *
+ * the first divergent stream is cut at the divergence and minimized (runs of
+ * equal samples removed and shortened while it still diverges), the reproducer
+ * is written as the first sample value and run lengths, exit code 1
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "dcf77.h"
+#include "ref_dcf77.h"
+
+#define TICK_STEPS (HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV)
+#define MAX_TICKS (240L*RTC_SAMPLING_FREQV)
+
+// firmware symbols are seen by statistics (symbols in minute) and debug variables
+extern uint16_t stats_decodes[];
+extern uint8_t stats_cnt;
+
+// sample stream (run lengths of equal samples)
+typedef struct {
+    bool first; // value of the first run
+    long n; // runs
+    long *run;
+} stream_type;
+
+// one differential run
+struct {
+    const uint8_t *samples;
+    long len, pos; // samples, samples taken by firmware
+    ref_dcf77 ref;
+    bool ref_ready; // reference symbol of the last sample
+    bool ref_decoded; // reference decoded the last minute
+    uint8_t fw_cnt; // firmware symbols in minute before the last sample
+    bool done; // all samples compared
+    bool diverged;
+    char why[128];
+    bool trace;
+} run_ctx;
+
+uint8_t samples[MAX_TICKS];
+
+// coverage (compared symbols, decodes, seconds in sync. modes)
+long cover_symbols, cover_decodes, cover_modes[3];
+
+/** stream generation **/
+
+uint32_t rnd(uint32_t *seed, uint32_t n)
+{
+    return signal_random(seed)%n;
+}
+
+// random stream into samples, returns length
+long generate(uint32_t seed, char *desc, int desc_len)
+{
+    uint32_t s = seed*2654435761u+1;
+    long len = (30+rnd(&s,180))*(long)RTC_SAMPLING_FREQV, k;
+    static const int noise_ppm[] = {0,0,1000,10000,50000,100000,200000,300000};
+    int noise = noise_ppm[rnd(&s,8)];
+    bool pure = (rnd(&s,8)==0);
+    double phase = rnd(&s,RTC_SAMPLING_FREQV);
+    double period = RTC_SAMPLING_FREQV+((int)rnd(&s,2001)-1000)*1e-6*RTC_SAMPLING_FREQV; // +-1000ppm
+    int jumps = 0, outages = 0;
+
+    memset(samples,0,len);
+    if (pure)
+    {
+        for (k=0;k<len;k++) samples[k] = rnd(&s,2);
+    }
+    else
+    {
+        int second = rnd(&s,60);
+        double t = phase;
+        while (t<len)
+        {
+            // pulse (100ms .. 0, 200ms .. 1, none in second 59 or lost), jitter of edges
+            int pulse = 0;
+            if ((second!=59)&&(rnd(&s,300)!=0)) pulse = (rnd(&s,2)?RTC_SAMPLING_FREQV/5:RTC_SAMPLING_FREQV/10);
+            long a = (long)t+(int)rnd(&s,5)-2, b = a+pulse+(int)rnd(&s,5)-2;
+            for (k=(a<0)?0:a;(k<b)&&(k<len);k++) samples[k] = 1;
+            second = (second+1)%60;
+            t += period;
+            // phase jump, outage (random output)
+            if (rnd(&s,120)==0) {t += rnd(&s,RTC_SAMPLING_FREQV);jumps++;}
+            if (rnd(&s,180)==0)
+            {
+                long o = (long)t, e = o+(1+rnd(&s,20))*(long)RTC_SAMPLING_FREQV;
+                for (k=o;(k<e)&&(k<len);k++) samples[k] = rnd(&s,2);
+                outages++;
+            }
+        }
+    }
+    for (k=0;k<len;k++) if ((long)rnd(&s,1000000)<noise) samples[k] ^= 1;
+
+    snprintf(desc,desc_len,"%s len %lds noise %.1f%% period %.2f jumps %d outages %d",
+        pure?"pure noise":"signal",len/RTC_SAMPLING_FREQV,noise/1e4,period,jumps,outages);
+    return len;
+}
+
+// samples to run lengths and back
+void stream_from_samples(stream_type *st, const uint8_t *x, long len)
+{
+    long k;
+    st->n = 0;
+    st->first = len?x[0]:0;
+    for (k=0;k<len;k++)
+    {
+        if ((k==0)||(x[k]!=x[k-1])) st->run[st->n++] = 0;
+        st->run[st->n-1]++;
+    }
+}
+
+long stream_to_samples(const stream_type *st, uint8_t *x)
+{
+    long i, k, len = 0;
+    bool v = st->first;
+    for (i=0;i<st->n;i++)
+    {
+        for (k=0;(k<st->run[i])&&(len<MAX_TICKS);k++) x[len++] = v;
+        v = !v;
+    }
+    return len;
+}
+
+/** differential run **/
+
+void diverge(const char *fmt, long a, long b)
+{
+    if (run_ctx.diverged) return;
+    run_ctx.diverged = true;
+    int n = snprintf(run_ctx.why,sizeof(run_ctx.why),"tick %ld: ",run_ctx.pos);
+    snprintf(run_ctx.why+n,sizeof(run_ctx.why)-n,fmt,a,b);
+}
+
+// compare firmware and reference after the last sample taken
+void compare(void)
+{
+    int i;
+    bool fw_ready = (stats_cnt!=run_ctx.fw_cnt);
+    run_ctx.fw_cnt = stats_cnt;
+    if (run_ctx.diverged) return;
+    if ((dcf77_sync_mode_type)run_ctx.ref.sync_mode!=dcf77_get_sync_mode())
+        diverge("sync. mode %ld, reference %ld",dcf77_get_sync_mode(),run_ctx.ref.sync_mode);
+    if (fw_ready!=run_ctx.ref_ready)
+        diverge("symbol ready %ld, reference %ld",fw_ready,run_ctx.ref_ready);
+    if (fw_ready&&run_ctx.ref_ready)
+    {
+        cover_symbols++;
+        cover_modes[run_ctx.ref.sync_mode]++;
+        if (run_ctx.trace)
+            printf("%9.3f symbol %d %3d  reference %d %3d  mode %d\n",run_ctx.pos/(double)RTC_SAMPLING_FREQV,
+                last_symbol,last_Q,run_ctx.ref.detector.sym,run_ctx.ref.detector.sigQ,run_ctx.ref.sync_mode);
+        if (last_symbol!=run_ctx.ref.detector.sym)
+            diverge("symbol %ld, reference %ld",last_symbol,run_ctx.ref.detector.sym);
+        if (last_Q!=run_ctx.ref.detector.sigQ)
+            diverge("signal quality %ld, reference %ld",last_Q,run_ctx.ref.detector.sigQ);
+    }
+    for (i=DCF77_DECODE_OK;i<=DCF77_DECODE_RANGE;i++)
+        if (stats_decodes[i]!=run_ctx.ref.decodes[i])
+        {
+            char fmt[48];
+            snprintf(fmt,sizeof(fmt),"decoder result %d count %%ld, reference %%ld",i);
+            diverge(fmt,stats_decodes[i],run_ctx.ref.decodes[i]);
+        }
+    if (run_ctx.ref_decoded)
+    {
+        tstruct t;
+        rtc_get_time(&t);
+        if ((t.minute!=run_ctx.ref.time.minute)||(t.hour!=run_ctx.ref.time.hour)||(t.dayow!=run_ctx.ref.time.dayow))
+            diverge("decoded time %ld, reference %ld",t.dayow*1440L+t.hour*60+t.minute,
+                run_ctx.ref.time.dayow*1440L+run_ctx.ref.time.hour*60+run_ctx.ref.time.minute);
+        run_ctx.ref_decoded = false;
+        cover_decodes++;
+    }
+}
+
+// receiver output (the next sample for firmware isr, the same one to reference)
+bool input(void *ctx, double t)
+{
+    bool v;
+    compare();
+    if (run_ctx.pos>=run_ctx.len) {run_ctx.done = true;return false;}
+    v = run_ctx.samples[run_ctx.pos++];
+    run_ctx.ref_ready = ref_strobe(&run_ctx.ref,v);
+    if (run_ctx.ref_ready)
+        run_ctx.ref_decoded = (ref_symbol(&run_ctx.ref,run_ctx.ref.detector.sym)==DCF77_DECODE_OK);
+    return v;
+}
+
+// run samples through both, returns true when they diverge (run_ctx.pos, why)
+bool run(const uint8_t *x, long len, int fault, bool trace)
+{
+    memset(&run_ctx,0,sizeof(run_ctx));
+    run_ctx.samples = x;
+    run_ctx.len = len;
+    run_ctx.trace = trace;
+    ref_init(&run_ctx.ref,fault);
+    hw_init();
+    hw_set_input(input,0);
+    main_init();
+    while ((!run_ctx.done)&&(!run_ctx.diverged)) hw_run(TICK_STEPS);
+    return run_ctx.diverged;
+}
+
+/** minimization **/
+
+uint8_t trial[MAX_TICKS];
+long trials, budget;
+
+// stream still diverges (cut at the divergence when it does)
+bool still(stream_type *st, int fault)
+{
+    long len = stream_to_samples(st,trial);
+    trials++;
+    if (!run(trial,len,fault,false)) return false;
+    stream_from_samples(st,trial,run_ctx.pos);
+    return true;
+}
+
+// remove chunks of runs (halving chunk), then shorten runs (halving), while it diverges
+void minimize(stream_type *st, int fault)
+{
+    stream_type c;
+    long size, i, j;
+    c.run = malloc(MAX_TICKS*sizeof(long));
+    for (size=st->n/2;(size>=1)&&(trials<budget);size/=2)
+    {
+        for (i=0;(i+size<=st->n)&&(trials<budget);)
+        {
+            // runs i..i+size-1 out, neighbours of the same value merge
+            c.first = st->first;
+            memcpy(c.run,st->run,i*sizeof(long));
+            c.n = i;
+            j = i+size;
+            if ((size&1)&&(j<st->n))
+            {
+                if (i>0) c.run[i-1] += st->run[j++];
+                else c.first = !st->first;
+            }
+            memcpy(c.run+c.n,st->run+j,(st->n-j)*sizeof(long));
+            c.n += st->n-j;
+            if ((c.n>0)&&still(&c,fault))
+            {
+                st->first = c.first;
+                st->n = c.n;
+                memcpy(st->run,c.run,c.n*sizeof(long));
+            }
+            else i+=size;
+        }
+    }
+    for (i=0;(i<st->n)&&(trials<budget);i++)
+    {
+        while ((i<st->n)&&(st->run[i]>1)&&(trials<budget))
+        {
+            c.first = st->first;
+            c.n = st->n;
+            memcpy(c.run,st->run,st->n*sizeof(long));
+            c.run[i] = st->run[i]/2;
+            if (!still(&c,fault)) break;
+            st->first = c.first;
+            st->n = c.n;
+            memcpy(st->run,c.run,c.n*sizeof(long));
+        }
+    }
+    free(c.run);
+}
+
+/** reproducer file **/
+
+bool save(const char *path, const stream_type *st)
+{
+    long i;
+    FILE *f = fopen(path,"w");
+    if (!f) return false;
+    fprintf(f,"%d",st->first?1:0);
+    for (i=0;i<st->n;i++) fprintf(f,"%s%ld",((i%16)==0)?"\n":" ",st->run[i]);
+    fprintf(f,"\n");
+    fclose(f);
+    return true;
+}
+
+bool load(const char *path, stream_type *st)
+{
+    int first;
+    long r;
+    FILE *f = fopen(path,"r");
+    if (!f) return false;
+    if (fscanf(f,"%d",&first)!=1) {fclose(f);return false;}
+    st->first = first!=0;
+    st->n = 0;
+    while ((st->n<MAX_TICKS)&&(fscanf(f,"%ld",&r)==1)) st->run[st->n++] = r;
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int streams = 50, fault = 0, opt, i;
+    uint32_t seed = 1;
+    const char *out = "fuzz_repro.txt", *replay = 0;
+    bool verbose = false;
+    budget = 2000;
+    while ((opt=getopt(argc,argv,"n:s:f:b:o:r:v"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'n': streams = atoi(optarg); break;
+            case 's': seed = strtoul(optarg,0,0); break;
+            case 'f': fault = atoi(optarg); break;
+            case 'b': budget = atol(optarg); break;
+            case 'o': out = optarg; break;
+            case 'r': replay = optarg; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr,"usage: fuzz [-n streams] [-s seed] [-f fault] [-b budget] [-o file] [-r file] [-v]\n");
+                return 2;
+        }
+    }
+
+    stream_type st;
+    st.run = malloc(MAX_TICKS*sizeof(long));
+
+    if (replay)
+    {
+        if (!load(replay,&st)) {fprintf(stderr,"can't read %s\n",replay);return 2;}
+        long len = stream_to_samples(&st,samples);
+        bool d = run(samples,len,fault,true);
+        printf("%ld samples (%ld runs): %s\n",len,st.n,d?run_ctx.why:"no divergence");
+        return d?1:0;
+    }
+
+    long ticks = 0;
+    for (i=0;i<streams;i++)
+    {
+        char desc[96];
+        long len = generate(seed+i,desc,sizeof(desc));
+        bool d = run(samples,len,fault,false);
+        ticks += run_ctx.pos;
+        if (verbose||d) printf("stream %u: %s: %s\n",seed+i,desc,d?run_ctx.why:"same");
+        if (!d) continue;
+
+        // reproducer (cut at the divergence, minimized)
+        long at = run_ctx.pos;
+        stream_from_samples(&st,samples,at);
+        trials = 0;
+        minimize(&st,fault);
+        long mlen = stream_to_samples(&st,samples);
+        run(samples,mlen,fault,false);
+        printf("minimized %ld -> %ld samples, %ld runs (%ld trials): %s\n",at,mlen,st.n,trials,run_ctx.why);
+        if (save(out,&st)) printf("reproducer %s (fuzz%s%.0d -r %s)\n",out,fault?" -f ":"",fault,out);
+        return 1;
+    }
+    printf("streams %d samples %ld (%.1f hours) symbols %ld (coarse %ld fine %ld hold %ld) decodes %ld no divergence\n",
+        streams,ticks,ticks/(3600.0*RTC_SAMPLING_FREQV),cover_symbols,cover_modes[DCF77SYNC_COARSE],
+        cover_modes[DCF77SYNC_FINE],cover_modes[DCF77SYNC_HOLD],cover_decodes);
+    return 0;
+}
@@ -0,0 +1,436 @@
+/**
+ *
+ * host build hardware model
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * registers of the stub header, Timer0_A in up mode counting ACLK/8 (one
+ * step of the model), USCI_A0 shifting chars at 9600Bd (tx buffer + shift
+ * register, rx buffer with overrun), information flash (holding the cpu,
+ * optionally backed by an image file so a warm start can be another run)
+ * and Timer1_A in continuous mode counting cpu cost (SMCLK/8)
+ *
+ * cpu cost model (duty cycle accounting): the host runs the firmware, target
+ * cpu time is estimated, every firmware function call costs HW_CALL_CYCLES
+ * (DUTY_ACCT build is compiled with -finstrument-functions), __delay_cycles
+ * its cycles and flash holds their time, Timer1_A only counts this cost, so
+ * it stands still while the cpu sleeps as it does in LPM3
+ *
+ * interrupt service routines run when their flag is set and enabled, then
+ * the main loop takes all pending events, so the firmware sees the same
+ * order as on the target, only the cpu is infinitely fast
+ *
+ * everything here is part of the firmware state (fwdata/fwbss sections),
+ * so snapshots of an instance include the model
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include <stdio.h>
+#include <string.h>
+#include "event.h"
+#include "flash.h"
+#include "rtc.h"
+#include "hw.h" // self
+
+// registers
+#define HW_REG8(n) volatile uint8_t n
+#define HW_REG16(n) volatile uint16_t n
+HW_REG8(BCSCTL1); HW_REG8(BCSCTL2); HW_REG8(BCSCTL3); HW_REG8(DCOCTL);
+HW_REG8(CALBC1_1MHZ); HW_REG8(CALDCO_1MHZ); HW_REG8(CALBC1_8MHZ); HW_REG8(CALDCO_8MHZ);
+HW_REG8(CALBC1_16MHZ); HW_REG8(CALDCO_16MHZ);
+HW_REG16(WDTCTL);
+HW_REG8(P1DIR); HW_REG8(P1OUT); HW_REG8(P1IN); HW_REG8(P1SEL); HW_REG8(P1SEL2); HW_REG8(P1REN);
+HW_REG8(P1IE); HW_REG8(P1IES); HW_REG8(P1IFG);
+HW_REG8(P2DIR); HW_REG8(P2OUT); HW_REG8(P2IN); HW_REG8(P2SEL); HW_REG8(P2SEL2); HW_REG8(P2REN);
+HW_REG16(TACTL); HW_REG16(TAR); HW_REG16(CCTL0); HW_REG16(CCR0);
+HW_REG16(TA1CTL); HW_REG16(TA1R);
+HW_REG8(UCA0CTL0); HW_REG8(UCA0CTL1); HW_REG8(UCA0BR0); HW_REG8(UCA0BR1); HW_REG8(UCA0MCTL);
+HW_REG8(UCA0STAT); HW_REG8(IE2); HW_REG8(IFG2);
+volatile uint8_t hw_rxbuf;
+volatile uint8_t hw_txbuf;
+volatile uint16_t hw_txbuf_writes;
+HW_REG16(FCTL1); HW_REG16(FCTL2); HW_REG16(FCTL3);
+uint8_t hw_info_flash[256];
+uint8_t hw_main_flash[512];
+const char *hw_flash_path; // information flash image file (0 .. none)
+
+// dcf77 receivers (P1.5 and P1.6 of the DCF77_CHANNELS 2 build, pulled down by pulse)
+#define HW_DCF77_PIN BIT5
+#define HW_DCF77_PIN2 BIT6
+
+// cpu cost model (MCLK and SMCLK from dco, main.c, HW_MCLK in hw.h)
+#define HW_CALL_CYCLES 32 // call, prologue, epilogue and return of a short function
+
+// interrupt service routines
+void Timer_A(void);
+void USCI0RX_ISR(void);
+void USCI0TX_ISR(void);
+
+// model time and real time (crystal error, real time segments start at every ppm change)
+hw_time hw_cycles;
+double hw_ppm;
+double hw_base_real;
+hw_time hw_base_cycles;
+
+// receiver and uart output
+hw_input_fn hw_input;
+void *hw_input_ctx;
+hw_input_fn hw_input2;
+void *hw_input2_ctx;
+hw_tx_fn hw_tx;
+void *hw_tx_ctx;
+hw_probe_fn hw_timer_probe;
+void *hw_timer_probe_ctx;
+
+// uart transmitter (tx buffer and shift register)
+uint16_t hw_tx_seen; // txbuf writes taken
+bool hw_tx_full; // tx buffer holds a char
+char hw_tx_next;
+bool hw_tx_busy; // shift register busy
+char hw_tx_shift;
+hw_time hw_tx_end; // end of the char being shifted
+
+// uart receiver (chars on the wire with their end time)
+#define HW_RX_QUEUE 512
+struct {
+    char c;
+    hw_time t;
+} hw_rxq[HW_RX_QUEUE];
+uint16_t hw_rxq_head, hw_rxq_tail;
+uint16_t hw_rx_lost;
+
+// cpu cost (MCLK cycles) and Timer1_A input clocks below its divider, the model's
+// own calls into the firmware (main loop event queue polling) are free
+uint64_t hw_cpu_total;
+uint16_t hw_ta1_clocks;
+bool hw_cpu_free;
+
+/** local functions section **/
+
+// information flash image file written after every change
+void hw_flash_store(void)
+{
+    FILE *f;
+    if (!hw_flash_path) return;
+    f = fopen(hw_flash_path,"wb");
+    if (!f) return;
+    fwrite(hw_info_flash,1,sizeof(hw_info_flash),f);
+    fclose(f);
+}
+
+// cpu busy for cycles (Timer1_A counts SMCLK when it runs, TACLR clears it)
+void hw_cpu(uint32_t cycles)
+{
+    hw_cpu_total += cycles;
+    if (TA1CTL&TACLR)
+    {
+        TA1R = 0;
+        hw_ta1_clocks = 0;
+        TA1CTL &= ~TACLR;
+    }
+    if ((TA1CTL&(MC_1|MC_2))==0) return;
+    uint32_t clocks = hw_ta1_clocks+cycles;
+    int id = (TA1CTL>>6)&0x03; // input divider ID_x
+    TA1R += (uint16_t)(clocks>>id);
+    hw_ta1_clocks = clocks&((1u<<id)-1);
+}
+
+// load tx shift register from tx buffer
+void hw_tx_load(hw_time start)
+{
+    if (hw_tx_busy||!hw_tx_full) return;
+    hw_tx_shift = hw_tx_next;
+    hw_tx_full = false;
+    hw_tx_busy = true;
+    hw_tx_end = start+HW_CHAR_CYCLES;
+    IFG2 |= UCA0TXIFG;
+    UCA0STAT |= UCBUSY;
+}
+
+// take char written into tx buffer
+void hw_tx_poll(void)
+{
+    if (hw_txbuf_writes==hw_tx_seen) return;
+    hw_tx_seen = hw_txbuf_writes;
+    hw_tx_next = hw_txbuf;
+    hw_tx_full = true;
+    IFG2 &= ~UCA0TXIFG;
+    hw_tx_load(hw_cycles);
+}
+
+// uart shifting (every step)
+void hw_uart_step(void)
+{
+    if (hw_tx_busy&&(hw_cycles>=hw_tx_end))
+    {
+        hw_tx_busy = false;
+        UCA0STAT &= ~UCBUSY;
+        if (hw_tx) hw_tx(hw_tx_ctx,hw_tx_shift,hw_tx_end);
+        hw_tx_load(hw_tx_end); // back to back
+    }
+    while ((hw_rxq_tail!=hw_rxq_head)&&(hw_rxq[hw_rxq_tail].t<=hw_cycles))
+    {
+        if (IFG2&UCA0RXIFG) {hw_rx_lost++;UCA0STAT |= UCOE;} // previous char not read
+        hw_rxbuf = hw_rxq[hw_rxq_tail].c;
+        IFG2 |= UCA0RXIFG;
+        hw_rxq_tail = (hw_rxq_tail+1)%HW_RX_QUEUE;
+    }
+}
+
+// rx buffer read (clears overrun flag)
+uint8_t hw_rxbuf_read(void)
+{
+    UCA0STAT &= ~UCOE;
+    return hw_rxbuf;
+}
+
+// one timer count (peripherals only)
+void hw_step(void)
+{
+    hw_cycles += HW_STEP_CYCLES;
+    if (TACTL&MC_1)
+    {
+        TAR = (TAR>=CCR0)?0:TAR+1;
+        if (TAR==CCR0) CCTL0 |= CCIFG;
+    }
+    hw_uart_step();
+}
+
+// pending interrupts (priority as on target, timer first) and main loop events
+void hw_service(void)
+{
+    event_type ev;
+    while (1)
+    {
+        if ((CCTL0&CCIFG)&&(CCTL0&CCIE))
+        {
+            CCTL0 &= ~CCIFG;
+            P1IN |= HW_DCF77_PIN;
+            if (hw_input&&hw_input(hw_input_ctx,hw_real_time())) P1IN &= ~HW_DCF77_PIN;
+            if (hw_input2)
+            {
+                P1IN |= HW_DCF77_PIN2;
+                if (hw_input2(hw_input2_ctx,hw_real_time())) P1IN &= ~HW_DCF77_PIN2;
+            }
+            if (hw_timer_probe) hw_timer_probe(hw_timer_probe_ctx,false);
+            Timer_A();
+            if (hw_timer_probe) hw_timer_probe(hw_timer_probe_ctx,true);
+        }
+        else if ((IFG2&UCA0RXIFG)&&(IE2&UCA0RXIE))
+        {
+            IFG2 &= ~UCA0RXIFG;
+            USCI0RX_ISR();
+        }
+        else if ((IFG2&UCA0TXIFG)&&(IE2&UCA0TXIE))
+        {
+            USCI0TX_ISR();
+        }
+        else
+        {
+            hw_cpu_free = true; // polling (the target sleeps until an event)
+            ev = event_take();
+            hw_cpu_free = false;
+            if (ev==EVENT_NONE) break;
+            main_event(ev);
+        }
+        hw_tx_poll();
+    }
+}
+
+/** global functions section **/
+
+// power on (all state as after reset, information flash erased)
+void hw_init(void)
+{
+    hw_state_pristine();
+    memset(hw_info_flash,0xFF,sizeof(hw_info_flash));
+    memset(hw_main_flash,0xFF,sizeof(hw_main_flash));
+    P1IN = 0xFF; // pull ups
+    P2IN = 0xFF;
+    CCR0 = 0xFFFF;
+    IFG2 = UCA0TXIFG;
+}
+
+// power on (warm start, information flash kept)
+void hw_reset(void)
+{
+    uint8_t flash[sizeof(hw_info_flash)];
+    const char *path = hw_flash_path;
+    memcpy(flash,hw_info_flash,sizeof(flash));
+    hw_init();
+    memcpy(hw_info_flash,flash,sizeof(flash));
+    hw_flash_path = path;
+}
+
+// information flash image file (loaded when it exists, the whole image rewritten on every change)
+void hw_set_flash_file(const char *path)
+{
+    FILE *f;
+    uint8_t flash[sizeof(hw_info_flash)];
+    hw_flash_path = path;
+    if (!path) return;
+    f = fopen(path,"rb");
+    if (!f) return;
+    if (fread(flash,1,sizeof(flash),f)==sizeof(flash)) memcpy(hw_info_flash,flash,sizeof(flash));
+    fclose(f);
+}
+
+// dcf77 receiver output
+void hw_set_input(hw_input_fn fn, void *ctx)
+{
+    hw_input = fn;
+    hw_input_ctx = ctx;
+}
+
+// second dcf77 receiver output
+void hw_set_input2(hw_input_fn fn, void *ctx)
+{
+    hw_input2 = fn;
+    hw_input2_ctx = ctx;
+}
+
+// uart output
+void hw_set_tx(hw_tx_fn fn, void *ctx)
+{
+    hw_tx = fn;
+    hw_tx_ctx = ctx;
+}
+
+// timer isr entry and exit (benchmarks)
+void hw_set_timer_probe(hw_probe_fn fn, void *ctx)
+{
+    hw_timer_probe = fn;
+    hw_timer_probe_ctx = ctx;
+}
+
+// crystal frequency error
+void hw_set_ppm(double ppm)
+{
+    hw_base_real = hw_real_time();
+    hw_base_cycles = hw_cycles;
+    hw_ppm = ppm;
+}
+
+// real time since hw_init
+double hw_real_time(void)
+{
+    return hw_base_real+(double)(hw_cycles-hw_base_cycles)/(HW_ACLK*(1.0+hw_ppm*1e-6));
+}
+
+// model time of real time
+hw_time hw_cycles_at(double real)
+{
+    return hw_base_cycles+(hw_time)((real-hw_base_real)*(HW_ACLK*(1.0+hw_ppm*1e-6))+0.5);
+}
+
+// model time
+hw_time hw_now(void)
+{
+    return hw_cycles;
+}
+
+// chars to uart input
+void hw_rx(const char *s, int len, hw_time start)
+{
+    int i;
+    for (i=0;i<len;i++)
+    {
+        uint16_t next = (hw_rxq_head+1)%HW_RX_QUEUE;
+        if (next==hw_rxq_tail) break; // model queue full
+        hw_rxq[hw_rxq_head].c = s[i];
+        hw_rxq[hw_rxq_head].t = start+(hw_time)(i+1)*HW_CHAR_CYCLES;
+        hw_rxq_head = next;
+    }
+}
+
+// chars lost by uart
+uint16_t hw_rx_overruns(void)
+{
+    return hw_rx_lost;
+}
+
+// run timer counts
+void hw_run(uint32_t steps)
+{
+    hw_tx_poll(); // main_init or harness output
+    hw_service();
+    while (steps--)
+    {
+        hw_step();
+        hw_service();
+    }
+}
+
+// run until model time
+void hw_run_until(hw_time t)
+{
+    if (t>hw_cycles) hw_run((t-hw_cycles+HW_STEP_CYCLES-1)/HW_STEP_CYCLES);
+}
+
+// cpu busy in __delay_cycles
+void hw_delay_cycles(uint32_t cycles)
+{
+    hw_cpu(cycles);
+}
+
+// cpu cost since hw_init (MCLK cycles)
+uint64_t hw_cpu_cycles(void)
+{
+    return hw_cpu_total;
+}
+
+// firmware function calls (DUTY_ACCT build, -finstrument-functions)
+void __cyg_profile_func_enter(void *fn, void *site)
+{
+    if (!hw_cpu_free) hw_cpu(HW_CALL_CYCLES);
+}
+
+void __cyg_profile_func_exit(void *fn, void *site)
+{
+}
+
+// cpu held (nothing but peripherals runs, interrupt flags stay pending)
+void hw_hold(uint32_t cycles)
+{
+    hw_tx_poll();
+    hw_cpu((uint64_t)cycles*HW_MCLK/HW_ACLK);
+    while (cycles>=HW_STEP_CYCLES)
+    {
+        hw_step();
+        cycles -= HW_STEP_CYCLES;
+    }
+}
+
+// information flash (erased .. 0xFF, write can only clear bits), cpu is held
+// as on the target (flash timing generator from dco, its slow end +3%) and
+// the rtc compensates the lost ticks as flash.c does
+#define HW_FLASH_CYCLES(us) ((uint32_t)(us)*HW_ACLK/1000000*103/100)
+
+void flash_erase(uint8_t *segment)
+{
+    uint8_t *seg = hw_info_flash+((segment-hw_info_flash)&~(FLASH_SEGMENT_SIZE-1));
+    int size = FLASH_SEGMENT_SIZE;
+    if ((segment>=hw_main_flash)&&(segment<(hw_main_flash+sizeof(hw_main_flash))))
+    {
+        seg = hw_main_flash;
+        size = FLASH_MAIN_SEGMENT_SIZE;
+    }
+    uint16_t stamp = rtc_get_stamp();
+    memset(seg,0xFF,size);
+    hw_flash_store();
+    hw_hold(HW_FLASH_CYCLES(FLASH_ERASE_US));
+    rtc_hold_end(stamp,FLASH_ERASE_US);
+}
+
+void flash_write(uint8_t *dst, const uint8_t *src, int len)
+{
+    int i;
+    uint16_t stamp = rtc_get_stamp();
+    for (i=0;i<len;i++) dst[i] &= src[i];
+    hw_flash_store();
+    hw_hold(HW_FLASH_CYCLES(len*FLASH_BYTE_US));
+    rtc_hold_end(stamp,len*FLASH_BYTE_US);
+}
@@ -0,0 +1,58 @@
+/**
+ *
+ * host build hardware model header
+ *
+ **/
+
+#ifndef __HW_H__
+#define __HW_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event.h"
+
+// model time base (ACLK cycles of the clock crystal)
+#define HW_ACLK 32768
+#define HW_STEP_CYCLES 8 // one timer A count (ACLK/8)
+#define HW_CHAR_CYCLES 34 // one uart char (10 bits at 9600Bd from ACLK, UCBR 3 + modulation)
+#define HW_MCLK 8000000 // cpu clock (cost model, Timer1_A counts it /8)
+
+typedef uint64_t hw_time; // ACLK cycles since hw_init
+
+// dcf77 receiver output (true .. carrier reduced, i.e. pulse) at real time t (s)
+typedef bool (*hw_input_fn)(void *ctx, double t);
+// char leaving the uart (t .. end of the stop bit)
+typedef void (*hw_tx_fn)(void *ctx, char c, hw_time t);
+// timer isr entry (end false) and exit (end true)
+typedef void (*hw_probe_fn)(void *ctx, bool end);
+
+// firmware entry points (main.c)
+void main_init(void);
+void main_event(event_type ev);
+
+void hw_init(void); // power on, erased information flash (call main_init after it)
+void hw_reset(void); // power on, information flash kept (warm start)
+void hw_set_flash_file(const char *path); // information flash image file (0 .. none), kept by hw_reset
+void hw_set_input(hw_input_fn fn, void *ctx); // dcf77 receiver (0 .. no signal)
+void hw_set_input2(hw_input_fn fn, void *ctx); // second dcf77 receiver (P1.6, DCF77_CHANNELS 2 build)
+void hw_set_tx(hw_tx_fn fn, void *ctx); // uart output
+void hw_set_timer_probe(hw_probe_fn fn, void *ctx); // timer isr entry and exit (0 .. none)
+void hw_set_ppm(double ppm); // crystal frequency error (positive .. clock runs fast)
+void hw_rx(const char *s, int len, hw_time start); // chars to uart input (the first one starts at start)
+void hw_run(uint32_t steps); // run timer counts (isrs and main loop events)
+void hw_run_until(hw_time t); // run until model time
+void hw_hold(uint32_t cycles); // cpu held (flash erase/write), nothing but peripherals run
+hw_time hw_now(void); // model time
+double hw_real_time(void); // real time (s) since hw_init
+hw_time hw_cycles_at(double real); // model time of real time (with current ppm)
+uint16_t hw_rx_overruns(void); // chars lost by uart (rx buffer not read in time)
+uint64_t hw_cpu_cycles(void); // cpu cost since hw_init (MCLK cycles of the cost model)
+
+// whole firmware and model state (instances, snapshots), hwstate.c
+size_t hw_state_size(void);
+void hw_state_save(void *buf);
+void hw_state_load(const void *buf);
+void hw_state_pristine(void); // state before the first hw_init (static initializers)
+
+#endif
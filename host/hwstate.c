@@ -0,0 +1,63 @@
+/**
+ *
+ * host build firmware state snapshots
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * all firmware and hardware model objects are linked into one relocatable
+ * object and its .data and .bss are renamed to fwdata and fwbss (Makefile),
+ * so the whole state of one clock is two contiguous memory ranges, the
+ * linker provides their bounds
+ *
+ * saving and loading them switches between clock instances, the copy taken
+ * before the first hw_init is the power on state (static initializers)
+ *
+ * this file is not part of the firmware object (its state survives loads)
+ *
+ **/
+
+/// include section
+#include <stdlib.h>
+#include <string.h>
+#include "hw.h"
+
+extern char __start_fwdata[], __stop_fwdata[];
+extern char __start_fwbss[], __stop_fwbss[];
+
+#define HW_DATA_SIZE ((size_t)(__stop_fwdata-__start_fwdata))
+#define HW_BSS_SIZE ((size_t)(__stop_fwbss-__start_fwbss))
+
+static void *hw_pristine = 0;
+
+// state size (bytes)
+size_t hw_state_size(void)
+{
+    return HW_DATA_SIZE+HW_BSS_SIZE;
+}
+
+// save state
+void hw_state_save(void *buf)
+{
+    memcpy(buf,__start_fwdata,HW_DATA_SIZE);
+    memcpy((char*)buf+HW_DATA_SIZE,__start_fwbss,HW_BSS_SIZE);
+}
+
+// load state
+void hw_state_load(const void *buf)
+{
+    memcpy(__start_fwdata,buf,HW_DATA_SIZE);
+    memcpy(__start_fwbss,(const char*)buf+HW_DATA_SIZE,HW_BSS_SIZE);
+}
+
+// power on state (taken at the first call, loaded at the others)
+void hw_state_pristine(void)
+{
+    if (hw_pristine==0)
+    {
+        hw_pristine = malloc(hw_state_size());
+        if (hw_pristine==0) abort();
+        hw_state_save(hw_pristine);
+    }
+    else hw_state_load(hw_pristine);
+}
@@ -0,0 +1,127 @@
+/**
+ *
+ * msp430g2553 register and intrinsics stub for the host build
+ *
+ * registers are plain variables of the hardware model (hw.c), intrinsics
+ * are no-ops (interrupt service routines are called by the model between
+ * main loop events, so nothing runs concurrently), only __delay_cycles goes
+ * to the cpu cost model (Timer1_A counts it)
+ *
+ * only the registers and bits used by the firmware are here
+ *
+ **/
+
+#ifndef __MSP430G2553_HOST_H__
+#define __MSP430G2553_HOST_H__
+
+#include <stdint.h>
+
+#define HW_SFR8(n) extern volatile uint8_t n
+#define HW_SFR16(n) extern volatile uint16_t n
+
+// clock system, watchdog
+HW_SFR8(BCSCTL1); HW_SFR8(BCSCTL2); HW_SFR8(BCSCTL3); HW_SFR8(DCOCTL);
+HW_SFR8(CALBC1_1MHZ); HW_SFR8(CALDCO_1MHZ); HW_SFR8(CALBC1_8MHZ); HW_SFR8(CALDCO_8MHZ);
+HW_SFR8(CALBC1_16MHZ); HW_SFR8(CALDCO_16MHZ);
+HW_SFR16(WDTCTL);
+
+// ports
+HW_SFR8(P1DIR); HW_SFR8(P1OUT); HW_SFR8(P1IN); HW_SFR8(P1SEL); HW_SFR8(P1SEL2); HW_SFR8(P1REN);
+HW_SFR8(P1IE); HW_SFR8(P1IES); HW_SFR8(P1IFG);
+HW_SFR8(P2DIR); HW_SFR8(P2OUT); HW_SFR8(P2IN); HW_SFR8(P2SEL); HW_SFR8(P2SEL2); HW_SFR8(P2REN);
+
+// Timer0_A (rtc) and Timer1_A (duty cycle accounting)
+HW_SFR16(TACTL); HW_SFR16(TAR); HW_SFR16(CCTL0); HW_SFR16(CCR0);
+HW_SFR16(TA1CTL); HW_SFR16(TA1R);
+
+// USCI_A0 (uart), the firmware only writes TXBUF, every use is counted as a write,
+// and only reads RXBUF, the read clears error flags
+HW_SFR8(UCA0CTL0); HW_SFR8(UCA0CTL1); HW_SFR8(UCA0BR0); HW_SFR8(UCA0BR1); HW_SFR8(UCA0MCTL);
+HW_SFR8(UCA0STAT); HW_SFR8(IE2); HW_SFR8(IFG2);
+extern volatile uint8_t hw_txbuf;
+extern volatile uint16_t hw_txbuf_writes;
+#define UCA0TXBUF (*(hw_txbuf_writes++,&hw_txbuf))
+uint8_t hw_rxbuf_read(void);
+#define UCA0RXBUF (hw_rxbuf_read())
+
+// flash controller (erase and write are emulated by hw.c, information memory and the
+// scratch main memory segment are arrays)
+HW_SFR16(FCTL1); HW_SFR16(FCTL2); HW_SFR16(FCTL3);
+extern uint8_t hw_info_flash[256];
+extern uint8_t hw_main_flash[512];
+#define FLASH_INFO (hw_info_flash)
+#define FLASH_SCRATCH (hw_main_flash)
+
+#define BIT0 0x01
+#define BIT1 0x02
+#define BIT2 0x04
+#define BIT3 0x08
+#define BIT4 0x10
+#define BIT5 0x20
+#define BIT6 0x40
+#define BIT7 0x80
+
+#define WDTPW 0x5A00
+#define WDTHOLD 0x0080
+
+#define CCIFG 0x0001
+#define CCIE 0x0010
+#define TACLR 0x0004
+#define MC_0 0x0000
+#define MC_1 0x0010
+#define MC_2 0x0020
+#define ID_0 0x0000
+#define ID_3 0x00C0
+#define TASSEL_1 0x0100
+#define TASSEL_2 0x0200
+
+#define UCSWRST 0x01
+#define UCSSEL_1 0x40
+#define UCSSEL_2 0x80
+#define UCBRS0 0x02
+#define UCBRS_3 0x06
+#define UCBUSY 0x01
+#define UCOE 0x20
+#define UCA0RXIE 0x01
+#define UCA0TXIE 0x02
+#define UCA0RXIFG 0x01
+#define UCA0TXIFG 0x02
+
+#define FWKEY 0xA500
+#define ERASE 0x0002
+#define WRT 0x0040
+#define LOCK 0x0010
+#define LOCKA 0x0040
+#define FSSEL_1 0x0040
+#define FN0 0x0001
+#define FN1 0x0002
+#define FN4 0x0010
+
+#define GIE 0x0008
+#define CPUOFF 0x0010
+#define SCG0 0x0040
+#define SCG1 0x0080
+#define LPM0_bits (CPUOFF)
+#define LPM3_bits (SCG1+SCG0+CPUOFF)
+
+#define TIMER0_A0_VECTOR 9
+#define USCIAB0TX_VECTOR 6
+#define USCIAB0RX_VECTOR 7
+#define PORT1_VECTOR 2
+
+// intrinsics
+#define __interrupt
+#define __disable_interrupt() ((void)0)
+#define __enable_interrupt() ((void)0)
+#define __get_interrupt_state() (0u)
+#define __set_interrupt_state(s) ((void)(s))
+#define __bis_SR_register(x) ((void)(x))
+#define __bic_SR_register_on_exit(x) ((void)(x))
+void hw_delay_cycles(uint32_t cycles);
+#define __delay_cycles(x) hw_delay_cycles(x)
+#define __no_operation() ((void)0)
+// stack.c paints from the end of static data up to the stack pointer, there is nothing to paint
+extern uint8_t _end;
+#define __read_stack_pointer() ((void*)(&_end+8))
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ *
+ * adaptive threshold noise sweep (synthetic signal with growing impulse noise, then noise only)
+ *
+ * usage: noise [-m minutes]
+ *   -m .. simulated minutes per noise level (default 10)
+ *
+ * per level: receiver output sample error probability, adaptive threshold
+ * state (threshold, symbol margin, noise and signal quality distributions),
+ * not detected symbols and decodes, the last line is the input without
+ * carrier (random samples), its accepted symbols are false accepts to be
+ * compared with the target rate (DCF77_FALSE_ACCEPT per 10000), exit code 1
+ * when they are above it
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "hw.h"
+#include "signal.h"
+#include "dcf77.h"
+#include "stats.h"
+
+// run one level, not detected symbols (minute summaries of the last minutes, the first two skipped),
+// returns false accepts above the target (no carrier)
+bool level(double noise, bool outage, int minutes)
+{
+    signal_type s;
+    int m, none = 0, counted = 0;
+    signal_init(&s,2,10,0,0.37,7);
+    s.noise = noise;
+    if (outage) s.outage_to = 1e9;
+    hw_init();
+    hw_set_input(signal_input,&s);
+    main_init();
+    for (m=1;m<=minutes;m++)
+    {
+        hw_run_until(hw_cycles_at(m*60.0+1.0));
+        if (m>2) {none += stats_get_minute()->none;counted += 60;}
+    }
+    dcf77_adapt_state a;
+    dcf77_get_adapt(&a);
+    printf("%5.3f %s thr %3d margin %3d noise %3d/%3d signal %3d/%3d none %5.1f %% decodes %u\n",
+        noise,outage?"no carrier":"          ",a.thr,a.margin,a.noise_mean,a.noise_dev,a.signal_mean,a.signal_dev,
+        counted?100.0*none/counted:0.0,dcf77_get_decodes());
+    if (!outage) return false;
+    printf("false accepts %.2f %% (target %.2f %%)\n",counted?100.0*(counted-none)/counted:0.0,DCF77_FALSE_ACCEPT/100.0);
+    return (counted-none)*10000L>(long)counted*DCF77_FALSE_ACCEPT;
+}
+
+int main(int argc, char **argv)
+{
+    static const double levels[] = {0.0,0.02,0.05,0.1,0.15,0.2,0.25,0.3};
+    int minutes = 10, opt;
+    unsigned int i;
+    while ((opt=getopt(argc,argv,"m:"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'm': minutes = atoi(optarg); break;
+            default:
+                fprintf(stderr,"usage: noise [-m minutes]\n");
+                return 1;
+        }
+    }
+    for (i=0;i<sizeof(levels)/sizeof(levels[0]);i++) level(levels[i],false,minutes);
+    return level(0.0,true,minutes)?1:0;
+}
@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+#
+# static ram estimate of the firmware for msp430 from the host build debug info
+#
+# usage: ramsize.py [-v] [-s stack] [-r ram] objects..
+#   -v .. list variables
+#   -s .. minimal stack reserve (bytes, default 0)
+#   -r .. ram size (bytes, fails when static data + stack reserve don't fit)
+#
+# the host objects are compiled with -g, every variable with static storage is
+# taken from dwarf (llvm-dwarfdump) and its type is sized again with msp430
+# rules: int, short, pointer, enum and size_t 2 bytes, long 4, alignment of
+# 2 bytes at most, stdint typedefs by their name (the host ones are not msp430
+# ones), const data stays in flash, tentative definitions of more modules (common)
+# are counted once
+#
+# it's an estimate for machines without msp430 toolchain, the target build
+# checks the linked image (../Makefile, RAM_SIZE and STACK_MIN)
+#
+# llvm-dwarfdump (any version) is taken from DWARFDUMP environment variable or path
+#
+
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+DWARFDUMP = os.environ.get('DWARFDUMP') or next(
+    (t for t in ['llvm-dwarfdump']+['llvm-dwarfdump-%d' % v for v in range(20, 10, -1)]
+     if shutil.which(t)), 'llvm-dwarfdump')
+
+STDINT = {
+    'int8_t': 1, 'uint8_t': 1, '__int8_t': 1, '__uint8_t': 1,
+    'int16_t': 2, 'uint16_t': 2, '__int16_t': 2, '__uint16_t': 2,
+    'int32_t': 4, 'uint32_t': 4, '__int32_t': 4, '__uint32_t': 4,
+    'int64_t': 8, 'uint64_t': 8, '__int64_t': 8, '__uint64_t': 8,
+    'size_t': 2, 'ptrdiff_t': 2, 'intptr_t': 2, 'uintptr_t': 2,
+}
+
+BASE = {
+    'char': 1, 'signed char': 1, 'unsigned char': 1, '_Bool': 1,
+    'short int': 2, 'short unsigned int': 2, 'int': 2, 'unsigned int': 2,
+    'long int': 4, 'long unsigned int': 4,
+    'long long int': 8, 'long long unsigned int': 8,
+    'float': 4, 'double': 8, 'long double': 8,
+}
+
+
+class Die:
+    def __init__(self, off, tag, depth):
+        self.off = off
+        self.tag = tag
+        self.depth = depth
+        self.attrs = {}
+        self.children = []
+
+
+def parse(path):
+    """dies of one object (offset .. die), top level variables first"""
+    out = subprocess.run([DWARFDUMP, '--debug-info', path], check=True,
+                         capture_output=True, text=True).stdout
+    dies = {}
+    stack = []
+    cur = None
+    for line in out.splitlines():
+        m = re.match(r'^0x([0-9a-f]+):(\s+)(DW_TAG_\w+|NULL)', line)
+        if m:
+            depth = len(m.group(2))
+            while stack and stack[-1].depth >= depth:
+                stack.pop()
+            if m.group(3) == 'NULL':
+                cur = None
+                continue
+            cur = Die(int(m.group(1), 16), m.group(3), depth)
+            if stack:
+                stack[-1].children.append(cur)
+            stack.append(cur)
+            dies[cur.off] = cur
+            continue
+        m = re.match(r'^\s+(DW_AT_\w+)\s+\((.*)\)$', line)
+        if m and cur is not None:
+            cur.attrs[m.group(1)] = m.group(2)
+    return dies
+
+
+def ref(die, attr):
+    m = re.match(r'0x([0-9a-f]+)', die.attrs.get(attr, ''))
+    return int(m.group(1), 16) if m else None
+
+
+def name(die):
+    m = re.match(r'"(.*)"', die.attrs.get('DW_AT_name', ''))
+    return m.group(1) if m else None
+
+
+def layout(dies, off):
+    """msp430 (size, alignment, const) of type"""
+    if off is None:
+        return 0, 1, False
+    die = dies[off]
+    tag = die.tag
+    if tag == 'DW_TAG_typedef':
+        if name(die) in STDINT:
+            s = STDINT[name(die)]
+            return s, min(s, 2), False
+        return layout(dies, ref(die, 'DW_AT_type'))
+    if tag in ('DW_TAG_volatile_type', 'DW_TAG_restrict_type'):
+        return layout(dies, ref(die, 'DW_AT_type'))
+    if tag == 'DW_TAG_const_type':
+        s, a, _ = layout(dies, ref(die, 'DW_AT_type'))
+        return s, a, True
+    if tag == 'DW_TAG_base_type':
+        s = BASE[name(die)]
+        return s, min(s, 2), False
+    if tag in ('DW_TAG_pointer_type', 'DW_TAG_enumeration_type'):
+        return 2, 2, False
+    if tag == 'DW_TAG_array_type':
+        s, a, c = layout(dies, ref(die, 'DW_AT_type'))
+        for sub in die.children:
+            if sub.tag != 'DW_TAG_subrange_type':
+                continue
+            if 'DW_AT_count' in sub.attrs:
+                s *= int(sub.attrs['DW_AT_count'], 0)
+            elif 'DW_AT_upper_bound' in sub.attrs:
+                s *= int(sub.attrs['DW_AT_upper_bound'], 0)+1
+            else:
+                s = 0
+        return s, a, c
+    if tag in ('DW_TAG_structure_type', 'DW_TAG_union_type'):
+        size, align = 0, 1
+        for m in die.children:
+            if m.tag != 'DW_TAG_member':
+                continue
+            s, a, _ = layout(dies, ref(m, 'DW_AT_type'))
+            align = max(align, a)
+            if tag == 'DW_TAG_union_type':
+                size = max(size, s)
+            else:
+                size = (size+a-1)//a*a+s
+        return (size+align-1)//align*align, align, False
+    raise ValueError('type %s at 0x%x' % (tag, off))
+
+
+def variables(path):
+    """(name, msp430 size) of variables with static storage"""
+    dies = parse(path)
+    result = []
+    for die in dies.values():
+        if die.tag != 'DW_TAG_variable':
+            continue
+        loc = die.attrs.get('DW_AT_location', '')
+        # DW_OP_stack_value .. address as value of an optimized local
+        if ('DW_OP_addr' not in loc) or ('DW_OP_stack_value' in loc):
+            continue
+        decl = die
+        if 'DW_AT_specification' in die.attrs:
+            decl = dies[ref(die, 'DW_AT_specification')]
+        size, _, const = layout(dies, ref(decl, 'DW_AT_type'))
+        if const:
+            continue
+        local = 'DW_AT_external' not in decl.attrs
+        result.append((name(decl), size, local))
+    return result
+
+
+def main(argv):
+    verbose, stack, ram, objects = False, 0, 0, []
+    i = 1
+    while i < len(argv):
+        if argv[i] == '-v':
+            verbose = True
+        elif argv[i] in ('-s', '-r'):
+            i += 1
+            if argv[i-1] == '-s':
+                stack = int(argv[i])
+            else:
+                ram = int(argv[i])
+        else:
+            objects.append(argv[i])
+        i += 1
+
+    seen = set()
+    total = 0
+    for obj in objects:
+        module = 0
+        for var, size, local in sorted(variables(obj)):
+            key = (obj if local else '', var)
+            if key in seen:
+                continue
+            seen.add(key)
+            module += size
+            if verbose:
+                print('    %-28s %4d' % (var, size))
+        total += module
+        print('%-20s %4d' % (re.sub(r'.*/', '', obj), module))
+    print('%-20s %4d' % ('static data', total))
+    if stack:
+        print('%-20s %4d' % ('stack reserve', stack))
+    if ram:
+        print('%-20s %4d of %d' % ('free', ram-total-stack, ram))
+        if total+stack > ram:
+            print('static data and stack reserve exceed ram')
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,424 @@
+/**
+ *
+ * host build frozen dcf77 reference model
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * straightforward copy of the receiver as it was before the detector and memory
+ * optimizations: detector counts all three symbols and signal quality every
+ * tick, coarse histogram has byte bins, minute memory keeps its own buffers and
+ * the minute block is decoded bit by bit, sync. modes and pll are the firmware
+ * ones (pll build, majority filter, adaptive threshold, one channel)
+ *
+ * it's linked with the firmware (fuzz.c feeds both the same samples), keep it
+ * frozen, firmware changes are checked against it
+ *
+ **/
+
+/// include section
+#include <string.h>
+#include "ref_dcf77.h" // self
+
+// parameters (the same defaults and overrides as dcf77.c)
+#define REF_DETECT_PERIOD RTC_SAMPLING_FREQV
+#define REF_S0_PERIOD (RTC_SAMPLING_FREQV/10)
+#define REF_S1_PERIOD (RTC_SAMPLING_FREQV/5)
+#ifndef DCF77_PLL
+#define DCF77_PLL 1
+#endif
+#ifndef DCF77_ADAPTIVE_THRESHOLD
+#define DCF77_ADAPTIVE_THRESHOLD 1
+#endif
+#if (!DCF77_PLL)||(!DCF77_ADAPTIVE_THRESHOLD)
+#error "reference model is the pll build with adaptive threshold"
+#endif
+#ifndef DCF77_MIN_SIGNAL_QUALITY
+#define DCF77_MIN_SIGNAL_QUALITY (RTC_SAMPLING_FREQV/10*9)
+#endif
+#if DCF77_FALSE_ACCEPT>=1000
+#define REF_ADAPT_K4 6
+#elif DCF77_FALSE_ACCEPT>=500
+#define REF_ADAPT_K4 8
+#elif DCF77_FALSE_ACCEPT>=100
+#define REF_ADAPT_K4 15
+#elif DCF77_FALSE_ACCEPT>=10
+#define REF_ADAPT_K4 19
+#else
+#define REF_ADAPT_K4 23
+#endif
+#define REF_ADAPT_SHIFT 4
+#define REF_ADAPT_MIN (RTC_SAMPLING_FREQV/10*6)
+#define REF_ADAPT_MAX (RTC_SAMPLING_FREQV/100*97)
+#define REF_ADAPT_NOISE_INIT (RTC_SAMPLING_FREQV/100*55)
+#define REF_ADAPT_NOISE_DEV_INIT (RTC_SAMPLING_FREQV/100*10)
+#define REF_FILTER_N 5
+#define REF_FILTER_K 3
+#define REF_PLL_WINDOW 8
+#define REF_PLL_KP_SHIFT 2
+#define REF_PLL_KI_SHIFT 6
+#define REF_PLL_ONE 65536L
+#define REF_PLL_INTEG_MAX (REF_PLL_ONE/2)
+#define REF_PLL_HOLD_UNCERT 67L
+#define REF_PLL_MAX_HOLD_SYMBOLS ((int)(REF_PLL_WINDOW*REF_PLL_ONE/REF_PLL_HOLD_UNCERT))
+#define REF_PLL_LOCK_LOSS 10
+#define REF_COARSE_BIN_MAX 15
+#define REF_COARSE_BIN_TICKS (REF_DETECT_PERIOD/REF_COARSE_BINS)
+#define REF_COARSE_SECONDS 5
+#define REF_COARSE_MIN_HITS 4
+#define REF_COARSE_GATE_TIMEOUT 10
+#define REF_COARSE_GATE_HITS 2
+
+/** local functions section **/
+
+static int ref_biggest(int val0, int val1, int val2, int *val)
+{
+    int i=0;
+    int theMost = val0;
+    if (val1>theMost) {theMost=val1;i=1;};
+    if (val2>theMost) {theMost=val2;i=2;};
+    *val = theMost;
+    return i;
+}
+
+static void ref_reset_detector(ref_detector *d, int offset)
+{
+    d->cnt = offset;
+    d->sigQcnt = 0;
+    d->ready = false;
+    d->s0cnt = 0;
+    d->s1cnt = 0;
+    d->sMcnt = 0;
+}
+
+// symbol detector (all counters every tick)
+void ref_detect(ref_dcf77 *r, bool signal, int thr)
+{
+    ref_detector *d = &r->detector;
+    if (d->cnt>=REF_DETECT_PERIOD)
+        ref_reset_detector(d,d->cnt-REF_DETECT_PERIOD);
+
+    if (d->cnt<(REF_S0_PERIOD+r->fault)) // logic 0 (<100ms)
+    {
+        if (signal) {d->s0cnt++;d->s1cnt++;}
+        else d->sMcnt++;
+    }
+    else if (d->cnt<REF_S1_PERIOD) // logic 1 (<200ms)
+    {
+        if (signal) d->s1cnt++;
+        else {d->s0cnt++;d->sMcnt++;}
+    }
+    else // signal quality
+    {
+        d->sigQcnt += signal?0:1;
+    }
+
+    d->cnt++;
+    if (d->cnt>=REF_DETECT_PERIOD)
+    {
+        int symQ;
+        int symI = ref_biggest(d->s0cnt,d->s1cnt,d->sMcnt,&symQ);
+        d->sigQ = d->sigQcnt+symQ;
+        d->sym = (d->sigQ>=thr)?(dcf77_symbol_type)(symI+1):DCF77_SYMBOL_NONE;
+        d->ready = true;
+    }
+}
+
+// adaptive threshold (quality distributions and symbol margin)
+static void ref_adapt(dcf77_adapt_state *a, ref_detector *d)
+{
+    int x = d->sigQ<<REF_ADAPT_SHIFT;
+    int *mean, *dev, diff;
+
+    if (d->sym!=DCF77_SYMBOL_NONE)
+    {
+        int best, second;
+        if (d->s0cnt>=d->s1cnt) {best=d->s0cnt;second=d->s1cnt;} else {best=d->s1cnt;second=d->s0cnt;}
+        if (d->sMcnt>best) {second=best;best=d->sMcnt;}
+        else if (d->sMcnt>second) second=d->sMcnt;
+        a->margin += (((best-second)<<REF_ADAPT_SHIFT)-a->margin)>>REF_ADAPT_SHIFT;
+    }
+
+    if (x<((a->noise_mean+a->signal_mean)>>1)) {mean=&a->noise_mean;dev=&a->noise_dev;}
+    else {mean=&a->signal_mean;dev=&a->signal_dev;}
+    diff = x-*mean;
+    *mean += diff>>REF_ADAPT_SHIFT;
+    if (diff<0) diff=-diff;
+    *dev += (diff-*dev)>>REF_ADAPT_SHIFT;
+
+    int thr = (a->noise_mean+(int)(((long)REF_ADAPT_K4*a->noise_dev)>>2))>>REF_ADAPT_SHIFT;
+    if (thr<REF_ADAPT_MIN) thr=REF_ADAPT_MIN;
+    if (thr>REF_ADAPT_MAX) thr=REF_ADAPT_MAX;
+    a->thr = thr;
+}
+
+// majority filter (k of n samples)
+static bool ref_filter(ref_dcf77 *r, bool in)
+{
+    r->filter_cnt += (in?1:0)-((r->filter_reg>>(REF_FILTER_N-1))&0x01);
+    r->filter_reg = ((r->filter_reg<<1)|(in?1:0))&((1<<REF_FILTER_N)-1);
+    if (r->filter_cnt>=REF_FILTER_K) r->filter_out = true;
+    else if (r->filter_cnt<=(REF_FILTER_N-REF_FILTER_K)) r->filter_out = false;
+    return r->filter_out;
+}
+
+static void ref_coarse_reset(ref_dcf77 *r)
+{
+    memset(r->coarse_hist,0,sizeof(r->coarse_hist));
+    r->coarse_seconds = 0;
+    r->coarse_gate = -1;
+    r->coarse_hits = 0;
+}
+
+// coarse synchronization (rising edge phase histogram, locked gate)
+static bool ref_coarse(ref_dcf77 *r, bool edge)
+{
+    bool sync = false;
+    int i, bin = r->coarse_phase/REF_COARSE_BIN_TICKS;
+
+    if (edge)
+    {
+        if (r->coarse_gate<0)
+        {
+            if (r->coarse_hist[bin]<REF_COARSE_BIN_MAX) r->coarse_hist[bin]++;
+        }
+        else if ((bin==r->coarse_gate)||(bin==((r->coarse_gate+1)%REF_COARSE_BINS)))
+        {
+            sync = true;
+            r->coarse_seconds = 0;
+            if (r->coarse_hits<255) r->coarse_hits++;
+        }
+    }
+
+    if (++r->coarse_phase>=REF_DETECT_PERIOD)
+    {
+        r->coarse_phase = 0;
+        r->coarse_seconds++;
+        if (r->coarse_gate<0)
+        {
+            if (r->coarse_seconds>=REF_COARSE_SECONDS)
+            {
+                int best=0, bi=0, second=0;
+                for (i=0;i<REF_COARSE_BINS;i++)
+                {
+                    int sum = r->coarse_hist[i]+r->coarse_hist[(i+1)%REF_COARSE_BINS];
+                    if (sum>best) {best=sum;bi=i;}
+                }
+                for (i=0;i<REF_COARSE_BINS;i++)
+                {
+                    int sum = r->coarse_hist[i]+r->coarse_hist[(i+1)%REF_COARSE_BINS];
+                    int d = (i-bi+REF_COARSE_BINS)%REF_COARSE_BINS;
+                    if ((d>1)&&(d<(REF_COARSE_BINS-1))&&(sum>second)) second=sum;
+                }
+                if ((best>=REF_COARSE_MIN_HITS)&&(best>=(2*second))) r->coarse_gate = bi;
+                else for (i=0;i<REF_COARSE_BINS;i++) r->coarse_hist[i] /= 2;
+                r->coarse_seconds = 0;
+            }
+        }
+        else if (r->coarse_seconds>REF_COARSE_GATE_TIMEOUT)
+        {
+            ref_coarse_reset(r);
+        }
+    }
+    return sync;
+}
+
+static void ref_pll_seed(ref_dcf77 *r)
+{
+    int16_t drift;
+    if (rtc_get_drift(&drift))
+        r->pll_integ = (int32_t)drift*(RTC_SAMPLING_FREQV*REF_PLL_ONE/100000L)/100L;
+    r->pll_frac = 0;
+    r->pll_miss = 0;
+}
+
+// pll, returns detector shift
+static int ref_pll(ref_dcf77 *r, bool edge)
+{
+    int shift = 0;
+    int idx = r->detector.cnt-1;
+    if (idx>=(REF_DETECT_PERIOD/2)) idx-=REF_DETECT_PERIOD;
+
+    if (edge&&(!r->pll_edge)&&(idx<=REF_PLL_WINDOW)&&(idx>=-REF_PLL_WINDOW))
+    {
+        r->pll_err = idx;
+        r->pll_edge = true;
+    }
+
+    if (idx<0) r->pll_filtered = false;
+    if ((idx==(REF_PLL_WINDOW+1))&&(!r->pll_filtered))
+    {
+        r->pll_filtered = true;
+        if (r->pll_edge)
+        {
+            r->pll_integ += ((int32_t)r->pll_err*REF_PLL_ONE)>>REF_PLL_KI_SHIFT;
+            if (r->pll_integ>REF_PLL_INTEG_MAX) r->pll_integ=REF_PLL_INTEG_MAX;
+            if (r->pll_integ<-REF_PLL_INTEG_MAX) r->pll_integ=-REF_PLL_INTEG_MAX;
+            r->pll_frac += ((int32_t)r->pll_err*REF_PLL_ONE)>>REF_PLL_KP_SHIFT;
+            r->pll_miss = 0;
+        }
+        else if ((r->sync_mode==DCF77SYNC_FINE)&&(r->pll_miss<255)) r->pll_miss++;
+        r->pll_frac += r->pll_integ;
+        while (r->pll_frac>=REF_PLL_ONE) {r->pll_frac-=REF_PLL_ONE;shift--;}
+        while (r->pll_frac<=-REF_PLL_ONE) {r->pll_frac+=REF_PLL_ONE;shift++;}
+        r->pll_edge = false;
+    }
+    return shift;
+}
+
+// minute block bit
+static uint8_t ref_bit(uint16_t *buf, uint8_t i)
+{
+    return (buf[i>>4]>>(i&0x0F))&0x01;
+}
+
+// bcd field value, field bits are added to parity
+static uint8_t ref_field(uint16_t *data, uint8_t first, uint8_t len, uint8_t *parity)
+{
+    const uint8_t weight[8] = {1,2,4,8,10,20,40,80};
+    uint8_t i, v = 0;
+    for (i=0;i<len;i++)
+    {
+        if (ref_bit(data,first+i))
+        {
+            v += weight[i];
+            *parity ^= 1;
+        }
+    }
+    return v;
+}
+
+// minute block decoder (bit by bit, dcf77 code description)
+static dcf77_decode_result ref_decode(uint16_t *data, uint16_t *valid, tstruct *t)
+{
+    uint8_t i, p;
+
+    for (i=0;i<64;i++) if (ref_bit(valid,i)) return DCF77_DECODE_INVALID;
+
+    #if DCF77_TEST_PARITY
+    if (ref_bit(data,0)!=0) return DCF77_DECODE_MARKER;
+    if (ref_bit(data,20)!=1) return DCF77_DECODE_MARKER;
+    #endif
+
+    p = 0;
+    t->minute = ref_field(data,21,7,&p);
+    #if DCF77_TEST_PARITY
+    if (p!=ref_bit(data,28)) return DCF77_DECODE_PARITY;
+    if (t->minute>59) return DCF77_DECODE_RANGE;
+    #endif
+
+    p = 0;
+    t->hour = ref_field(data,29,6,&p);
+    #if DCF77_TEST_PARITY
+    if (p!=ref_bit(data,35)) return DCF77_DECODE_PARITY;
+    if (t->hour>23) return DCF77_DECODE_RANGE;
+    #endif
+
+    p = 0;
+    ref_field(data,36,6,&p);
+    t->dayow = ref_field(data,42,3,&p)-1;
+    ref_field(data,45,5,&p);
+    ref_field(data,50,8,&p);
+    #if DCF77_TEST_PARITY
+    if (p!=ref_bit(data,58)) return DCF77_DECODE_PARITY;
+    if (t->dayow==7) return DCF77_DECODE_RANGE;
+    #endif
+
+    t->second = 0;
+    return DCF77_DECODE_OK;
+}
+
+/** global functions section **/
+
+void ref_init(ref_dcf77 *r, int fault)
+{
+    memset(r,0,sizeof(ref_dcf77));
+    r->fault = fault;
+    r->sync_mode = DCF77SYNC_COARSE;
+    r->coarse_gate = -1;
+    r->adapt.thr = DCF77_MIN_SIGNAL_QUALITY;
+    r->adapt.noise_mean = REF_ADAPT_NOISE_INIT<<REF_ADAPT_SHIFT;
+    r->adapt.noise_dev = REF_ADAPT_NOISE_DEV_INIT<<REF_ADAPT_SHIFT;
+    r->adapt.signal_mean = DCF77_MIN_SIGNAL_QUALITY<<REF_ADAPT_SHIFT;
+    r->adapt.signal_dev = REF_ADAPT_NOISE_DEV_INIT<<REF_ADAPT_SHIFT;
+}
+
+bool ref_strobe(ref_dcf77 *r, bool in)
+{
+    ref_detector *d = &r->detector;
+    bool sig = ref_filter(r,in);
+    bool edge = (sig!=r->last_sig)&&sig;
+
+    if (r->sync_mode==DCF77SYNC_COARSE)
+    {
+        bool sync = ref_coarse(r,edge);
+        if (d->ready)
+        {
+            if ((r->coarse_gate>=0)&&(r->coarse_hits>=REF_COARSE_GATE_HITS)&&
+                (d->sym!=DCF77_SYMBOL_MINUTE)&&(d->sym!=DCF77_SYMBOL_NONE))
+            {
+                ref_pll_seed(r);
+                r->sync_mode = DCF77SYNC_FINE;
+            }
+        }
+        else if (sync) ref_reset_detector(d,0);
+    }
+
+    ref_detect(r,sig,r->adapt.thr);
+    if (d->ready) ref_adapt(&r->adapt,d);
+
+    if (r->sync_mode==DCF77SYNC_FINE)
+    {
+        if (d->ready&&(d->sym==DCF77_SYMBOL_NONE))
+        {
+            r->sync_mode = DCF77SYNC_HOLD;
+            r->hold_counter = 0;
+        }
+        d->cnt += ref_pll(r,edge);
+        if (r->pll_miss>=REF_PLL_LOCK_LOSS)
+        {
+            r->sync_mode = DCF77SYNC_COARSE;
+            ref_coarse_reset(r);
+        }
+    }
+
+    if (r->sync_mode==DCF77SYNC_HOLD)
+    {
+        d->cnt += ref_pll(r,false);
+        if (d->ready)
+        {
+            if ((d->sym==DCF77_SYMBOL_NONE)||(d->sym==DCF77_SYMBOL_MINUTE))
+            {
+                if (++r->hold_counter>REF_PLL_MAX_HOLD_SYMBOLS)
+                {
+                    r->sync_mode = DCF77SYNC_COARSE;
+                    ref_coarse_reset(r);
+                }
+            }
+            else r->sync_mode = DCF77SYNC_FINE;
+        }
+    }
+
+    r->last_sig = sig;
+    return d->ready;
+}
+
+int ref_symbol(ref_dcf77 *r, dcf77_symbol_type sym)
+{
+    int res = -1;
+    if (sym==DCF77_SYMBOL_1) r->data[r->mcnt>>4] |= 1<<(r->mcnt&0x0F);
+    if (sym==DCF77_SYMBOL_NONE) r->valid[r->mcnt>>4] |= 1<<(r->mcnt&0x0F);
+    r->mcnt++;
+
+    if ((r->mcnt==60)||(sym==DCF77_SYMBOL_MINUTE))
+    {
+        res = DCF77_DECODE_LENGTH;
+        if ((r->mcnt==60)&&((sym==DCF77_SYMBOL_MINUTE)||(sym==DCF77_SYMBOL_NONE)))
+            res = ref_decode(r->data,r->valid,&r->time);
+        r->decodes[res]++;
+        r->mcnt = 0;
+        memset(r->data,0,sizeof(r->data));
+        memset(r->valid,0,sizeof(r->valid));
+    }
+    return res;
+}
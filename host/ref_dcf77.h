@@ -0,0 +1,64 @@
+/**
+ *
+ * host build frozen dcf77 reference model header
+ *
+ **/
+
+#ifndef __REF_DCF77_H__
+#define __REF_DCF77_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "rtc.h"
+#include "dcf77.h"
+
+#define REF_WINDOWS 3 // detector pulse windows (logic 0, logic 1) and the rest
+#define REF_COARSE_BINS 32
+
+// symbol detector (counters of all symbols every tick)
+typedef struct {
+    int cnt;
+    dcf77_symbol_type sym;
+    int sigQcnt, sigQ;
+    bool ready;
+    int s0cnt, s1cnt, sMcnt;
+} ref_detector;
+
+// one receiver (filter, sync. modes, pll, adaptive threshold, minute memory)
+typedef struct {
+    // model fault (window of logic 0 longer by fault ticks), harness self test
+    int fault;
+
+    uint8_t filter_reg, filter_cnt;
+    bool filter_out;
+    bool last_sig;
+    ref_detector detector;
+    dcf77_sync_mode_type sync_mode;
+    int hold_counter;
+    int32_t pll_integ, pll_frac;
+    int pll_err;
+    bool pll_edge, pll_filtered;
+    uint8_t pll_miss;
+    dcf77_adapt_state adapt;
+    uint8_t coarse_hist[REF_COARSE_BINS];
+    int coarse_phase;
+    uint8_t coarse_seconds;
+    int8_t coarse_gate;
+    uint8_t coarse_hits;
+
+    // minute memory and decoder results
+    uint16_t data[4], valid[4];
+    int mcnt;
+    uint16_t decodes[DCF77_DECODE_RANGE+1]; // per result
+    tstruct time; // last decoded time
+} ref_dcf77;
+
+void ref_init(ref_dcf77 *r, int fault);
+// one sample, returns true when symbol detected (r->detector.sym and sigQ)
+bool ref_strobe(ref_dcf77 *r, bool in);
+// symbol detector only (benchmark)
+void ref_detect(ref_dcf77 *r, bool signal, int thr);
+// symbol into minute memory, returns decoder result or -1 (minute not complete)
+int ref_symbol(ref_dcf77 *r, dcf77_symbol_type sym);
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ *
+ * host build synthetic dcf77 signal
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * am second marks as the receiver outputs them (pulse 100ms .. 0, 200ms .. 1,
+ * no pulse in second 59), the minute frame encodes the next minute (minute,
+ * hour, day of month, day of week, month, year with parities), impulse noise
+ * flips output samples and during an outage the output is random
+ *
+ **/
+
+/// include section
+#include <math.h>
+#include "signal.h" // self
+
+#define SIGNAL_WEEK (7*86400.0)
+
+/** local functions section **/
+
+// bcd field into frame bits (adds bits to even parity)
+static void signal_bcd(uint8_t *bits, int first, int len, int v, uint8_t *parity)
+{
+    int i, bcd = ((v/10)<<4)|(v%10);
+    for (i=0;i<len;i++)
+    {
+        bits[first+i] = (bcd>>i)&0x01;
+        *parity ^= bits[first+i];
+    }
+}
+
+/** global functions section **/
+
+// xorshift32 random generator
+uint32_t signal_random(uint32_t *seed)
+{
+    uint32_t x = *seed;
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    *seed = x;
+    return x;
+}
+
+// signal starting at given transmitter time
+void signal_init(signal_type *s, int dayow, int hour, int minute, double second, uint32_t seed)
+{
+    s->start = dayow*86400.0+hour*3600.0+minute*60.0+second;
+    s->noise = 0.0;
+    s->outage_from = s->outage_to = 0.0;
+    s->seed = seed?seed:1;
+    s->frame_minute = -1;
+}
+
+// transmitter time at real time
+double signal_time(const signal_type *s, double t)
+{
+    return fmod(s->start+t,SIGNAL_WEEK);
+}
+
+// transmitter time to time structure
+void signal_tstruct(double time, tstruct *ts)
+{
+    long sec = (long)floor(time);
+    ts->second = sec%60;
+    ts->minute = sec/60%60;
+    ts->hour = sec/3600%24;
+    ts->dayow = sec/86400%7;
+}
+
+// minute frame (day 15.6.2024, only day of week follows the time)
+void signal_frame(double time, uint8_t bits[60])
+{
+    tstruct t;
+    uint8_t p;
+    int i;
+    signal_tstruct(fmod(floor(time/60.0)*60.0+60.0,SIGNAL_WEEK),&t);
+    for (i=0;i<60;i++) bits[i] = 0;
+    bits[20] = 1; // start of time
+    p = 0; signal_bcd(bits,21,7,t.minute,&p); bits[28] = p;
+    p = 0; signal_bcd(bits,29,6,t.hour,&p); bits[35] = p;
+    p = 0;
+    signal_bcd(bits,36,6,15,&p); // day
+    signal_bcd(bits,42,3,t.dayow+1,&p);
+    signal_bcd(bits,45,5,6,&p); // month
+    signal_bcd(bits,50,8,24,&p); // year
+    bits[58] = p;
+}
+
+// receiver output (true .. pulse)
+bool signal_input(void *ctx, double t)
+{
+    signal_type *s = (signal_type*)ctx;
+    if ((t>=s->outage_from)&&(t<s->outage_to)) return (signal_random(&s->seed)&0x01)!=0;
+
+    double time = signal_time(s,t);
+    double sec = floor(time);
+    int second = (long)sec%60;
+    bool pulse = false;
+    if (second!=59)
+    {
+        long minute = (long)sec/60;
+        if (minute!=s->frame_minute)
+        {
+            signal_frame(time,s->bits);
+            s->frame_minute = minute;
+        }
+        pulse = (time-sec)<(s->bits[second]?0.2:0.1);
+    }
+    if ((s->noise>0.0)&&((signal_random(&s->seed)>>8)<(uint32_t)(s->noise*16777216.0))) pulse = !pulse;
+    return pulse;
+}
@@ -0,0 +1,31 @@
+/**
+ *
+ * host build synthetic dcf77 signal header
+ *
+ **/
+
+#ifndef __SIGNAL_H__
+#define __SIGNAL_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "rtc.h"
+
+// transmitter and receiver (time in seconds of week, monday 00:00:00 .. 0)
+typedef struct {
+    double start; // transmitter time at real time 0
+    double noise; // probability of a wrong receiver output sample
+    double outage_from, outage_to; // real time of carrier loss (receiver output random)
+    uint32_t seed; // random generator state (not 0)
+    long frame_minute; // minute of the cached frame
+    uint8_t bits[60];
+} signal_type;
+
+void signal_init(signal_type *s, int dayow, int hour, int minute, double second, uint32_t seed);
+bool signal_input(void *ctx, double t); // receiver output at real time t (hw_input_fn)
+double signal_time(const signal_type *s, double t); // transmitter time at real time t
+void signal_tstruct(double time, tstruct *ts); // transmitter time to time structure (whole seconds)
+void signal_frame(double time, uint8_t bits[60]); // bits sent in the minute of time (they encode the next minute)
+uint32_t signal_random(uint32_t *seed); // xorshift32
+
+#endif
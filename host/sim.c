@@ -0,0 +1,133 @@
+/**
+ *
+ * trace simulator (one clock, synthetic dcf77 signal)
+ *
+ * usage: sim [-m minutes] [-p ppm] [-n noise] [-s second] [-o from:to] [-f file] [-v]
+ *   -m .. simulated minutes (default 30)
+ *   -p .. crystal error (ppm, default 0)
+ *   -n .. receiver output sample error probability (default 0)
+ *   -s .. transmitter second at start (default 0.37, phase against the clock)
+ *   -o .. carrier outage (real seconds from:to)
+ *   -f .. information flash image file (warm start when it exists, persistent state
+ *         saved into it hourly as on the target, so the next run starts from it)
+ *   -v .. trace sync. mode changes, decodes and uart output
+ *
+ * the duty cycle accounting build (DUTY_ACCT) runs, so the summary has the cpu
+ * awake time per subsystem (cpu cost model of hw.c, microseconds per second and
+ * the longest section)
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "dcf77.h"
+#include "duty.h"
+
+bool verbose = false;
+const char *duty_name[DUTY_SUBSYSTEMS] = {"timer","rx","tx","button","lcd","main"};
+char line[64];
+int line_len = 0;
+
+// uart output lines
+void tx_line(void *ctx, char c, hw_time t)
+{
+    if ((c!='\r')&&(c!='\n')&&(line_len<(int)sizeof(line)-1)) line[line_len++] = c;
+    if (c=='\n')
+    {
+        line[line_len] = '\0';
+        if (verbose) printf("%9.3f uart %s\n",hw_real_time(),line);
+        line_len = 0;
+    }
+}
+
+// rtc time minus transmitter time (s, wrapped within half a week)
+double rtc_error(signal_type *s)
+{
+    tstruct t;
+    rtc_get_time(&t);
+    double rtc = t.dayow*86400.0+t.hour*3600.0+t.minute*60.0+t.second+(double)rtc_get_subsecond()/RTC_SAMPLING_FREQV;
+    double e = rtc-signal_time(s,hw_real_time());
+    if (e>3.5*86400) e -= 7*86400;
+    if (e<-3.5*86400) e += 7*86400;
+    return e;
+}
+
+int main(int argc, char **argv)
+{
+    int minutes = 30, opt;
+    double ppm = 0.0, noise = 0.0, second = 0.37, out_from = 0.0, out_to = 0.0;
+    const char *image = 0;
+    while ((opt=getopt(argc,argv,"m:p:n:s:o:f:v"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'm': minutes = atoi(optarg); break;
+            case 'p': ppm = atof(optarg); break;
+            case 'n': noise = atof(optarg); break;
+            case 's': second = atof(optarg); break;
+            case 'o': if (sscanf(optarg,"%lf:%lf",&out_from,&out_to)!=2) return 1; break;
+            case 'f': image = optarg; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr,"usage: sim [-m minutes] [-p ppm] [-n noise] [-s second] [-o from:to] [-f file] [-v]\n");
+                return 1;
+        }
+    }
+
+    signal_type s;
+    signal_init(&s,2,10,0,second,1);
+    s.noise = noise;
+    s.outage_from = out_from;
+    s.outage_to = out_to;
+
+    hw_init();
+    hw_set_flash_file(image);
+    hw_set_input(signal_input,&s);
+    hw_set_tx(tx_line,0);
+    hw_set_ppm(ppm);
+    main_init();
+
+    long ticks = (long)minutes*60*RTC_SAMPLING_FREQV, k;
+    double first_fine = -1.0, first_decode = -1.0, max_err = 0.0;
+    uint16_t decodes = 0;
+    dcf77_sync_mode_type mode = DCF77SYNC_COARSE;
+    for (k=0;k<ticks;k++)
+    {
+        hw_run(HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV);
+        if (dcf77_get_sync_mode()!=mode)
+        {
+            mode = dcf77_get_sync_mode();
+            if ((mode==DCF77SYNC_FINE)&&(first_fine<0)) first_fine = hw_real_time();
+            if (verbose) printf("%9.3f mode %d\n",hw_real_time(),mode);
+        }
+        if (dcf77_get_decodes()!=decodes)
+        {
+            decodes = dcf77_get_decodes();
+            if (first_decode<0) first_decode = hw_real_time();
+            if (verbose) printf("%9.3f decode %u error %.1f ms\n",hw_real_time(),decodes,rtc_error(&s)*1000);
+        }
+        if ((first_decode>=0)&&((k%RTC_SAMPLING_FREQV)==0))
+        {
+            double e = fabs(rtc_error(&s));
+            if (e>max_err) max_err = e;
+        }
+    }
+
+    int16_t drift;
+    bool drift_valid = rtc_get_drift(&drift);
+    printf("minutes %d decodes %u first fine %.1f s first decode %.1f s max error %.1f ms drift %s %.1f ppm shifts %u\n",
+        minutes,decodes,first_fine,first_decode,max_err*1000,drift_valid?"valid":"unknown",drift/10.0,dcf77_get_shifts());
+    int i;
+    printf("awake us/s (max us)");
+    for (i=0;i<DUTY_SUBSYSTEMS;i++)
+        printf(" %s %.1f (%u)",duty_name[i],duty_get_ticks(i)*(1000000.0/DUTY_TICK_FREQV)/(minutes*60.0),
+            (unsigned int)(duty_get_max(i)*(1000000L/DUTY_TICK_FREQV)));
+    printf("\n");
+    return 0;
+}
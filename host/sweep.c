@@ -0,0 +1,231 @@
+/**
+ *
+ * decoder parameter sweep (bit-sliced batch receiver over many traces)
+ *
+ * usage: sweep [-n traces] [-m minutes] [-s seed] [-q thr,..] [-f offset,..] [-c votes,..] [-x] [file ..]
+ *   -n .. synthetic traces (default 256)
+ *   -m .. minutes of synthetic traces (default 10)
+ *   -s .. seed of the first synthetic trace (default 1, trace i has seed+i)
+ *   -q .. signal quality thresholds (DCF77_MIN_SIGNAL_QUALITY, 0 .. adaptive threshold
+ *         as shipped, default 0,459)
+ *   -f .. sooner/later detectors offsets (DCF77_FINESYNC_OFFSET, default 3)
+ *   -c .. votes to shift (DCF77_FINETUNE_SYMCOUNT, default 10)
+ *   -x .. check every lane against the firmware functions (slow, exit code 1 on difference)
+ *   file .. recorded receiver output (512 Hz samples '0' or '1', other chars ignored),
+ *           traces are cut to the shortest one
+ *
+ * every parameter set (all combinations of the lists) runs over all traces, lanes
+ * of the batch receiver are traces times parameter sets, one line per set: symbols,
+ * decoder results and shifts summed over traces, synthetic traces start anywhere in
+ * the second with receiver noise (0 .. 30%) and crystal error (+-200 ppm), every trace
+ * is aligned by the coarse acquisition first (batch_align, the same histogram and gate
+ * as the firmware), the ones without it in a minute run from the first sample
+ *
+ * lanes are the early/late votes receiver (DCF77_PLL 0) staying in fine sync., the
+ * shipped pll build (DCF77_PLL 1) isn't modelled, noise and fleet run its receiver
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "hw.h"
+#include "rtc.h"
+#include "batch.h"
+
+#define MAX_VALUES 16
+#define ACQUIRE_SECONDS 60 // traces without coarse acquisition by then run from the first sample
+#define USAGE "usage: sweep [-n traces] [-m minutes] [-s seed] [-q thr,..] [-f offset,..] [-c votes,..] [-x] [file ..]\n"
+
+batch_state b;
+
+// results of one parameter set (summed over traces)
+typedef struct {
+    long symbols[DCF77_SYMBOL_MINUTE+1];
+    long decodes[DCF77_DECODE_RANGE+1];
+    long shifts;
+} sum_type;
+
+typedef struct {
+    int v[MAX_VALUES];
+    int n;
+} list_type;
+
+// comma separated values
+int list(list_type *l, const char *s)
+{
+    char *end;
+    l->n = 0;
+    do
+    {
+        if (l->n>=MAX_VALUES) return -1;
+        l->v[l->n++] = strtol(s,&end,0);
+        if (end==s) return -1;
+        s = end+1;
+    } while (*end==',');
+    return (*end=='\0')?0:-1;
+}
+
+// recorded trace file, returns samples (-1 .. error)
+long load(const char *name, uint64_t **trace)
+{
+    FILE *f = fopen(name,"r");
+    long n = 0, size = 0;
+    int c;
+    if (f==0) {perror(name);return -1;}
+    *trace = 0;
+    while ((c=fgetc(f))!=EOF)
+    {
+        if ((c!='0')&&(c!='1')) continue;
+        if (n>=size*64)
+        {
+            long grown = size?2*size:1024;
+            *trace = realloc(*trace,grown*sizeof(uint64_t));
+            memset(*trace+size,0,(grown-size)*sizeof(uint64_t));
+            size = grown;
+        }
+        if (c=='1') (*trace)[n>>6] |= 1ULL<<(n&63);
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+double wall(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    int traces = 256, opt, i, l;
+    double minutes = 10.0;
+    uint32_t seed = 1;
+    bool check = false;
+    list_type thr = {{0,RTC_SAMPLING_FREQV/10*9},2}, offset = {{3},1}, votes = {{10},1};
+    while ((opt=getopt(argc,argv,"n:m:s:q:f:c:x"))!=-1)
+    {
+        switch (opt)
+        {
+            case 'n': traces = atoi(optarg); break;
+            case 'm': minutes = atof(optarg); break;
+            case 's': seed = strtoul(optarg,0,0); break;
+            case 'q': if (list(&thr,optarg)<0) {fprintf(stderr,USAGE);return 2;} break;
+            case 'f': if (list(&offset,optarg)<0) {fprintf(stderr,USAGE);return 2;} break;
+            case 'c': if (list(&votes,optarg)<0) {fprintf(stderr,USAGE);return 2;} break;
+            case 'x': check = true; break;
+            default: fprintf(stderr,USAGE); return 2;
+        }
+    }
+    if (optind<argc) traces = argc-optind;
+    if ((traces<1)||(minutes<=0)) {fprintf(stderr,USAGE);return 2;}
+
+    // traces aligned to their second marks (cut to the shortest)
+    uint64_t **trace = malloc(traces*sizeof(uint64_t *));
+    long ticks = (long)(minutes*60.0*RTC_SAMPLING_FREQV), length = ticks;
+    int unaligned = 0;
+    for (i=0;i<traces;i++)
+    {
+        long n = length;
+        if (optind<argc)
+        {
+            n = load(argv[optind+i],&trace[i]);
+            if (n<0) return 1;
+        }
+        else
+        {
+            trace[i] = malloc(((n+63)/64)*sizeof(uint64_t));
+            batch_trace(trace[i],n,seed+i,(i%7)*0.05,(double)((int)((seed+i)*37u%401)-200),
+                (double)((seed+i)*131u%1000)/1000.0);
+        }
+        long a = batch_align(trace[i],n,ACQUIRE_SECONDS*RTC_SAMPLING_FREQV);
+        if (a<0) unaligned++;
+        else n = a;
+        if ((i==0)||(n<ticks)) ticks = n;
+    }
+    if (ticks<RTC_SAMPLING_FREQV) {fprintf(stderr,"traces shorter than a second\n");return 1;}
+
+    // parameter sets
+    int sets = thr.n*offset.n*votes.n;
+    batch_param *param = malloc(sets*sizeof(batch_param));
+    sum_type *sum = calloc(sets,sizeof(sum_type));
+    for (i=0;i<sets;i++)
+    {
+        param[i].thr = thr.v[i%thr.n];
+        param[i].offset = offset.v[(i/thr.n)%offset.n];
+        param[i].symcount = votes.v[i/(thr.n*offset.n)];
+    }
+
+    // lanes (set, trace) in batches
+    long lanes = (long)sets*traces, first, diff = 0;
+    double t0 = wall(), reference = 0.0;
+    for (first=0;first<lanes;first+=BATCH_LANES)
+    {
+        batch_param p[BATCH_LANES];
+        const uint64_t *t[BATCH_LANES];
+        int n = (lanes-first<BATCH_LANES)?lanes-first:BATCH_LANES;
+        for (l=0;l<n;l++)
+        {
+            p[l] = param[(first+l)/traces];
+            t[l] = trace[(first+l)%traces];
+        }
+        if (batch_init(&b,p,n)<0)
+        {
+            fprintf(stderr,"offset out of range (shifts leave the first detector window), negative votes or threshold\n");
+            return 1;
+        }
+        batch_run(&b,t,ticks);
+        for (l=0;l<n;l++)
+        {
+            batch_result *r = &b.result[l];
+            sum_type *s = &sum[(first+l)/traces];
+            for (i=0;i<=DCF77_SYMBOL_MINUTE;i++) s->symbols[i] += r->symbols[i];
+            for (i=0;i<=DCF77_DECODE_RANGE;i++) s->decodes[i] += r->decodes[i];
+            s->shifts += r->shifts;
+        }
+        if (check)
+        {
+            double c0 = wall();
+            for (l=0;l<n;l++)
+            {
+                batch_result ref;
+                batch_reference(&p[l],t[l],ticks,&ref);
+                if (!batch_equal(&b.result[l],&ref))
+                {
+                    if (diff==0) printf("lane %ld (thr %d offset %d votes %d, trace %ld) differs from firmware\n",
+                        first+l,p[l].thr,p[l].offset,p[l].symcount,(first+l)%traces);
+                    diff++;
+                }
+            }
+            reference += wall()-c0;
+        }
+    }
+    double elapsed = wall()-t0-reference;
+
+    printf("early/late votes receiver (DCF77_PLL 0), thr 0 .. adaptive threshold, %d of %d traces aligned\n",
+        traces-unaligned,traces);
+    printf("  thr offset votes  symbols none      0      1 minute  decodes ok  fail   shifts\n");
+    for (i=0;i<sets;i++)
+    {
+        sum_type *s = &sum[i];
+        long fail = 0;
+        int k;
+        for (k=DCF77_DECODE_INVALID;k<=DCF77_DECODE_RANGE;k++) fail += s->decodes[k];
+        printf("%5d %6d %5d  %12ld %6ld %6ld %6ld  %10ld %5ld %8ld\n",param[i].thr,param[i].offset,param[i].symcount,
+            s->symbols[DCF77_SYMBOL_NONE],s->symbols[DCF77_SYMBOL_0],s->symbols[DCF77_SYMBOL_1],
+            s->symbols[DCF77_SYMBOL_MINUTE],s->decodes[DCF77_DECODE_OK],fail,s->shifts);
+    }
+    printf("%ld lanes (%d sets x %d traces) %.0f s each in %.2f s, %.0f lane seconds/s (batch of %d)\n",
+        lanes,sets,traces,(double)ticks/RTC_SAMPLING_FREQV,elapsed,
+        lanes*((double)ticks/RTC_SAMPLING_FREQV)/elapsed,BATCH_LANES);
+    if (check)
+    {
+        printf("firmware functions %.2f s (%.1fx), %ld lanes differ\n",reference,reference/elapsed,diff);
+        if (diff) return 1;
+    }
+    return 0;
+}
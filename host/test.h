@@ -0,0 +1,20 @@
+/**
+ *
+ * host build tests helpers
+ *
+ **/
+
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+
+// failed checks (test returns non zero exit code)
+static int test_failed = 0;
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: check failed: %s\n",__FILE__,__LINE__,#c); test_failed++; } } while (0)
+#define CHECK_INT(a,b) do { long _a=(long)(a), _b=(long)(b); if (_a!=_b) { \
+    printf("%s:%d: check failed: %s == %s (%ld != %ld)\n",__FILE__,__LINE__,#a,#b,_a,_b); test_failed++; } } while (0)
+#define TEST_RESULT() (test_failed?(printf("%d checks failed\n",test_failed),1):0)
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ *
+ * batch receiver test (coarse acquisition of traces starting anywhere in the second,
+ * bit-sliced lanes against the firmware functions lane by lane, traces with noise and
+ * crystal error, every lane group with other parameters, adaptive threshold ones too)
+ *
+ **/
+
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "hw.h"
+#include "rtc.h"
+#include "batch.h"
+#include "test.h"
+
+#define TRACES (BATCH_LANES/4)
+#define TICKS (8*60L*RTC_SAMPLING_FREQV)
+#define SPLIT (1000*64L) // the second run continues (64 tick words)
+
+// threshold, offset, votes (the firmware defaults first, adaptive threshold)
+const batch_param params[4] = {{0,3,10},{RTC_SAMPLING_FREQV/10*9,1,2},{480,6,5},{300,10,0}};
+const double noise[4] = {0.0,0.02,0.1,0.3};
+const double ppm[8] = {0.0,50.0,-50.0,300.0,-300.0,1000.0,-1000.0,20.0};
+
+batch_state b;
+uint64_t traces[TRACES][(TICKS+63)/64];
+
+int main(void)
+{
+    batch_param param[BATCH_LANES];
+    const uint64_t *trace[BATCH_LANES];
+    batch_result ref;
+    int l, i, diff = 0, shifts = 0, decodes = 0, aligned = 0, adapted = 0, tracked = 0;
+    long ticks = TICKS;
+    clock_t t0, t1, t2;
+
+    // traces aligned by the coarse acquisition (all but the 30% noise ones), clean ones at
+    // their second mark, noisy ones a few ticks off at most
+    for (i=0;i<TRACES;i++)
+    {
+        double second = (double)(i*131%1000)/1000.0;
+        batch_trace(traces[i],TICKS,i+1,noise[i%4],ppm[(i/4)%8],second);
+        long k = batch_acquire(traces[i],TICKS);
+        if (k>=0)
+        {
+            double t = second+k*(1.0+ppm[(i/4)%8]*1e-6)/RTC_SAMPLING_FREQV;
+            double e = (t-floor(t+0.5))*RTC_SAMPLING_FREQV;
+            if (noise[i%4]==0.0) CHECK((e>=0.0)&&(e<1.0));
+            else CHECK(fabs(e)<4.0);
+        }
+        long n = batch_align(traces[i],TICKS,TICKS);
+        CHECK_INT(n,(k<0)?-1:TICKS-k);
+        if (n<0) continue;
+        aligned++;
+        if (n<ticks) ticks = n;
+    }
+    CHECK(aligned>=TRACES/4*3);
+    CHECK(ticks>=TICKS-20*RTC_SAMPLING_FREQV);
+    for (l=0;l<BATCH_LANES;l++)
+    {
+        param[l] = params[l/TRACES];
+        trace[l] = traces[l%TRACES];
+    }
+
+    // parameters out of range (shifts leave the first window)
+    param[0].offset = 30;
+    CHECK(batch_init(&b,param,BATCH_LANES)<0);
+    param[0].offset = params[0].offset;
+
+    t0 = clock();
+    CHECK(batch_init(&b,param,BATCH_LANES)==0);
+    batch_run(&b,trace,SPLIT);
+    for (l=0;l<BATCH_LANES;l++) trace[l] += SPLIT/64;
+    batch_run(&b,trace,ticks-SPLIT);
+    t1 = clock();
+
+    // every lane bit exact (symbols, qualities and shifts in order, votes, decoder results, time)
+    for (l=0;l<BATCH_LANES;l++)
+    {
+        batch_result *r = &b.result[l];
+        batch_reference(&param[l],traces[l%TRACES],ticks,&ref);
+        if (!batch_equal(r,&ref))
+        {
+            if (diff==0) printf("lane %d: shifts %d votes %d decodes %d, reference %d %d %d\n",l,
+                r->shifts,r->ft,r->decodes[DCF77_DECODE_OK],ref.shifts,ref.ft,ref.decodes[DCF77_DECODE_OK]);
+            diff++;
+        }
+        shifts += r->shifts;
+        if ((l<TRACES)&&(noise[l%4]<0.05)&&(fabs(ppm[(l/4)%8])<=50.0))
+        {
+            tracked++;
+            decodes += r->decodes[DCF77_DECODE_OK];
+        }
+        if ((l<TRACES)&&(r->thr!=RTC_SAMPLING_FREQV/10*9)) adapted++;
+    }
+    t2 = clock();
+    CHECK_INT(diff,0);
+
+    // clean and little noise traces within the votes tracking range (a shift per 11 votes
+    // follows 170 ppm) decode with firmware parameters, votes shift detectors, adaptive
+    // thresholds move from their initial value
+    CHECK(decodes>=tracked*5);
+    CHECK(shifts>0);
+    CHECK(adapted>=TRACES/2);
+    printf("batch %d lanes %.0f s of signal (%d of %d traces aligned): %.2f s, firmware functions %.2f s, decodes %d shifts %d\n",
+        BATCH_LANES,(double)ticks/RTC_SAMPLING_FREQV,aligned,TRACES,(double)(t1-t0)/CLOCKS_PER_SEC,
+        (double)(t2-t1)/CLOCKS_PER_SEC,decodes,shifts);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,122 @@
+/**
+ *
+ * rs485 bus test (bus build: addressed commands, the longest line, line coming to a locked
+ * buffer, broadcast reply slots)
+ *
+ **/
+
+#include <string.h>
+#include <math.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "sched.h"
+#include "test.h"
+
+// uart output capture (start of the last line and the line)
+char line[32];
+int line_len = 0;
+bool line_done = false;
+hw_time line_start;
+
+void capture(void *ctx, char c, hw_time t)
+{
+    if (line_len==0) line_start = t-HW_CHAR_CYCLES;
+    if (line_len<(int)sizeof(line)-1) line[line_len++] = c;
+    line[line_len] = '\0';
+    if (c=='\n') line_done = true;
+}
+
+// chars straight to the rx isr (as if they came while the main loop is busy)
+extern volatile uint8_t hw_rxbuf;
+void USCI0RX_ISR(void);
+
+void isr_rx(const char *s)
+{
+    while (*s)
+    {
+        hw_rxbuf = *s++;
+        USCI0RX_ISR();
+    }
+}
+
+// command line to uart (CR terminated), run until it's taken
+void send(const char *s)
+{
+    char buf[32];
+    int len = strlen(s);
+    memcpy(buf,s,len);
+    buf[len++] = '\r';
+    hw_rx(buf,len,hw_now());
+    hw_run((len+2)*HW_CHAR_CYCLES/HW_STEP_CYCLES);
+}
+
+// broadcast status request, returns reply start within transmitter second (s, -1 .. none)
+double broadcast(signal_type *s)
+{
+    line_len = 0;
+    line_done = false;
+    send("@FFT");
+    hw_run(2*HW_ACLK/HW_STEP_CYCLES);
+    if (!line_done) return -1.0;
+    return fmod(signal_time(s,(double)line_start/HW_ACLK),1.0);
+}
+
+int main(void)
+{
+    signal_type s;
+    int n;
+
+    signal_init(&s,2,10,0,0.37,1);
+    hw_init();
+    hw_set_input(signal_input,&s);
+    hw_set_tx(capture,0);
+    main_init();
+    hw_run(HW_ACLK/HW_STEP_CYCLES);
+
+    // not synchronized, broadcast not answered, addressed one is
+    CHECK(broadcast(&s)<0);
+    line_len = 0;
+    send("@01T");
+    hw_run(HW_ACLK/HW_STEP_CYCLES/10);
+    CHECK_INT(line[0],'0');
+    CHECK_INT(line[12],'0');
+
+    // the longest command (schedule entry) fits, longer line is dropped, not truncated
+    n = sched_count();
+    send("@01S00780401");
+    CHECK_INT(sched_count(),n+1);
+    send("@01S00790401F");
+    send("@01S00790401FFFFFFF");
+    CHECK_INT(sched_count(),n+1);
+    send("@02S007A0401"); // other unit
+    CHECK_INT(sched_count(),n+1);
+    send("@01S007B0401");
+    CHECK_INT(sched_count(),n+2);
+
+    // line coming while the previous one isn't processed yet is dropped up to its end
+    // (its tail is not taken as a line when the buffer gets unlocked)
+    isr_rx("@01S007C0401\r*");
+    hw_run(1);
+    CHECK_INT(sched_count(),n+3);
+    send("@01S007D0401");
+    CHECK_INT(sched_count(),n+3);
+    send("@01S007E0401");
+    CHECK_INT(sched_count(),n+4);
+
+    // reply in unit slot (1 .. second slot of the next second) all the minute after sync.
+    // (time error bound grows with age since the last decode)
+    hw_run_until(hw_cycles_at(185.0));
+    uint16_t err;
+    CHECK(rtc_get_quality(&err)==RTC_QUALITY_SYNCED);
+    for (n=0;n<6;n++)
+    {
+        hw_run_until(hw_cycles_at(185.0+n*9.7));
+        double t = broadcast(&s);
+        if ((t<1.0/16)||(t>2.0/16-0.017)) printf("broadcast %d: reply at %.4f s\n",n,t);
+        CHECK((t>=1.0/16)&&(t<=2.0/16-0.017));
+        CHECK_INT(line[12],'2');
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,135 @@
+/**
+ *
+ * dcf77 synchronization test (coarse to fine sync. at any signal phase, symbol queue
+ * from isr to main loop, pll at +-100 ppm with noise, hold over an outage without
+ * drift estimate)
+ *
+ **/
+
+#include <math.h>
+#include <msp430g2553.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "dcf77.h"
+#include "test.h"
+
+#define DCF77_TEST_MAX_ERR_MS 15.0 // steady state error limit (both crystal error signs)
+
+signal_type s;
+
+// start clock with signal second edge offset ticks after the clock start
+void start(int offset)
+{
+    signal_init(&s,2,10,0,1.0-(double)offset/RTC_SAMPLING_FREQV,1);
+    hw_init();
+    hw_set_input(signal_input,&s);
+    main_init();
+}
+
+// rtc time minus transmitter time (ms, within half a minute)
+double rtc_error_ms(void)
+{
+    tstruct t;
+    rtc_get_time(&t);
+    double rtc = t.minute*60.0+t.second+(double)rtc_get_subsecond()/RTC_SAMPLING_FREQV;
+    double e = fmod(rtc-fmod(signal_time(&s,hw_real_time()),3600.0)+5400.0,3600.0)-1800.0;
+    return e*1000.0;
+}
+
+int main(void)
+{
+    int offset;
+
+    // fine sync. only after the coarse gate is locked (free running detectors find symbols at any phase)
+    for (offset=0;offset<RTC_SAMPLING_FREQV;offset+=20)
+    {
+        start(offset);
+        double fine = -1.0;
+        while (hw_real_time()<130.0)
+        {
+            hw_run(HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV);
+            if ((fine<0)&&(dcf77_get_sync_mode()==DCF77SYNC_FINE)) fine = hw_real_time();
+        }
+        CHECK(fine>=5.0);
+        CHECK(dcf77_get_decodes()>=1);
+        hw_run(HW_ACLK/HW_STEP_CYCLES/2); // mid second
+        double e = rtc_error_ms();
+        if (fabs(e)>=10.0) printf("offset %d ticks: error %.1f ms\n",offset,e);
+        CHECK(fabs(e)<10.0);
+    }
+
+    // signal phase jump (pulses still detected as symbols, no edge in pll window), loss of lock
+    // is detected and the coarse sync. finds the new phase
+    start(100);
+    hw_run_until(hw_cycles_at(150.0));
+    CHECK(dcf77_get_sync_mode()==DCF77SYNC_FINE);
+    s.start += 0.03;
+    double coarse = -1.0;
+    while (hw_real_time()<400.0)
+    {
+        hw_run(HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV);
+        if ((coarse<0)&&(dcf77_get_sync_mode()==DCF77SYNC_COARSE)) coarse = hw_real_time();
+    }
+    CHECK((coarse>150.0)&&(coarse<165.0));
+    CHECK(dcf77_get_sync_mode()==DCF77SYNC_FINE);
+    hw_run(HW_ACLK/HW_STEP_CYCLES/2);
+    CHECK(fabs(rtc_error_ms())<10.0);
+
+    // main loop held for four seconds (receiver isr only), the queue keeps two symbols
+    // and the other two are counted as dropped, main loop takes both queued ones later
+    uint16_t drops = dcf77_get_queue_drops(), decodes = dcf77_get_decodes();
+    double t0 = hw_real_time();
+    int k;
+    for (k=0;k<4*RTC_SAMPLING_FREQV;k++)
+    {
+        bool pulse = signal_input(&s,t0+(double)k/RTC_SAMPLING_FREQV);
+        P1IN = pulse?(P1IN&~BIT5):(P1IN|BIT5);
+        dcf77_strobe();
+    }
+    CHECK_INT(dcf77_get_queue_drops()-drops,2);
+    hw_run(HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV);
+    hw_run_until(hw_cycles_at(hw_real_time()+180.0));
+    CHECK_INT(dcf77_get_queue_drops()-drops,2);
+    CHECK(dcf77_get_decodes()>decodes);
+
+    // crystal error of +-100 ppm with impulse noise, fine lock time and steady state error
+    // (after the first decode and the pll settling)
+    int ppm;
+    for (ppm=-100;ppm<=100;ppm+=200)
+    {
+        start(100);
+        hw_set_ppm(ppm);
+        s.noise = 0.05;
+        double fine = -1.0, max_e = 0.0;
+        while (hw_real_time()<600.0)
+        {
+            hw_run(HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV);
+            if ((fine<0)&&(dcf77_get_sync_mode()==DCF77SYNC_FINE)) fine = hw_real_time();
+            if ((hw_real_time()>=180.0)&&(fabs(rtc_error_ms())>max_e)) max_e = fabs(rtc_error_ms());
+        }
+        printf("%+d ppm: fine lock %.1f s, steady state error max %.1f ms\n",ppm,fine,max_e);
+        CHECK((fine>0)&&(fine<15.0));
+        CHECK(max_e<DCF77_TEST_MAX_ERR_MS);
+    }
+
+    // carrier outage before the first drift measurement (10 minutes after the first decode),
+    // 30 ppm not compensated, error stays within the error bound of the time quality
+    start(100);
+    hw_set_ppm(30);
+    s.outage_from = 600.0;
+    s.outage_to = 2400.0;
+    double max_over = -1e9;
+    while (hw_real_time()<2400.0)
+    {
+        hw_run(HW_ACLK/HW_STEP_CYCLES);
+        uint16_t bound;
+        rtc_get_quality(&bound);
+        if (fabs(rtc_error_ms())-bound>max_over) max_over = fabs(rtc_error_ms())-bound;
+    }
+    printf("outage: error %.1f ms, bound margin %.1f ms\n",rtc_error_ms(),-max_over);
+    CHECK(fabs(rtc_error_ms())>30.0);
+    CHECK(max_over<0);
+
+    return TEST_RESULT();
+}
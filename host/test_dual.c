@@ -0,0 +1,81 @@
+/**
+ *
+ * two receivers test (DCF77_CHANNELS 2 build, second receiver on P1.6): primary channel
+ * switch to the good receiver and back, combined decoding of two noisy receivers
+ *
+ **/
+
+#include <math.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "dcf77.h"
+#include "test.h"
+
+signal_type s0, s1;
+
+// power on with both receivers (noise of each, second one disconnected if n1<0)
+void start(double n0, double n1)
+{
+    signal_init(&s0,2,10,0,0.37,1);
+    signal_init(&s1,2,10,0,0.37,2);
+    s0.noise = n0;
+    s1.noise = n1;
+    hw_init();
+    hw_set_input(signal_input,&s0);
+    if (n1>=0) hw_set_input2(signal_input,&s1);
+    main_init();
+}
+
+// primary channel
+uint8_t primary(void)
+{
+    uint8_t p;
+    CHECK_INT(dcf77_get_channels(&p),2);
+    return p;
+}
+
+// rtc time minus transmitter time (ms, within half a minute)
+double rtc_error_ms(void)
+{
+    tstruct t;
+    rtc_get_time(&t);
+    double rtc = t.minute*60.0+t.second+(double)rtc_get_subsecond()/RTC_SAMPLING_FREQV;
+    double e = fmod(rtc-fmod(signal_time(&s0,hw_real_time()),3600.0)+5400.0,3600.0)-1800.0;
+    return e*1000.0;
+}
+
+int main(void)
+{
+    // the first receiver doesn't get sync. (30% impulse noise), the second one becomes primary
+    start(0.3,0.0);
+    hw_run_until(hw_cycles_at(5*60.0));
+    CHECK_INT(primary(),1);
+    CHECK(dcf77_get_channel_score(1)>dcf77_get_channel_score(0));
+    CHECK(dcf77_get_decodes()>=3);
+    hw_run(HW_ACLK/HW_STEP_CYCLES/2);
+    CHECK(fabs(rtc_error_ms())<10.0);
+
+    // receivers swap their reception, primary goes back to the first one, decoding goes on
+    s0.noise = 0.0;
+    s1.noise = 0.3;
+    uint16_t decodes = dcf77_get_decodes();
+    hw_run_until(hw_cycles_at(10*60.0));
+    CHECK_INT(primary(),0);
+    CHECK(dcf77_get_channel_score(0)>dcf77_get_channel_score(1));
+    CHECK(dcf77_get_decodes()>=decodes+3);
+
+    // both receivers with 20% impulse noise (independent), the combined symbols decode most
+    // minutes, the first receiver alone almost none
+    start(0.2,0.2);
+    hw_run_until(hw_cycles_at(30*60.0));
+    uint16_t both = dcf77_get_decodes();
+    start(0.2,-1.0);
+    hw_run_until(hw_cycles_at(30*60.0));
+    uint16_t one = dcf77_get_decodes();
+    printf("30 minutes, 20%% noise: decodes %u with both receivers, %u with one\n",both,one);
+    CHECK(both>=15);
+    CHECK(one<=3);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+/**
+ *
+ * duty cycle accounting test (DUTY_ACCT build, Timer1_A counts the cpu cost model
+ * of hw.c): subsystem counters, nested lcd sections, flash hold in main loop,
+ * report over uart
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "flash.h"
+#include "duty.h"
+#include "test.h"
+
+#define TICK_US (1000000L/RTC_SAMPLING_FREQV)
+
+// uart output lines
+char line[64], report[DUTY_SUBSYSTEMS][16];
+int line_len = 0;
+
+void capture(void *ctx, char c, hw_time t)
+{
+    if ((c!='\r')&&(c!='\n')&&(line_len<(int)sizeof(line)-1)) line[line_len++] = c;
+    if (c!='\n') return;
+    line[line_len] = '\0';
+    line_len = 0;
+    const char names[] = "TRXBLM";
+    const char *n = (line[0]!='\0')?strchr(names,line[0]):0;
+    if (n&&(line[1]==' ')&&(strlen(line)==10)) strcpy(report[n-names],line);
+}
+
+uint32_t all_ticks(void)
+{
+    uint32_t sum = 0;
+    int i;
+    for (i=0;i<DUTY_SUBSYSTEMS;i++) sum += duty_get_ticks(i);
+    return sum;
+}
+
+int main(void)
+{
+    signal_type s;
+    signal_init(&s,2,10,0,0.37,1);
+    hw_init();
+    hw_set_input(signal_input,&s);
+    hw_set_tx(capture,0);
+    main_init();
+    uint64_t c0 = hw_cpu_cycles();
+
+    // three minutes of signal (timer isr every tick, lcd and main every second)
+    hw_run(3*60*HW_ACLK/HW_STEP_CYCLES);
+    uint32_t timer = duty_get_ticks(DUTY_TIMER), lcd = duty_get_ticks(DUTY_LCD), loop = duty_get_ticks(DUTY_MAIN);
+    printf("awake in 180 s: timer %u lcd %u main %u us, cost model %lu us\n",timer,lcd,loop,
+        (unsigned long)((hw_cpu_cycles()-c0)/(HW_MCLK/DUTY_TICK_FREQV)));
+    CHECK(timer>0);
+    CHECK(lcd>0);
+    CHECK(loop>0);
+    CHECK_INT(duty_get_ticks(DUTY_UART_RX),0);
+    CHECK_INT(duty_get_ticks(DUTY_BUTTON),0);
+    // timer isr fits into the tick, lcd section (nested in main) isn't counted in main
+    CHECK(duty_get_max(DUTY_TIMER)<TICK_US);
+    CHECK(duty_get_max(DUTY_MAIN)<duty_get_max(DUTY_LCD));
+    // sections take most of the cost, the rest is isr and function entries outside them
+    uint64_t cost = (hw_cpu_cycles()-c0)/(HW_MCLK/DUTY_TICK_FREQV);
+    CHECK(all_ticks()<=cost);
+    CHECK(all_ticks()>=cost*3/4);
+
+    // save command, flash erase holds the cpu in main loop section
+    hw_rx("P\r",2,hw_now());
+    hw_run(HW_ACLK/HW_STEP_CYCLES);
+    CHECK(duty_get_ticks(DUTY_UART_RX)>0);
+    CHECK(duty_get_max(DUTY_MAIN)>=FLASH_ERASE_US);
+    CHECK(duty_get_max(DUTY_MAIN)<=FLASH_ERASE_US+FLASH_ERASE_US/10+1000);
+    CHECK(duty_get_max(DUTY_TIMER)<TICK_US);
+
+    // report over uart (lines taken one by one, counters don't go back)
+    uint32_t tx = duty_get_ticks(DUTY_UART_TX), t_before = duty_get_ticks(DUTY_TIMER);
+    hw_rx("d\r",2,hw_now());
+    hw_run(2*HW_ACLK/HW_STEP_CYCLES);
+    CHECK(duty_get_ticks(DUTY_UART_TX)>tx);
+    CHECK(report[DUTY_TIMER][0]=='T');
+    uint32_t t_report = strtoul(report[DUTY_TIMER]+2,0,16);
+    CHECK((t_report>=t_before)&&(t_report<=duty_get_ticks(DUTY_TIMER)));
+    CHECK_INT(strtoul(report[DUTY_BUTTON]+2,0,16),0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,69 @@
+/**
+ *
+ * event queue test (priorities, delayed events, main loop timing)
+ *
+ **/
+
+#include <string.h>
+#include "hw.h"
+#include "rtc.h"
+#include "event.h"
+#include "test.h"
+
+// uart output capture (line start times)
+#define LINES 8
+hw_time line_start[LINES];
+int lines = 0;
+bool line_begin = true;
+
+void capture(void *ctx, char c, hw_time t)
+{
+    if (line_begin&&(lines<LINES)) line_start[lines++] = t-HW_CHAR_CYCLES;
+    line_begin = (c=='\n');
+}
+
+int main(void)
+{
+    int i;
+
+    // priority order, posting twice is once
+    hw_init();
+    event_post(EVENT_REPORT);
+    event_post(EVENT_UART);
+    event_post(EVENT_SYMBOL);
+    event_post(EVENT_UART);
+    CHECK(event_pending());
+    CHECK_INT(event_take(),EVENT_SYMBOL);
+    CHECK_INT(event_take(),EVENT_UART);
+    CHECK_INT(event_take(),EVENT_REPORT);
+    CHECK_INT(event_take(),EVENT_NONE);
+    CHECK(!event_pending());
+
+    // delayed event comes after its ticks, cancel drops it
+    event_post_delayed(EVENT_BUS,3);
+    event_post_delayed(EVENT_REPORT,5);
+    CHECK(!event_tick());
+    CHECK(!event_tick());
+    CHECK(event_tick());
+    CHECK_INT(event_take(),EVENT_BUS);
+    event_cancel(EVENT_REPORT);
+    for (i=0;i<10;i++) event_tick();
+    CHECK_INT(event_take(),EVENT_NONE);
+    event_post_delayed(EVENT_REPORT,0);
+    CHECK_INT(event_take(),EVENT_REPORT);
+
+    // simulated clock: time line starts in the tick of the second boundary
+    // (tick comes when timer reaches CCR0, the first one 7 counts after start, then every 64 cycles)
+    hw_init();
+    hw_set_tx(capture,0);
+    main_init();
+    hw_run(3*HW_ACLK/HW_STEP_CYCLES+4);
+    CHECK_INT(lines,3);
+    for (i=0;i<lines;i++)
+    {
+        hw_time tick = (hw_time)i*HW_ACLK+HW_ACLK/RTC_SAMPLING_FREQV-HW_STEP_CYCLES;
+        CHECK_INT(line_start[i],tick);
+    }
+
+    return TEST_RESULT();
+}
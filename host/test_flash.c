@@ -0,0 +1,67 @@
+/**
+ *
+ * flash hold test (rtc ticks lost while cpu is held are added, broken uart line is dropped)
+ *
+ **/
+
+#include <msp430g2553.h>
+#include <string.h>
+#include "hw.h"
+#include "rtc.h"
+#include "flash.h"
+#include "persist.h"
+#include "test.h"
+
+// uart output capture (chars)
+int chars = 0;
+
+void capture(void *ctx, char c, hw_time t)
+{
+    chars++;
+}
+
+// rtc time line position (ticks since monday 00:00:00)
+long rtc_position(void)
+{
+    tstruct t;
+    rtc_get_time(&t);
+    return (((t.dayow*24L+t.hour)*60+t.minute)*60+t.second)*RTC_SAMPLING_FREQV+rtc_get_subsecond();
+}
+
+int main(void)
+{
+    int i;
+
+    // erases and writes at all phases within a tick, rtc keeps the model time
+    hw_init();
+    hw_set_tx(capture,0);
+    main_init();
+    hw_run(2*HW_ACLK/HW_STEP_CYCLES);
+    hw_time t0 = hw_now();
+    uint16_t ticks0 = rtc_get_ticks();
+    long pos0 = rtc_position();
+    for (i=0;i<24;i++)
+    {
+        hw_run(1+i%RTC_STAMP_COUNTS);
+        if (i&1) persist_save(); else flash_erase(FLASH_INFO_D);
+    }
+    hw_run(HW_ACLK/HW_STEP_CYCLES); // slewing done
+    long elapsed = (long)((hw_now()-t0)/(HW_ACLK/RTC_SAMPLING_FREQV));
+    CHECK_INT((uint16_t)(rtc_get_ticks()-ticks0),elapsed);
+    CHECK_INT(rtc_position()-pos0,elapsed);
+
+    // chars during the hold overrun the rx buffer, the broken line ("E" is left of "XE") is
+    // dropped, next one works
+    hw_run(HW_ACLK/HW_STEP_CYCLES);
+    chars = 0;
+    hw_rx("XE\r",3,hw_now()+(hw_time)FLASH_ERASE_US*HW_ACLK/1000000-2*HW_CHAR_CYCLES-10);
+    flash_erase(FLASH_INFO_D);
+    hw_run(HW_ACLK/HW_STEP_CYCLES/4);
+    CHECK_INT(hw_rx_overruns(),1);
+    CHECK_INT(chars,0);
+    hw_rx("E\r",2,hw_now());
+    hw_run(HW_ACLK/HW_STEP_CYCLES/4);
+    CHECK(chars>0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,113 @@
+/**
+ *
+ * time link test (master with dcf77 signal, slave without it and with crystal error,
+ * master uart output to slave uart input)
+ *
+ **/
+
+#include <stdlib.h>
+#include <math.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "link.h"
+#include "test.h"
+
+#define SLAVE_PPM 25.0
+#define CHUNK 0.1 // both clocks run in turns (real s)
+
+// chars on the link (master model time of the char end, master crystal has no error)
+struct {char c; hw_time t;} link_chars[64];
+int link_len = 0;
+
+void link_tx(void *ctx, char c, hw_time t)
+{
+    if (link_len<(int)(sizeof(link_chars)/sizeof(link_chars[0])))
+    {
+        link_chars[link_len].c = c;
+        link_chars[link_len].t = t;
+        link_len++;
+    }
+}
+
+// rtc time of day at real time t (s within hour, timer count resolution)
+double rtc_position(double t)
+{
+    tstruct tm;
+    rtc_get_time(&tm);
+    uint16_t counts = rtc_get_subsecond()*RTC_STAMP_COUNTS+(rtc_get_stamp()&(RTC_STAMP_COUNTS-1));
+    return tm.minute*60.0+tm.second+(double)counts/(32768/8)+(t-hw_real_time());
+}
+
+int main(void)
+{
+    void *master = malloc(hw_state_size()), *slave = malloc(hw_state_size());
+    signal_type s;
+    double t, after_sync = -1.0, max_after = 0.0, max_before = 0.0, last_before = 0.0;
+    int syncs = 0, i;
+    uint16_t n = 0;
+    tstruct first = {0,0,0,0}, tm;
+
+    signal_init(&s,2,10,0,0.37,1);
+    hw_init();
+    hw_set_tx(link_tx,0);
+    hw_set_ppm(SLAVE_PPM);
+    main_init();
+    link_set_mode(LINK_SLAVE);
+    hw_state_save(slave);
+
+    hw_init();
+    hw_set_input(signal_input,&s);
+    hw_set_tx(link_tx,0);
+    main_init();
+    link_set_mode(LINK_MASTER);
+    hw_state_save(master);
+
+    for (t=CHUNK;t<=45*60.0;t+=CHUNK)
+    {
+        hw_state_load(master);
+        hw_run_until(hw_cycles_at(t));
+        double pm = rtc_position(t);
+        hw_state_save(master);
+
+        hw_state_load(slave);
+        for (i=0;i<link_len;i++)
+            hw_rx(&link_chars[i].c,1,hw_cycles_at((double)(link_chars[i].t-HW_CHAR_CYCLES)/HW_ACLK));
+        link_len = 0;
+        hw_run_until(hw_cycles_at(t));
+        double ps = rtc_position(t);
+        rtc_get_time(&tm);
+        if (link_get_syncs()!=n)
+        {
+            // at second 0 of every LINK_SYNC_MINUTES minute after the first one
+            n = link_get_syncs();
+            if (syncs==0) first = tm;
+            else CHECK_INT((tm.minute%LINK_SYNC_MINUTES)+tm.second,0);
+            syncs++;
+            after_sync = t;
+            last_before = max_before;
+            max_before = 0.0;
+        }
+        hw_state_save(slave);
+
+        // slave minus master rtc time (ms), just after the synchronization and the worst later
+        double e = fabs(fmod(ps-pm+5400.0,3600.0)-1800.0)*1000.0;
+        if ((after_sync>=0)&&(t<after_sync+2.0)&&(e>max_after)) max_after = e;
+        if ((after_sync>=0)&&(e>max_before)) max_before = e;
+    }
+
+    // master decodes within the first minutes, then slave every LINK_SYNC_MINUTES
+    CHECK(syncs>0);
+    CHECK((first.hour==10)&&(first.minute<5));
+    CHECK_INT(syncs,1+44/LINK_SYNC_MINUTES-first.minute/LINK_SYNC_MINUTES);
+    // stamp of the first char and latency, nearest tick boundary (half a tick, a timer count)
+    CHECK(max_after<1.25);
+    // crystal error is estimated after two synchronizations (not much left of 25 ppm in 10 minutes)
+    CHECK(last_before<3.0);
+    printf("link syncs %d first at %02d:%02d:%02d, error after sync %.2f ms, before the last one %.2f ms\n",
+        syncs,first.hour,first.minute,first.second,max_after,last_before);
+
+    free(master);
+    free(slave);
+    return TEST_RESULT();
+}
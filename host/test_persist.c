@@ -0,0 +1,136 @@
+/**
+ *
+ * persistent state test (information flash backed by an image file, every start is
+ * a fresh model loading it): restore of time, drift and sync. state, torn record,
+ * sequence number wrap, time to the first valid time after warm start
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "dcf77.h"
+#include "persist.h"
+#include "test.h"
+
+#define IMAGE "obj/test_persist.flash"
+#define PPM 20.0
+
+extern int persist_slot; // last used slot
+extern uint16_t persist_seq;
+extern uint8_t hw_info_flash[];
+persist_record *persist_slot_addr(int slot);
+
+signal_type s;
+
+// power on with the image file (signal at second, crystal error)
+void start(double second)
+{
+    signal_init(&s,2,10,0,second,1);
+    hw_init();
+    hw_set_flash_file(IMAGE);
+    hw_set_input(signal_input,&s);
+    hw_set_ppm(PPM);
+    main_init();
+}
+
+// real time of the first decode (-1 .. none until limit)
+double first_decode(double limit)
+{
+    uint16_t d = dcf77_get_decodes();
+    while (hw_real_time()<limit)
+    {
+        hw_run(HW_ACLK/HW_STEP_CYCLES/RTC_SAMPLING_FREQV);
+        if (dcf77_get_decodes()!=d) return hw_real_time();
+    }
+    return -1.0;
+}
+
+bool same_time(const tstruct *a, const tstruct *b)
+{
+    return (a->second==b->second)&&(a->minute==b->minute)&&(a->hour==b->hour)&&(a->dayow==b->dayow);
+}
+
+int main(void)
+{
+    tstruct saved, t;
+    int16_t drift, d;
+    uint16_t seq;
+    int i;
+
+    // cold start (no image yet), synchronized with drift estimate, state saved
+    remove(IMAGE);
+    start(0.37);
+    CHECK(!persist_init());
+    double cold = first_decode(300.0);
+    hw_run_until(hw_cycles_at(20*60.0));
+    CHECK(rtc_get_drift(&drift));
+    CHECK((drift>PPM*10-30)&&(drift<PPM*10+30));
+    persist_save();
+    rtc_get_time(&saved);
+    int finetune = dcf77_get_finetune();
+    uint8_t quality = persist_get_quality();
+    seq = persist_seq;
+
+    // warm start from the file (model flash erased by hw_init), time, drift and sync. state
+    // restored, time isn't trusted until a decode, which comes no later than after cold start
+    start(0.61);
+    CHECK_INT(persist_seq,seq);
+    rtc_get_time(&t);
+    CHECK(same_time(&t,&saved));
+    CHECK(rtc_get_drift(&d));
+    CHECK_INT(d,drift);
+    CHECK_INT(dcf77_get_finetune(),finetune);
+    CHECK_INT(persist_get_quality(),quality);
+    CHECK(rtc_get_sync_age()==0xFFFFFFFF);
+    double warm = first_decode(300.0);
+    printf("first valid time: cold start %.1f s, warm start %.1f s\n",cold,warm);
+    CHECK((cold>0)&&(warm>0));
+    CHECK(warm<=cold+1.0);
+
+    // torn record (write stopped in the middle of it), the previous one is restored,
+    // the next save goes to a blank slot
+    persist_save();
+    rtc_get_time(&saved);
+    hw_run(10*HW_ACLK/HW_STEP_CYCLES);
+    persist_save();
+    seq = persist_seq;
+    uint8_t *r = (uint8_t*)persist_slot_addr(persist_slot);
+    FILE *f = fopen(IMAGE,"r+b");
+    CHECK(f!=0);
+    if (f)
+    {
+        fseek(f,(r-hw_info_flash)+sizeof(persist_record)/2,SEEK_SET);
+        for (i=sizeof(persist_record)/2;i<sizeof(persist_record);i++) fputc(0xFF,f);
+        fclose(f);
+    }
+    start(0.37);
+    CHECK_INT(persist_seq,(uint16_t)(seq-1));
+    rtc_get_time(&t);
+    CHECK(same_time(&t,&saved));
+    hw_run(HW_ACLK/HW_STEP_CYCLES);
+    persist_save();
+    rtc_get_time(&saved);
+    start(0.37);
+    CHECK_INT(persist_seq,seq);
+    rtc_get_time(&t);
+    CHECK(same_time(&t,&saved));
+
+    // sequence number wrap (0xFFFF, 0, 1 .. the last one wins over all ring slots)
+    persist_seq = 0xFFFD;
+    for (i=0;i<8;i++)
+    {
+        hw_run(HW_ACLK/HW_STEP_CYCLES);
+        persist_save();
+    }
+    rtc_get_time(&saved);
+    start(0.37);
+    CHECK_INT(persist_seq,5);
+    rtc_get_time(&t);
+    CHECK(same_time(&t,&saved));
+
+    remove(IMAGE);
+    return TEST_RESULT();
+}
@@ -0,0 +1,115 @@
+/**
+ *
+ * phase modulation correlator test (synthetic baseband: soft chips of an integrate and
+ * dump phase demodulator, sequence offset in fractional chips, information bit, noise)
+ *
+ **/
+
+#include <math.h>
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "prn.h"
+#include "test.h"
+
+#define SAMPLES (PRN_CHIPS+2*PRN_SEARCH)
+
+uint32_t seed = 1;
+
+// transmitted sequence (lfsr x^9+x^5+1 from all ones, the 512th chip 0), +1 .. chip 0 phase
+void sequence(int8_t chips[PRN_CHIPS], int bit)
+{
+    uint16_t r = 0x1FF;
+    int i;
+    for (i=0;i<PRN_CHIPS;i++)
+    {
+        int chip = (i==(PRN_CHIPS-1))?0:(r&0x01);
+        r = (r>>1)|((((r>>0)^(r>>4))&0x01)<<8);
+        chips[i] = ((chip^bit)?-1:1);
+    }
+}
+
+// gaussian noise (Box-Muller)
+double gauss(void)
+{
+    double u = ((signal_random(&seed)>>8)+1.0)/16777217.0;
+    double v = (signal_random(&seed)>>8)/16777216.0;
+    return sqrt(-2.0*log(u))*cos(2.0*M_PI*v);
+}
+
+// correlate one second: sequence starts offset chips late (expected start is sample PRN_SEARCH),
+// soft chip amplitude and noise deviation in soft units (outside the sequence phase is 0)
+bool run(double offset, int bit, double amp, double noise, prn_result *r)
+{
+    int8_t chips[PRN_CHIPS];
+    int k, j;
+    sequence(chips,bit);
+    prn_start();
+    for (k=0;k<SAMPLES;k++)
+    {
+        // chip j spans [PRN_SEARCH+offset+j, +1) in sample units
+        double soft = 0.0;
+        int first = (int)floor(k-PRN_SEARCH-offset);
+        for (j=first;j<=first+1;j++)
+        {
+            if ((j<0)||(j>=PRN_CHIPS)) continue;
+            double a = PRN_SEARCH+offset+j, b = a+1.0;
+            double o = fmin(b,k+1.0)-fmax(a,(double)k);
+            if (o>0.0) soft += o*chips[j];
+        }
+        soft = soft*amp+noise*gauss();
+        prn_chip((int8_t)fmax(-127.0,fmin(127.0,lround(soft))));
+    }
+    return prn_get_result(r);
+}
+
+int main(void)
+{
+    static const double offsets[] = {0.0,3.0,-5.0,0.25,-0.5,2.75,-7.4};
+    prn_result r;
+    unsigned int i;
+
+    hw_init();
+    main_init();
+
+    // offsets (clean signal), sub chip accuracy by interpolation
+    for (i=0;i<sizeof(offsets)/sizeof(offsets[0]);i++)
+    {
+        CHECK(run(offsets[i],0,PRN_SOFT_MAX,0.0,&r));
+        CHECK(r.valid);
+        CHECK_INT(r.bit,0);
+        double err = r.offset_us-offsets[i]*PRN_CHIP_NS/1000.0;
+        if (fabs(err)>=100.0) printf("offset %.2f chips: %d us\n",offsets[i],r.offset_us);
+        CHECK(fabs(err)<100.0);
+    }
+    CHECK(!prn_get_result(&r)); // once per result
+
+    // inverted sequence (information bit 1)
+    CHECK(run(1.5,1,PRN_SOFT_MAX,0.0,&r));
+    CHECK(r.valid&&(r.bit==1));
+
+    // noise (chip snr 0dB, soft chips clipped), still found within a quarter chip
+    for (i=0;i<20;i++)
+    {
+        double offset = (int)(i%15)-7+0.3;
+        CHECK(run(offset,i&1,20.0,20.0,&r));
+        CHECK(r.valid&&(r.bit==(i&1)));
+        CHECK(fabs(r.offset_us-offset*PRN_CHIP_NS/1000.0)<(PRN_CHIP_NS/4000.0));
+    }
+
+    // no phase modulation (noise only) is not valid
+    for (i=0;i<20;i++)
+    {
+        CHECK(run(0.0,0,0.0,20.0,&r));
+        CHECK(!r.valid);
+    }
+
+    // valid result slews rtc second epoch (offset 5 chips ~ 7.7ms ~ 4 ticks late, second starts early)
+    hw_run(HW_ACLK/HW_STEP_CYCLES);
+    uint16_t sub0 = rtc_get_subsecond();
+    CHECK(run(5.0,0,PRN_SOFT_MAX,0.0,&r));
+    hw_run(HW_ACLK/HW_STEP_CYCLES/4);
+    CHECK_INT((rtc_get_subsecond()-sub0+RTC_SAMPLING_FREQV)%RTC_SAMPLING_FREQV,RTC_SAMPLING_FREQV/4-4);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,73 @@
+/**
+ *
+ * rtc test (drift measured over minute synchronizations, time quality error bound)
+ *
+ **/
+
+#include "hw.h"
+#include "signal.h"
+#include "rtc.h"
+#include "test.h"
+
+extern volatile uint32_t rtc_sync_age;
+
+// quality and error bound at given age since sync.
+rtc_quality_type quality_at(uint32_t age, uint16_t *err_ms)
+{
+    rtc_sync_age = age;
+    return rtc_get_quality(err_ms);
+}
+
+// run clock with dcf77 signal and crystal error, drift estimate after minutes
+bool drift_after(double ppm, int minutes, int16_t *drift)
+{
+    signal_type s;
+    signal_init(&s,2,10,0,0.37,1);
+    hw_init();
+    hw_set_input(signal_input,&s);
+    hw_set_ppm(ppm);
+    main_init();
+    hw_run_until(hw_cycles_at(minutes*60.0));
+    return rtc_get_drift(drift);
+}
+
+int main(void)
+{
+    int16_t drift;
+
+    // synchronized every minute, valid after the anchor is 10 minutes old (first decode at 2 min)
+    CHECK(!drift_after(50.0,11,&drift));
+    CHECK(drift_after(50.0,14,&drift));
+    CHECK((drift>=450)&&(drift<=550));
+    CHECK(drift_after(-30.0,14,&drift));
+    CHECK((drift>=-350)&&(drift<=-250));
+    // smoothed residual
+    CHECK(drift_after(50.0,60,&drift));
+    CHECK((drift>=480)&&(drift<=520));
+
+    // error bound from drift uncertainty (2ppm with estimate, 50ppm without) since sync.
+    uint16_t err;
+    tstruct t = {0,0,12,3};
+    hw_init();
+    main_init();
+    CHECK_INT(rtc_get_quality(&err),RTC_QUALITY_UNSYNC);
+    CHECK_INT(err,0xFFFF);
+    rtc_set_time(&t);
+    CHECK_INT(quality_at(100,&err),RTC_QUALITY_SYNCED);
+    CHECK_INT(err,10+100*500/10000);
+    CHECK_INT(quality_at(3600,&err),RTC_QUALITY_HOLD);
+    CHECK_INT(err,10+180);
+    CHECK_INT(quality_at(100L*86400,&err),RTC_QUALITY_UNSYNC);
+    CHECK_INT(err,0xFFFF); // product wrapped at 99 days
+    rtc_set_drift(123);
+    CHECK_INT(quality_at(3600,&err),RTC_QUALITY_HOLD);
+    CHECK_INT(err,10+3600*20/10000);
+    CHECK_INT(quality_at(86400,&err),RTC_QUALITY_HOLD);
+    CHECK_INT(err,10+172);
+    CHECK_INT(quality_at(7L*86400,&err),RTC_QUALITY_UNSYNC);
+    CHECK_INT(err,10+1209);
+    CHECK_INT(quality_at(0xFFFFFFFEUL,&err),RTC_QUALITY_UNSYNC);
+    CHECK_INT(err,0xFFFF);
+
+    return TEST_RESULT();
+}
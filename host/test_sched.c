@@ -0,0 +1,104 @@
+/**
+ *
+ * output scheduler test (sorted table rewrites through the flash scratch segment)
+ *
+ **/
+
+#include <msp430g2553.h>
+#include "hw.h"
+#include "flash.h"
+#include "sched.h"
+#include "test.h"
+
+extern int sched_next; // cursor (next due entry)
+
+// entry at minute, second with output 0 on all days
+sched_entry entry(uint16_t minute, uint8_t second)
+{
+    sched_entry e = {minute,(uint8_t)(second<<2),0x7F|SCHED_ACTION_ON};
+    return e;
+}
+
+// table sorted by time
+bool sorted(void)
+{
+    int i;
+    for (i=1;i<sched_count();i++)
+    {
+        const sched_entry *a = sched_get(i-1), *b = sched_get(i);
+        if ((a->minute>b->minute)||((a->minute==b->minute)&&(a->second_out>b->second_out))) return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    int i;
+    sched_entry e;
+
+    hw_init();
+    main_init();
+    CHECK_INT(sched_count(),0);
+
+    // full table in pseudo random order
+    for (i=0;i<SCHED_MAX;i++)
+    {
+        e = entry((i*7)%SCHED_MAX*60,i);
+        CHECK(sched_add(&e)>=0);
+        CHECK_INT(sched_count(),i+1);
+        CHECK(sorted());
+    }
+    e = entry(1,0);
+    CHECK_INT(sched_add(&e),-1); // full
+    e = entry(1440,0);
+    sched_remove(0);
+    CHECK_INT(sched_add(&e),-1); // out of range
+
+    // remove first, middle and last, the rest kept
+    CHECK_INT(sched_count(),SCHED_MAX-1);
+    CHECK_INT(sched_get(0)->minute,60);
+    CHECK_INT(sched_remove(5),0);
+    CHECK_INT(sched_get(5)->minute,7*60);
+    CHECK_INT(sched_remove(sched_count()-1),0);
+    CHECK_INT(sched_count(),SCHED_MAX-3);
+    CHECK_INT(sched_get(sched_count()-1)->minute,(SCHED_MAX-2)*60);
+    CHECK(sorted());
+    CHECK_INT(sched_remove(sched_count()),-1);
+
+    // same minute, ordered by second
+    e = entry(7*60,30);
+    CHECK_INT(sched_add(&e),6); // after the one at second 1
+    e = entry(7*60,0);
+    CHECK_INT(sched_add(&e),5);
+    CHECK(sorted());
+
+    // cursor walks over minute boundaries, binary search only after a time jump
+    // (stale cursor isn't moved back by a seek at the minute change)
+    sched_clear();
+    e = entry(10*60,30);
+    sched_add(&e);
+    e = entry(10*60+1,0);
+    sched_add(&e);
+    tstruct t = {28,0,10,0};
+    sched_check(&t);
+    CHECK_INT(sched_next,0);
+    for (t.second=29;t.second<59;t.second++) sched_check(&t);
+    CHECK_INT(sched_next,1);
+    sched_next = 0;
+    t.second = 59;
+    sched_check(&t);
+    CHECK_INT(sched_next,0);
+    t.minute = 1;
+    t.second = 1;
+    sched_check(&t); // 10:01:01 skipped
+    CHECK_INT(sched_next,2);
+
+    // table survives warm start
+    int n = sched_count();
+    hw_reset();
+    main_init();
+    CHECK_INT(sched_count(),n);
+    CHECK(sorted());
+
+    return TEST_RESULT();
+}
@@ -52,6 +52,40 @@
 #define LCM_CURSOR_ON 0x02
 #define LCM_CURSOR_BLINK 0x01
 
+// custom glyphs (cgram) cache, bitmaps are const (flash), so pointer identifies glyph
+const unsigned char *lcm_glyph_cache[LCM_GLYPHS];
+
+// bar graph partial char glyphs (1..4 columns of 5)
+const unsigned char lcm_bar_glyph[4][8] = {
+    {0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x00},
+    {0x00,0x18,0x18,0x18,0x18,0x18,0x18,0x00},
+    {0x00,0x1C,0x1C,0x1C,0x1C,0x1C,0x1C,0x00},
+    {0x00,0x1E,0x1E,0x1E,0x1E,0x1E,0x1E,0x00}};
+#define LCM_BAR_FULL ((char)0xFF) // rom full block
+
+// big digits segment glyphs (upper bar, lower bar, both bars) and digits
+// made of them, full block and space (3 columns, upper row then lower row)
+const unsigned char lcm_big_glyph[3][8] = {
+    {0x1F,0x1F,0x00,0x00,0x00,0x00,0x00,0x00},
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x1F,0x1F},
+    {0x1F,0x1F,0x00,0x00,0x00,0x00,0x1F,0x1F}};
+#define B_ ' '
+#define BF ((char)0xFF)
+#define BU LCM_GLYPH(LCM_BIG_SLOT)
+#define BL LCM_GLYPH(LCM_BIG_SLOT+1)
+#define BB LCM_GLYPH(LCM_BIG_SLOT+2)
+const char lcm_big_digits[10][6] = {
+    {BF,BU,BF,BF,BL,BF}, // 0
+    {BU,BF,B_,BL,BF,BL}, // 1
+    {BB,BB,BF,BF,BL,BL}, // 2
+    {BB,BB,BF,BL,BL,BF}, // 3
+    {BF,BL,BF,B_,B_,BF}, // 4
+    {BF,BB,BB,BL,BL,BF}, // 5
+    {BF,BB,BB,BF,BL,BF}, // 6
+    {BU,BU,BF,B_,B_,BF}, // 7
+    {BF,BB,BF,BF,BL,BF}, // 8
+    {BF,BB,BF,BL,BL,BF}}; // 9
+
 /// local function implementations
 
 //
@@ -315,3 +349,91 @@ void lcm_prints(char *Text)
         c++;
     }
 }
+
+//
+// Routine Desc
+//
+// Define custom glyph (character code Slot or 8+Slot). The bitmap is
+// uploaded into CGRAM only when it's another one than the last time,
+// after upload the cursor position is lost (use lcm_goto).
+//
+// Parameters:
+//
+// Slot - glyph number 0..7
+//
+// Bitmap - 8 rows of 5 pixels (const table)
+//
+// Returns
+//
+// void.
+//
+void lcm_glyph(unsigned char Slot, const unsigned char *Bitmap)
+{
+    int i;
+    if ((Slot>=LCM_GLYPHS)||(lcm_glyph_cache[Slot]==Bitmap)) return;
+    SendByte(0x40|(Slot<<3), LCM_SEND_COMMAND);
+    for (i=0;i<8;i++) SendByte(Bitmap[i], LCM_SEND_DATA);
+    lcm_glyph_cache[Slot] = Bitmap;
+}
+
+//
+// Routine Desc
+//
+// Draw horizontal bar graph (5 steps per character, partial character
+// uses glyph LCM_BAR_SLOT)
+//
+// Parameters:
+//
+// Row, Col - position
+//
+// Width - bar width (characters)
+//
+// Value, Max - shown value and full scale
+//
+// Returns
+//
+// void.
+//
+void lcm_bar(char Row, char Col, char Width, unsigned int Value, unsigned int Max)
+{
+    char i;
+    unsigned int steps;
+    if (Value>Max) Value=Max;
+    steps = (unsigned int)(((unsigned long)Value*Width*5+Max/2)/Max);
+
+    if (steps%5) lcm_glyph(LCM_BAR_SLOT,lcm_bar_glyph[steps%5-1]);
+    lcm_goto(Row,Col);
+    for (i=0;i<Width;i++)
+    {
+        if (steps>=5) {SendByte(LCM_BAR_FULL, LCM_SEND_DATA);steps-=5;}
+        else if (steps>0) {SendByte(LCM_GLYPH(LCM_BAR_SLOT), LCM_SEND_DATA);steps=0;}
+        else SendByte(' ', LCM_SEND_DATA);
+    }
+}
+
+//
+// Routine Desc
+//
+// Draw big digit over both rows (glyphs LCM_BIG_SLOT..LCM_BIG_SLOT+2)
+//
+// Parameters:
+//
+// Col - the first column (digit is 3 columns wide)
+//
+// Digit - 0..9 (space otherwise)
+//
+// Returns
+//
+// void.
+//
+void lcm_big_digit(char Col, char Digit)
+{
+    int i, r;
+    for (i=0;i<3;i++) lcm_glyph(LCM_BIG_SLOT+i,lcm_big_glyph[i]);
+    for (r=0;r<2;r++)
+    {
+        lcm_goto(r,Col);
+        for (i=0;i<3;i++)
+            SendByte(((Digit>=0)&&(Digit<=9))?lcm_big_digits[(int)Digit][r*3+i]:' ', LCM_SEND_DATA);
+    }
+}
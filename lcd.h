@@ -12,4 +12,14 @@ void lcm_clearscr(void); // clear screen
 void lcm_goto(char Row, char Col); // goto cursor position
 void lcm_prints(char *Text); // print string function
 
+// custom glyphs (HD44780 CGRAM, char codes 8..15 mirror 0..7, so they can be in strings)
+#define LCM_GLYPHS 8
+#define LCM_GLYPH(slot) ((char)(8+(slot)))
+#define LCM_BAR_SLOT 0 // bar graph partial char
+#define LCM_BIG_SLOT 2 // big digits segments (3 slots)
+
+void lcm_glyph(unsigned char Slot, const unsigned char *Bitmap); // define glyph (const bitmap, uploaded only when changed)
+void lcm_bar(char Row, char Col, char Width, unsigned int Value, unsigned int Max); // horizontal bar graph
+void lcm_big_digit(char Col, char Digit); // two rows big digit (3 columns wide)
+
 #endif
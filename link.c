@@ -0,0 +1,137 @@
+/**
+ *
+ * time link module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * one clock with good dcf77 reception (master) redistributes the time over
+ * the uart to clocks without it (slaves)
+ *
+ * master sends timecode "#hhmmssdqcc" (time, day of week, quality, xor of
+ * the chars before as hex) exactly at the second start, only when the uart
+ * is idle so the latency is always the same (one char)
+ *
+ * slave stamps the first char (rtc_get_stamp, timer count resolution) and
+ * synchronizes as if the second started latency before it, at the tick
+ * boundary nearest to that (rtc_set_time_aligned)
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "uart.h"
+#include "dcf77.h"
+#include "evlog.h"
+#include "link.h" // self
+
+#define LINK_FRAME_LEN 11
+#define LINK_LATENCY_COUNTS (((uint32_t)LINK_LATENCY_US*(32768/8)+500000L)/1000000L) // rtc_get_stamp counts
+
+link_mode_type link_mode = LINK_OFF;
+
+// master timecode prepared for the next second (digit nibbles: time bcd, day of week and
+// quality, checksum), chars are made when sending
+#define LINK_FRAME_BYTES ((LINK_FRAME_LEN-1)/2)
+uint8_t link_frame[LINK_FRAME_BYTES];
+volatile uint8_t link_frame_second = 0xFF; // second of prepared timecode (0xFF .. none)
+
+uint16_t link_syncs = 0; // slave synchronizations
+
+// get mode
+link_mode_type link_get_mode(void)
+{
+    return link_mode;
+}
+
+// set mode
+void link_set_mode(link_mode_type mode)
+{
+    if (mode<LINK_MODES) link_mode = mode;
+    link_frame_second = 0xFF;
+}
+
+// timecode checksum (xor of chars)
+uint8_t link_checksum(const char *s, int len)
+{
+    uint8_t x = 0;
+    int i;
+    for (i=0;i<len;i++) x ^= s[i];
+    return x;
+}
+
+// prepare timecode for the next second (only with synchronized time)
+void link_check(tstruct *tnow)
+{
+    tstruct t;
+    uint16_t err;
+    uint8_t x = '#';
+    int i;
+    link_frame_second = 0xFF;
+    if (link_mode!=LINK_MASTER) return;
+    rtc_quality_type q = rtc_get_quality(&err);
+    if (q==RTC_QUALITY_UNSYNC) return;
+    inc_one_second(tnow,&t);
+    link_frame[0] = ((t.hour/10)<<4)|(t.hour%10);
+    link_frame[1] = ((t.minute/10)<<4)|(t.minute%10);
+    link_frame[2] = ((t.second/10)<<4)|(t.second%10);
+    link_frame[3] = (t.dayow<<4)|q;
+    for (i=0;i<(2*LINK_FRAME_BYTES-2);i++) x ^= h2c(link_frame[i>>1]>>((i&1)?0:4));
+    link_frame[4] = x;
+    link_frame_second = t.second;
+}
+
+// send prepared timecode at the second start (skipped when uart busy, the latency would be different)
+void link_second(tstruct *tnow)
+{
+    int i;
+    if (link_frame_second!=tnow->second) return;
+    link_frame_second = 0xFF;
+    if (!uart_tx_idle()) return;
+    uart_putc('#');
+    for (i=0;i<(2*LINK_FRAME_BYTES);i++) uart_putc(h2c(link_frame[i>>1]>>((i&1)?0:4)));
+    uart_puts("\r\n");
+}
+
+// slave timecode line
+bool link_receive(char *line, int len, uint16_t mark)
+{
+    tstruct t;
+    int8_t d[10];
+    int i;
+    if ((len!=LINK_FRAME_LEN)||(line[0]!='#')) return false;
+    if (link_mode!=LINK_SLAVE) return true; // timecode, but not for us
+    // second start (latency before the mark) to the current tick start, nearest whole ticks
+    uint16_t age = (uint16_t)(rtc_get_ticks()*RTC_STAMP_COUNTS-mark+LINK_LATENCY_COUNTS+RTC_STAMP_COUNTS/2);
+    age = age/RTC_STAMP_COUNTS+1; // second starts with the tick after that many
+    for (i=0;i<10;i++)
+    {
+        d[i] = c2h(line[i+1]);
+        if (d[i]<0) return true;
+    }
+    if (((d[8]<<4)|d[9])!=link_checksum(line,9)) return true;
+    if (d[7]!=RTC_QUALITY_SYNCED) return true; // master not synchronized recently
+    t.hour = d[0]*10+d[1];
+    t.minute = d[2]*10+d[3];
+    t.second = d[4]*10+d[5];
+    t.dayow = d[6];
+    if ((t.hour>23)||(t.minute>59)||(t.second>59)||(t.dayow>6)) return true;
+    // own dcf77 lock is better
+    if (dcf77_get_sync_mode()==DCF77SYNC_FINE) return true;
+    // synchronize at second 0 every LINK_SYNC_MINUTES minutes (drift estimation needs some age),
+    // at any minute when the last synchronization is older (not synchronized yet, timecodes lost)
+    bool due = (rtc_get_sync_age()>=(uint32_t)LINK_SYNC_MINUTES*60);
+    if ((t.second!=0)||((!due)&&((t.minute%LINK_SYNC_MINUTES)!=0))) return true;
+    int16_t corr = rtc_set_time_aligned(&t,age);
+    if (corr>127) corr=127;
+    if (corr<-128) corr=-128;
+    evlog_add(EVLOG_LINK,(uint8_t)corr);
+    link_syncs++;
+    return true;
+}
+
+// slave synchronizations counter
+uint16_t link_get_syncs(void)
+{
+    return link_syncs;
+}
@@ -0,0 +1,29 @@
+/**
+ *
+ * time link module header
+ *
+ **/
+
+#ifndef __LINK_H__
+#define __LINK_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "rtc.h"
+
+// link modes
+typedef enum {LINK_OFF,LINK_MASTER,LINK_SLAVE,LINK_MODES} link_mode_type;
+
+// link latency (master second start to slave reception of the first char, one char at 9600Bd)
+#define LINK_LATENCY_US 1040
+// slave synchronization period (minutes, at second 0; every minute when the last one is older)
+#define LINK_SYNC_MINUTES 10
+
+link_mode_type link_get_mode(void); // current mode
+void link_set_mode(link_mode_type mode); // set mode
+void link_check(tstruct *tnow); // prepare timecode for next second (main loop, every second)
+void link_second(tstruct *tnow); // send prepared timecode (rtc timer isr, second boundary)
+bool link_receive(char *line, int len, uint16_t mark); // slave timecode line (mark .. rtc time stamp at the first char), false if it isn't timecode
+uint16_t link_get_syncs(void); // slave synchronizations counter
+
+#endif
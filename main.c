@@ -50,12 +50,23 @@
 
 // include section
 #include <msp430g2553.h>
+#include <string.h>
 
 #include "uart.h"
 #include "rtc.h"
 #include "lcd.h"
 #include "button.h"
 #include "dcf77.h"
+#include "power.h"
+#include "duty.h"
+#include "event.h"
+#include "sched.h"
+#include "persist.h"
+#include "evlog.h"
+#include "stats.h"
+#include "stack.h"
+#include "bus.h"
+#include "link.h"
 
 
 // board (leds, button)
@@ -68,6 +79,9 @@
 #define LED_GREEN_SWAP() {P1OUT^=0x40;}
 
 
+// uart report retry period (rtc ticks, ~30ms)
+#define REPORT_RETRY_TICKS (RTC_SAMPLING_FREQV/32)
+
 // leds and dco init
 void board_init(void)
 {
@@ -147,74 +161,340 @@ int str_add_lineend(char *s,int len)
     return -1;
 }
 
-// main program body
-int main(void)
+// display mode (button 1 switches)
+typedef enum {DISPLAY_STATUS,DISPLAY_BIG,DISPLAY_MODES} display_mode_type;
+display_mode_type display_mode = DISPLAY_STATUS;
+int8_t display_minute = -1; // minute shown by big clock (-1 .. redraw)
+
+// big clock (hh:mm over both rows, redrawn when minute changes)
+void show_big_time(tstruct *t)
 {
-	WDTCTL = WDTPW + WDTHOLD;	// Stop WDT
+    if (t->minute==display_minute) return;
+    display_minute = t->minute;
+    DUTY_BEGIN_MAIN(duty_lcd);
+    lcm_big_digit(0,t->hour/10);
+    lcm_big_digit(3,t->hour%10);
+    lcm_goto(0,6);
+    lcm_prints("\xA5");
+    lcm_goto(1,6);
+    lcm_prints("\xA5");
+    lcm_big_digit(7,t->minute/10);
+    lcm_big_digit(10,t->minute%10);
+    DUTY_END_MAIN(DUTY_LCD,duty_lcd);
+}
+
+// switch display mode (clear screen by spaces, lcd clear command needs long delay)
+void display_switch(void)
+{
+    display_mode = (display_mode+1)%DISPLAY_MODES;
+    display_minute = -1;
+    DUTY_BEGIN_MAIN(duty_lcd);
+    lcm_goto(0,0);
+    lcm_prints("                ");
+    lcm_goto(1,0);
+    lcm_prints("                ");
+    DUTY_END_MAIN(DUTY_LCD,duty_lcd);
+}
+
+// print time (lcd and uart), own stack frame (line buffer not on the stack under flash saves)
+void print_time(tstruct *tnow)
+{
+    char tstr[16];
+    sprint_time(tnow,tstr);
+    // time quality (S .. synchronized, H .. hold over, ? .. unsynchronized)
+    uint16_t err;
+    const char qchar[] = "?HS";
+    int len = strlen(tstr);
+    tstr[len++]=' ';
+    tstr[len++]=qchar[rtc_get_quality(&err)];
+    tstr[len]='\0';
+    if (display_mode==DISPLAY_BIG) show_big_time(tnow);
+    else
+    {
+        DUTY_BEGIN_MAIN(duty_lcd);
+        lcm_goto(1,0);
+        lcm_prints(tstr);
+        DUTY_END_MAIN(DUTY_LCD,duty_lcd);
+    }
+    #if !UART_BUS // bus units talk only when asked
+    if (link_get_mode()==LINK_MASTER) return; // timecode instead
+    str_add_lineend(tstr,16);
+    uart_puts(tstr);
+    #endif
+}
+
+// show time and prepare scheduled outputs for the next second
+void show_time(void)
+{
+    tstruct tnow;
+    rtc_get_time(&tnow);
+    sched_check(&tnow);
+    link_check(&tnow);
+    persist_tick(&tnow);
+    print_time(&tnow);
+}
+
+// button events
+void button_pressed(void)
+{
+    tstruct tnow;
+    uint8_t e;
+    while ((e=button_get_event())!=0)
+    {
+        if (e==BUTTON_EVENT(1,BUTTON_PRESS)) display_switch();
+        if (e==BUTTON_EVENT(3,BUTTON_PRESS)) // test rtc set function
+        {
+            tnow.second = 0;
+            tnow.minute = 33;
+            tnow.hour = 22;
+            tnow.dayow = 2;
+            rtc_set_time(&tnow);
+        }
+    }
+}
 
+// uart report (one line per event, next line when there is space in tx buffer)
+int (*report_fn)(int line, char *s, int len) = 0;
+int report_line = 0;
+void report_next(void)
+{
+    char rstr[16];
+    if (report_fn==0) return;
+    if (report_fn(report_line,rstr,16)==0)
+    {
+        if (uart_tx_space()<(int)strlen(rstr))
+        {
+            event_post_delayed(EVENT_REPORT,REPORT_RETRY_TICKS); // try it later
+            return;
+        }
+        uart_puts(rstr);
+        report_line++;
+        event_post_delayed(EVENT_REPORT,0);
+    }
+    else
+        report_fn = 0; // done
+}
+
+// start uart report
+void report_start(int (*fn)(int line, char *s, int len))
+{
+    report_fn = fn;
+    report_line = 0;
+    event_post_delayed(EVENT_REPORT,0);
+}
+
+// hex string to number (returns -1 if not a hex digit)
+int32_t hex2num(char *s, int digits)
+{
+    int32_t n=0;
+    int i;
+    for (i=0;i<digits;i++)
+    {
+        int8_t h=c2h(s[i]);
+        if (h<0) return -1;
+        n=(n<<4)|h;
+    }
+    return n;
+}
+
+// bus status line (one line report)
+int bus_report(int line, char *s, int len)
+{
+    if (line>0) return -1;
+    return bus_status(s,len);
+}
+
+// execute uart command
+//  d .. duty cycle report
+//  L .. list schedule, C .. clear schedule
+//  E .. event log dump
+//  Q .. reception statistics
+//  P .. save state now
+//  R .. ram and stack usage
+//  Smmmmssaa .. add schedule entry (minute of day, second<<2|output, dow mask|action<<7; hex)
+//  Xnn .. remove schedule entry (index; hex)
+//  T .. bus status (address, time, quality)
+//  Aaa .. set bus address (hex, saved)
+//  Mn .. time link mode (0 off, 1 master, 2 slave; saved)
+void uart_exec(char *cmd, int len, bool broadcast)
+{
+    int32_t n;
+    if (len<1) return;
+    switch (cmd[0])
+    {
+        case 'd': // duty cycle report
+            report_start(duty_report);
+            break;
+        case 'E': // event log
+            report_start(evlog_report);
+            break;
+        case 'Q': // reception statistics
+            report_start(stats_report);
+            break;
+        case 'P': // save state
+            persist_save();
+            break;
+        case 'R': // ram and stack usage
+            report_start(stack_report);
+            break;
+        case 'L': // list schedule
+            report_start(sched_report);
+            break;
+        case 'C': // clear schedule
+            sched_clear();
+            break;
+        case 'S': // add schedule entry
+            if (len!=9) break;
+            n = hex2num(&cmd[1],8);
+            if (n>=0)
+            {
+                sched_entry e;
+                e.minute = n>>16;
+                e.second_out = (n>>8)&0xFF;
+                e.dow_action = n&0xFF;
+                sched_add(&e);
+            }
+            break;
+        case 'X': // remove schedule entry
+            if (len!=3) break;
+            n = hex2num(&cmd[1],2);
+            if (n>=0) sched_remove(n);
+            break;
+        case 'T': // bus status (broadcast .. answer in own time slot)
+            if (broadcast) bus_reply_slot();
+            else report_start(bus_report);
+            break;
+        case 'M': // time link mode
+            if ((len!=2)||broadcast) break;
+            n = c2h(cmd[1]);
+            if ((n>=0)&&(n<LINK_MODES))
+            {
+                link_set_mode(n);
+                persist_save();
+            }
+            break;
+        case 'A': // set bus address
+            if ((len!=3)||broadcast) break;
+            n = hex2num(&cmd[1],2);
+            if ((n>=0)&&(n!=BUS_BROADCAST))
+            {
+                bus_set_address(n);
+                persist_save();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// uart command received (bus .. "@aa<command>", accepted only when addressed to this unit or broadcast)
+void uart_command(void)
+{
+    int len;
+    char *line = uart_get_line(&len);
+    char *cmd = line;
+    bool broadcast = false;
+    if (line==0) return;
+    if (link_receive(line,len,uart_get_line_mark())) cmd = 0; // master timecode
+    #if UART_BUS
+    if (cmd!=0) cmd = bus_filter(line,&len,&broadcast);
+    if ((cmd!=0)&&broadcast&&(len>0)&&(strchr("dEQRVL",cmd[0])!=0)) cmd = 0; // reports would collide on the bus
+    #endif
+    if (cmd!=0) uart_exec(cmd,len,broadcast);
+    uart_release_line();
+}
+
+#if DCF77_DEBUG
+// sync. state icons (coarse .. searching antenna, fine .. check mark, hold .. hourglass)
+const unsigned char sync_icon[3][8] = {
+    {0x15,0x15,0x0E,0x04,0x04,0x04,0x04,0x00},
+    {0x00,0x01,0x03,0x16,0x1C,0x08,0x00,0x00},
+    {0x1F,0x11,0x0A,0x04,0x0A,0x11,0x1F,0x00}};
+#define SYNC_ICON_SLOT 1
+
+// dcf77 status line (sync. icon, last symbol, signal quality bar and %)
+void show_dcf77_debug(void)
+{
+    char tstr[4];
+    int q = (int)((long)last_Q*100/RTC_SAMPLING_FREQV);
+    if (display_mode!=DISPLAY_STATUS) return;
+    DUTY_BEGIN_MAIN(duty_lcd);
+    lcm_glyph(SYNC_ICON_SLOT,sync_icon[dcf77_get_sync_mode()]);
+    lcm_bar(0,3,10,last_Q,RTC_SAMPLING_FREQV);
+    lcm_goto(0,0);
+    tstr[0]=LCM_GLYPH(SYNC_ICON_SLOT);
+    tstr[1]="-01M"[last_symbol&0x03];
+    tstr[2]='\0';
+    lcm_prints(tstr);
+    lcm_goto(0,13);
+    tstr[0]=(q>=100)?'1':' ';
+    tstr[1]=(q>=10)?h2c(q/10%10):' ';
+    tstr[2]=h2c(q%10);
+    tstr[3]='\0';
+    lcm_prints(tstr);
+    DUTY_END_MAIN(DUTY_LCD,duty_lcd);
+    symbol_ready = false;
+}
+#endif
+
+// init all modules (after reset)
+void main_init(void)
+{
 	board_init(); // init dco and leds
 	lcm_init(); // lcd
 	rtc_timer_init(); // init 32kHz timer
 	uart_init(); // init uart (communication)
-	//buttons_init(); // buttons
+	buttons_init(); // buttons
 	dcf77_init(); // dcf77 receiver
+	duty_init(); // awake time accounting
+	sched_init(); // scheduled outputs
+	evlog_add(EVLOG_RESET,persist_init()?1:0); // warm start (last known time, drift, ..)
+}
 
+// process one event (main loop body, host simulation calls it directly)
+void main_event(event_type ev)
+{
+    DUTY_BEGIN_MAIN(duty);
+    switch (ev)
+    {
+        case EVENT_SYMBOL:
+            dcf77_process(); // decoding and rtc synchronization
+            #if DCF77_DEBUG
+            show_dcf77_debug();
+            #endif
+            break;
+        case EVENT_SECOND:
+            show_time();
+            break;
+        case EVENT_BUTTON:
+            button_pressed();
+            break;
+        case EVENT_UART:
+            uart_command();
+            break;
+        case EVENT_REPORT:
+            report_next();
+            break;
+        case EVENT_BUS:
+            report_start(bus_report); // own reply slot
+            break;
+        default:
+            break;
+    }
+    DUTY_END_MAIN(DUTY_MAIN,duty);
+}
 
-    #if DCF77_DEBUG
-    lcm_goto(0,0);
-    lcm_prints("DCF");
-    #endif
+// main program body
+int main(void)
+{
+	WDTCTL = WDTPW + WDTHOLD;	// Stop WDT
+	stack_paint(); // stack high water mark
+
+	main_init();
 
 	while(1)
 	{
-        __bis_SR_register(CPUOFF + GIE); // enter sleep mode (leave on rtc second event)
-        tstruct tnow;
-        rtc_get_time(&tnow);
-        char tstr[16];
-        sprint_time(&tnow,tstr);
-        lcm_goto(1,0);
-        lcm_prints(tstr);
-        str_add_lineend(tstr,16);
-        uart_puts(tstr);
-        uint8_t b=get_button();
-        if (b)
-        {
-            /*lcm_goto(0,3);
-            tstr[0]='0'+b;
-            tstr[1]='\0';
-            lcm_prints(tstr);*/
-            if (b==3) // test rtc set function
-            {
-                tnow.second = 0;
-                tnow.minute = 33;
-                tnow.hour = 22;
-                tnow.dayow = 2;
-                rtc_set_time(&tnow);
-            }
-        }
-        #if DCF77_DEBUG
-        // dcf
-        if (symbol_ready)
-        {
-            int ci=0;
-            lcm_goto(0,3);
-            tstr[ci++]=h2c(tunestatus);
-            tstr[ci++]=' ';
-            tstr[ci++]=h2c(last_symbol);
-            tstr[ci++]=' ';
-            tstr[ci++]=h2c((int)last_Q/100%10);
-            tstr[ci++]=h2c((int)last_Q/10%10);
-            tstr[ci++]=h2c((int)last_Q%10);
-            tstr[ci++]=' ';
-            tstr[ci++]=h2c((int)(finetune>>12));
-            tstr[ci++]=h2c((int)(finetune>>8)&0x0F);
-            tstr[ci++]=h2c((int)(finetune>>4)&0x0F);
-            tstr[ci++]=h2c((int)(finetune&0x0F));
-            tstr[ci++]='\0';
-            lcm_prints(tstr);
-            symbol_ready = false;
-        }
-        #endif
+        main_event(event_wait()); // sleep until some event (LPM3/LPM0)
 	}
 
 	return -1;
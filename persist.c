@@ -0,0 +1,150 @@
+/**
+ *
+ * persistent state module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * last known time, crystal drift, fine sync. votes and sync. quality
+ * history are saved periodically into information memory and restored
+ * after reset (warm start)
+ *
+ * records are appended into segments B and D used as a ring (8 slots),
+ * segment is erased only when the ring enters it, so each segment is
+ * erased once per 8 saves; every record is protected by crc16 and the
+ * valid one with the highest sequence number wins
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include <string.h>
+#include "flash.h"
+#include "dcf77.h"
+#include "bus.h"
+#include "link.h"
+#include "persist.h" // self
+
+#define PERSIST_SLOTS_PER_SEGMENT (FLASH_SEGMENT_SIZE/sizeof(persist_record))
+#define PERSIST_SLOTS (2*PERSIST_SLOTS_PER_SEGMENT)
+
+// last used slot (-1 .. none) and its sequence number
+int persist_slot = -1;
+uint16_t persist_seq = 0;
+// sync. quality history and decodings counter at last save
+uint8_t persist_quality = 0;
+uint16_t persist_decodes = 0;
+
+/** local functions section **/
+
+// slot address (segment B slots first, then segment D)
+persist_record *persist_slot_addr(int slot)
+{
+    uint8_t *seg = (slot<PERSIST_SLOTS_PER_SEGMENT)?FLASH_INFO_B:FLASH_INFO_D;
+    return (persist_record*)seg+(slot%PERSIST_SLOTS_PER_SEGMENT);
+}
+
+// crc16 (ccitt)
+uint16_t persist_crc(const uint8_t *data, int len)
+{
+    uint16_t crc = 0xFFFF;
+    int i,b;
+    for (i=0;i<len;i++)
+    {
+        crc ^= (uint16_t)data[i]<<8;
+        for (b=0;b<8;b++)
+            crc = (crc&0x8000)?((crc<<1)^0x1021):(crc<<1);
+    }
+    return crc;
+}
+
+// record valid test
+bool persist_valid(const persist_record *r)
+{
+    return (persist_crc((const uint8_t*)r,sizeof(persist_record)-2)==r->crc);
+}
+
+// slot erased test
+bool persist_blank(const persist_record *r)
+{
+    const uint8_t *p = (const uint8_t*)r;
+    int i;
+    for (i=0;i<sizeof(persist_record);i++) if (p[i]!=0xFF) return false;
+    return true;
+}
+
+/** global functions section **/
+
+// find the last valid record and restore state from it
+bool persist_init(void)
+{
+    int i;
+    for (i=0;i<PERSIST_SLOTS;i++)
+    {
+        persist_record *r = persist_slot_addr(i);
+        if (!persist_valid(r)) continue;
+        if ((persist_slot<0)||((int16_t)(r->seq-persist_seq)>0))
+        {
+            persist_slot = i;
+            persist_seq = r->seq;
+        }
+    }
+    if (persist_slot<0) return false;
+
+    persist_record *r = persist_slot_addr(persist_slot);
+    rtc_restore_time(&r->time);
+    if (r->flags&PERSIST_FLAG_DRIFT) rtc_set_drift(r->drift);
+    dcf77_set_finetune(r->finetune);
+    persist_quality = r->quality;
+    bus_set_address(r->address); // erased (0xFF) .. default one kept
+    link_set_mode((r->flags&PERSIST_FLAG_LINK)>>2);
+    return true;
+}
+
+// save state into the next slot
+void persist_save(void)
+{
+    persist_record rec;
+    int16_t drift;
+    uint16_t decodes = dcf77_get_decodes();
+
+    rtc_get_time(&rec.time);
+    rec.flags = dcf77_get_sync_mode()&PERSIST_FLAG_MODE;
+    rec.flags |= (link_get_mode()<<2)&PERSIST_FLAG_LINK;
+    if (rtc_get_drift(&drift)) rec.flags |= PERSIST_FLAG_DRIFT;
+    rec.drift = drift;
+    rec.finetune = dcf77_get_finetune();
+    persist_quality = (persist_quality<<1)|((decodes!=persist_decodes)?1:0);
+    persist_decodes = decodes;
+    rec.quality = persist_quality;
+    rec.address = bus_get_address();
+    rec.reserved = 0xFF;
+    rec.seq = ++persist_seq;
+    rec.crc = persist_crc((const uint8_t*)&rec,sizeof(persist_record)-2);
+
+    // next slot, erase segment when entering it (or if slot is not blank)
+    int slot = (persist_slot+1)%PERSIST_SLOTS;
+    persist_record *r = persist_slot_addr(slot);
+    if (((slot%PERSIST_SLOTS_PER_SEGMENT)!=0)&&(!persist_blank(r)))
+    {
+        slot = (slot<PERSIST_SLOTS_PER_SEGMENT)?PERSIST_SLOTS_PER_SEGMENT:0;
+        r = persist_slot_addr(slot);
+    }
+    if ((slot%PERSIST_SLOTS_PER_SEGMENT)==0) flash_erase((uint8_t*)r);
+    flash_write((uint8_t*)r,(const uint8_t*)&rec,sizeof(persist_record));
+    persist_slot = slot;
+}
+
+// save state periodically (only when synchronized since reset)
+void persist_tick(tstruct *tnow)
+{
+    if ((tnow->second!=30)||((tnow->minute%PERSIST_PERIOD_MIN)!=0)) return;
+    if (rtc_get_sync_age()==0xFFFFFFFF) return;
+    persist_save();
+}
+
+// get sync. quality history
+uint8_t persist_get_quality(void)
+{
+    return persist_quality;
+}
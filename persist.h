@@ -0,0 +1,39 @@
+/**
+ *
+ * persistent state module header
+ *
+ **/
+
+#ifndef __PERSIST_H__
+#define __PERSIST_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "rtc.h"
+
+// save period (minutes, state saved at second 30 of every n-th minute)
+#define PERSIST_PERIOD_MIN 60
+
+// persistent record (16 bytes, 4 records in information memory segment)
+typedef struct {
+    uint16_t seq; // sequence number (the highest is the last one)
+    tstruct time; // last known time
+    int16_t drift; // crystal drift estimate (0.1ppm)
+    int16_t finetune; // fine synchronization votes
+    uint8_t flags; // sync. mode (bits 0..1), time link mode (bits 2..3), drift valid (bit 7)
+    uint8_t quality; // sync. quality history (bit per save period, 1 .. decoded, bit 0 the last)
+    uint8_t address; // bus address
+    uint8_t reserved;
+    uint16_t crc; // crc16 of all above
+} persist_record;
+
+#define PERSIST_FLAG_MODE 0x03
+#define PERSIST_FLAG_LINK 0x0C
+#define PERSIST_FLAG_DRIFT 0x80
+
+bool persist_init(void); // restore state (true if valid record found)
+void persist_tick(tstruct *tnow); // save state periodically (main loop, every second)
+void persist_save(void); // save state now
+uint8_t persist_get_quality(void); // sync. quality history
+
+#endif
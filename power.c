@@ -0,0 +1,81 @@
+/**
+ *
+ * power management module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * main loop sleeps in LPM3 (only ACLK running, DCO off) if no subsystem
+ * needs SMCLK, otherwise in LPM0; DCO starts automatically on wakeup
+ * so the cpu runs at full speed only when there is some work to do
+ *
+ * time spent in each mode is counted in rtc timer ticks (duty cycle
+ * accounting builds only, DUTY_ACCT)
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "duty.h"
+#include "power.h" // self
+
+volatile power_mode_type power_mode = POWER_ACTIVE;
+
+// subsystems holding SMCLK on
+volatile uint8_t power_holds = 0;
+
+#if DUTY_ACCT
+// time accounting (rtc timer ticks)
+volatile uint32_t power_ticks[POWER_MODES];
+#endif
+
+// keep SMCLK on (call it before starting a SMCLK peripheral)
+void power_hold(uint8_t mask)
+{
+    power_holds |= mask;
+}
+
+// SMCLK not needed anymore (can be called from ISR)
+void power_release(uint8_t mask)
+{
+    power_holds &= ~mask;
+}
+
+// enter sleep mode (returns after POWER_WAKEUP in some ISR)
+void power_sleep(void)
+{
+    __disable_interrupt(); // no wakeup between decision and sleep
+    if (power_holds)
+    {
+        power_mode = POWER_LPM0;
+        __bis_SR_register(LPM0_bits + GIE);
+    }
+    else
+    {
+        power_mode = POWER_LPM3;
+        __bis_SR_register(LPM3_bits + GIE);
+    }
+    power_mode = POWER_ACTIVE;
+}
+
+// count one tick into current mode
+void power_tick(void)
+{
+    #if DUTY_ACCT
+    power_ticks[power_mode]++;
+    #endif
+}
+
+// get ticks spent in given power mode
+uint32_t power_get_ticks(power_mode_type mode)
+{
+    #if DUTY_ACCT
+    uint32_t t;
+    __disable_interrupt();
+    t = power_ticks[mode];
+    __enable_interrupt();
+    return t;
+    #else
+    return 0;
+    #endif
+}
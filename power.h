@@ -0,0 +1,31 @@
+/**
+ *
+ * power management module header
+ *
+ **/
+
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// power modes (used also as index to time accounting table)
+typedef enum {POWER_ACTIVE,POWER_LPM0,POWER_LPM3,POWER_MODES} power_mode_type;
+
+// subsystems needing SMCLK (DCO) running while cpu sleeps (bit mask)
+#define POWER_HOLD_UART 0x01
+
+// current power mode (set by power_sleep, cleared by POWER_WAKEUP)
+extern volatile power_mode_type power_mode;
+
+// leave sleep mode after interrupt (use inside ISR only)
+#define POWER_WAKEUP() {power_mode=POWER_ACTIVE;__bic_SR_register_on_exit(LPM3_bits);}
+
+void power_hold(uint8_t mask); // keep SMCLK on (LPM0 instead of LPM3)
+void power_release(uint8_t mask); // SMCLK not needed anymore
+void power_sleep(void); // enter deepest allowed sleep mode (leave on wakeup event)
+void power_tick(void); // time accounting (call from rtc timer ISR)
+uint32_t power_get_ticks(power_mode_type mode); // ticks spent in power mode
+
+#endif
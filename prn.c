@@ -0,0 +1,129 @@
+/**
+ *
+ * dcf77 phase modulation (pseudo-random sequence) timing decoder
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * dcf77 carrier is phase modulated by 512 chips pseudo-random sequence
+ * (9 bit lfsr x^9+x^5+1 and one more chip) in every second, the sequence
+ * is inverted when the time information bit is 1
+ *
+ * the am receiver can't provide carrier phase, so this module expects soft
+ * chip samples from phase demodulator (integrate and dump, one per chip)
+ * and its start aligned to the am second mark, reference sequence is generated
+ * on the fly and correlated in 2*PRN_SEARCH+1 parallel lags (no sample buffer),
+ * the peak is interpolated between lags to sub chip (sub ms) accuracy and
+ * passed to rtc as second epoch offset
+ *
+ **/
+
+/// include section
+#include <stdlib.h>
+#include "rtc.h"
+#include "prn.h" // self
+
+#define PRN_LAGS (2*PRN_SEARCH+1)
+#define PRN_SAMPLES (PRN_CHIPS+2*PRN_SEARCH)
+#define PRN_LFSR_INIT 0x1FF
+#define PRN_MIN_PEAK (PRN_CHIPS*PRN_SOFT_MAX/4) // minimal correlation peak (1/4 of ideal)
+
+// correlator state
+int16_t prn_corr[PRN_LAGS]; // correlation sums
+uint32_t prn_ref = 0; // reference chips history (bit lag .. chip n-lag)
+uint32_t prn_valid = 0; // reference chips valid (within sequence)
+uint16_t prn_lfsr = PRN_LFSR_INIT;
+uint16_t prn_n = PRN_SAMPLES; // sample counter (PRN_SAMPLES .. idle)
+
+prn_result prn_last;
+volatile bool prn_new = false;
+
+/** local functions section **/
+
+// next reference chip (lfsr output, 512th chip is 0)
+uint8_t prn_next_chip(uint16_t n)
+{
+    if (n>=(PRN_CHIPS-1)) return 0;
+    uint8_t chip = prn_lfsr&0x01;
+    uint16_t fb = (prn_lfsr^(prn_lfsr>>4))&0x01;
+    prn_lfsr = (prn_lfsr>>1)|(fb<<8);
+    return chip;
+}
+
+// peak search, interpolation and result
+void prn_evaluate(void)
+{
+    int i, best = 0;
+    for (i=1;i<PRN_LAGS;i++) if (abs(prn_corr[i])>abs(prn_corr[best])) best=i;
+
+    int16_t peak = abs(prn_corr[best]);
+    int32_t pos = (int32_t)(best-PRN_SEARCH)*256; // chips in 1/256
+    // triangular peak interpolation (soft chips .. correlation falls linearly within one chip)
+    if ((best>0)&&(best<(PRN_LAGS-1)))
+    {
+        int16_t l = abs(prn_corr[best-1]);
+        int16_t r = abs(prn_corr[best+1]);
+        int16_t den = (l<r)?(peak+r-2*l):(peak+l-2*r);
+        if (den>0) pos += ((int32_t)(r-l)*256)/den;
+    }
+
+    prn_last.offset_us = (int16_t)(pos*(PRN_CHIP_NS/1000)/256);
+    prn_last.peak = peak;
+    prn_last.bit = (prn_corr[best]<0)?1:0;
+    prn_last.valid = (peak>=PRN_MIN_PEAK);
+    prn_new = true;
+
+    if (prn_last.valid) rtc_set_epoch_offset(prn_last.offset_us);
+}
+
+/** global functions section **/
+
+// start correlation
+void prn_start(void)
+{
+    int i;
+    for (i=0;i<PRN_LAGS;i++) prn_corr[i]=0;
+    prn_ref = 0;
+    prn_valid = 0;
+    prn_lfsr = PRN_LFSR_INIT;
+    prn_n = 0;
+}
+
+// one soft chip sample (positive .. reference chip 0 phase)
+void prn_chip(int8_t soft)
+{
+    int i;
+    if (prn_n>=PRN_SAMPLES) return; // idle
+
+    if (soft>PRN_SOFT_MAX) soft=PRN_SOFT_MAX;
+    if (soft<-PRN_SOFT_MAX) soft=-PRN_SOFT_MAX;
+
+    // reference chip n (lag 0), older chips move to higher lags
+    prn_ref<<=1;
+    prn_valid<<=1;
+    if (prn_n<PRN_CHIPS)
+    {
+        prn_ref |= prn_next_chip(prn_n);
+        prn_valid |= 1;
+    }
+
+    // correlate all lags (sample n against reference chip n-lag)
+    for (i=0;i<PRN_LAGS;i++)
+    {
+        if ((prn_valid&(1UL<<i))==0) continue;
+        if (prn_ref&(1UL<<i)) prn_corr[i]-=soft;
+        else prn_corr[i]+=soft;
+    }
+
+    prn_n++;
+    if (prn_n>=PRN_SAMPLES) prn_evaluate();
+}
+
+// last result (once)
+bool prn_get_result(prn_result *r)
+{
+    if (!prn_new) return false;
+    *r = prn_last;
+    prn_new = false;
+    return true;
+}
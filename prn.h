@@ -0,0 +1,34 @@
+/**
+ *
+ * dcf77 phase modulation (pseudo-random sequence) timing decoder header
+ *
+ **/
+
+#ifndef __PRN_H__
+#define __PRN_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// sequence timing (77.5kHz / 120 chip rate, sequence starts 200ms after second mark)
+#define PRN_CHIPS 512
+#define PRN_CHIP_NS 1548387L // chip length (ns)
+#define PRN_START_MS 200
+// search window (+- chips around expected start, am second mark gives ~10ms)
+#define PRN_SEARCH 8
+// soft chip sample limits (integrated phase over chip, sign .. phase)
+#define PRN_SOFT_MAX 31
+
+// last correlation result
+typedef struct {
+    int16_t offset_us; // sequence start offset against expected one (positive .. late)
+    int16_t peak; // correlation peak (absolute value)
+    uint8_t bit; // time information bit (sequence inverted .. 1)
+    bool valid;
+} prn_result;
+
+void prn_start(void); // start correlation (PRN_SEARCH chips before expected sequence start)
+void prn_chip(int8_t soft); // one soft chip sample (demodulator, isr safe)
+bool prn_get_result(prn_result *r); // last result, returns true once per new result
+
+#endif
@@ -12,10 +12,17 @@
 #include <string.h>
 #include "dcf77.h"
 #include "rtc.h"
+#include "power.h"
+#include "duty.h"
+#include "event.h"
+#include "sched.h"
+#include "button.h"
+#include "uart.h"
+#include "link.h"
 
 // switch on (1) and off (0) debug blinking
 #define RTC_LED 1
-#if RTC_LED==1
+#if (RTC_LED==1)&&(!UART_BUS) // P1.6 is bus driver enable
     // launchpad green led (P1.4 active high)
     #define RTC_LED_INIT() {P1DIR|=0x40;P1OUT&=~0x40;}
     #define RTC_LED_ON() {P1OUT|=0x40;}
@@ -33,6 +40,35 @@ tstruct tbuff[2]; // time buffer (2 iterations swapping)
 uint8_t tptr = 0; // pointer to valid time value
 
 bool treset = true; // reset timer flag
+uint16_t tdiv = 0; // sampling ticks divider (ticks in current second)
+volatile uint16_t rtc_ticks = 0; // free running sampling ticks counter
+
+volatile uint32_t rtc_sync_age = 0; // seconds since last synchronization
+bool rtc_synced = false; // synchronized at least once
+int16_t rtc_drift = 0; // crystal drift estimate (0.1ppm, positive .. rtc runs fast)
+bool rtc_drift_valid = false;
+
+// minimal time from the anchor synchronization for drift measurement (seconds)
+#define RTC_DRIFT_MIN_AGE 600
+// drift measurement limit (0.1ppm, larger means wrong synchronization)
+#define RTC_DRIFT_MAX 1000
+// drift compensation (one tick in drift units * seconds)
+#define RTC_DRIFT_TICK (10000000L/RTC_SAMPLING_FREQV)
+int16_t rtc_drift_acc = 0; // accumulated drift (fraction of tick)
+// drift anchor (synchronizations come every minute, the drift is measured over
+// the corrections since an older one)
+uint16_t rtc_anchor_age = 0; // seconds from anchor to last synchronization
+int16_t rtc_anchor_err = 0; // sum of corrections since anchor (ticks)
+int8_t rtc_comp = 0; // pending compensation (+1 .. drop one tick, -1 .. add one tick)
+// precise epoch (phase modulation decoder), whole ticks are slewed one per tick
+volatile int8_t rtc_slew = 0; // pending epoch correction (ticks, positive .. drop ticks)
+
+// time quality (error bound) model
+#define RTC_SYNC_ERR_MS 10 // error just after synchronization (ms)
+#define RTC_SYNCED_AGE 120 // synchronized state timeout (seconds)
+#define RTC_DRIFT_UNCERT 20 // drift uncertainty with compensation (0.1ppm)
+#define RTC_XTAL_TOLERANCE 500 // drift uncertainty without estimate (0.1ppm)
+#define RTC_HOLD_MAX_ERR_MS 500 // hold over error limit (ms)
 
 /** local functions section **/
 
@@ -64,15 +100,201 @@ void inc_one_second(tstruct *tbefore, tstruct *tafter)
     }
 }
 
+// wrap phase difference (ticks within minute) into +-30s
+int32_t rtc_wrap_diff(int32_t diff)
+{
+    if (diff>(30L*RTC_SAMPLING_FREQV)) diff-=60L*RTC_SAMPLING_FREQV;
+    if (diff<(-30L*RTC_SAMPLING_FREQV)) diff+=60L*RTC_SAMPLING_FREQV;
+    return diff;
+}
+
+// update drift estimate from phase difference (wrapped) measured after age seconds,
+// corrections are summed until the anchor is RTC_DRIFT_MIN_AGE old, then it moves here
+void rtc_drift_update(int32_t diff, uint32_t age)
+{
+    int32_t err = rtc_anchor_err+diff;
+    uint32_t total = rtc_anchor_age+age;
+    rtc_anchor_age = 0;
+    rtc_anchor_err = 0;
+    // use only if it's sub-second correction (else a new anchor)
+    if ((diff>=(RTC_SAMPLING_FREQV/2))||(diff<=-(RTC_SAMPLING_FREQV/2))) return;
+    if (total<RTC_DRIFT_MIN_AGE)
+    {
+        // keep anchor
+        rtc_anchor_age = total;
+        rtc_anchor_err = err;
+        return;
+    }
+
+    int32_t meas = -err*RTC_DRIFT_TICK/(int32_t)total;
+    if ((meas>RTC_DRIFT_MAX)||(meas<-RTC_DRIFT_MAX)) return;
+    // with valid estimate the drift is compensated, so it's the residual
+    if (rtc_drift_valid) rtc_drift += meas/4; // smoothing
+    else rtc_drift = meas;
+    rtc_drift_valid = true;
+}
+
 /** global functions section **/
 
 // set time function (use for synchronization)
 void rtc_set_time(tstruct *tset)
 {
-    // reset timer (next time tick)
-    treset = true;
+    rtc_set_time_aligned(tset,0);
+}
+
+// set time of sync. event which happened age ticks ago (deferred synchronization)
+// age 0 .. sync. event in current tick, second starts with the next tick
+// returns correction (ticks, +-30s, positive .. time moved forward)
+int16_t rtc_set_time_aligned(tstruct *tset, uint16_t age)
+{
+    tstruct t;
+    memcpy(&t,tset,sizeof(tstruct));
+    // whole seconds passed since then
+    while (age>RTC_SAMPLING_FREQV)
+    {
+        tstruct tnext;
+        inc_one_second(&t,&tnext);
+        memcpy(&t,&tnext,sizeof(tstruct));
+        age-=RTC_SAMPLING_FREQV;
+    }
+
+    __disable_interrupt();
+    // phase within minute before and after (for drift estimation)
+    int32_t oldpos = (int32_t)tbuff[tptr].second*RTC_SAMPLING_FREQV+(treset?-1:(int)tdiv);
+    int32_t newpos = (int32_t)t.second*RTC_SAMPLING_FREQV+(int32_t)age-1;
+    uint32_t sync_age = rtc_sync_age;
+    bool synced = rtc_synced;
+    if (age==0)
+    {
+        // reset timer (next time tick)
+        treset = true;
+    }
+    else
+    {
+        // continue as if the time was set age ticks ago
+        treset = false;
+        tdiv = age-1;
+    }
     // set time
+    memcpy(&tbuff[tptr],&t,sizeof(tstruct));
+    rtc_sync_age = 0;
+    rtc_synced = true;
+    __enable_interrupt();
+
+    int32_t diff = rtc_wrap_diff(newpos-oldpos);
+    if (synced) rtc_drift_update(diff,sync_age);
+    else rtc_anchor_age = rtc_anchor_err = 0; // the first one is anchor
+    return (int16_t)diff;
+}
+
+// set time without synchronization (restored from persistent memory)
+void rtc_restore_time(tstruct *tset)
+{
+    __disable_interrupt();
+    treset = true;
     memcpy(&tbuff[tptr],tset,sizeof(tstruct));
+    __enable_interrupt();
+}
+
+// seconds since last synchronization (0xFFFFFFFF if never synchronized)
+uint32_t rtc_get_sync_age(void)
+{
+    uint32_t a;
+    if (!rtc_synced) return 0xFFFFFFFF;
+    __disable_interrupt();
+    a = rtc_sync_age;
+    __enable_interrupt();
+    return a;
+}
+
+// time quality and its error bound (ms, propagated from drift uncertainty since last sync.)
+rtc_quality_type rtc_get_quality(uint16_t *err_ms)
+{
+    uint32_t age = rtc_get_sync_age();
+    if (age==0xFFFFFFFF)
+    {
+        *err_ms = 0xFFFF;
+        return RTC_QUALITY_UNSYNC;
+    }
+    uint32_t uncert = rtc_drift_valid?RTC_DRIFT_UNCERT:RTC_XTAL_TOLERANCE;
+    // age saturated where the bound saturates (product fits, 99 days wrapped without drift estimate)
+    if (age>(0xFFFFUL*10000/uncert)) age = 0xFFFFUL*10000/uncert;
+    uint32_t err = RTC_SYNC_ERR_MS+age*uncert/10000;
+    *err_ms = (err>0xFFFF)?0xFFFF:err;
+    if (age<RTC_SYNCED_AGE) return RTC_QUALITY_SYNCED;
+    if (err<=RTC_HOLD_MAX_ERR_MS) return RTC_QUALITY_HOLD;
+    return RTC_QUALITY_UNSYNC;
+}
+
+// precise second epoch offset (us, positive .. rtc second starts early), isr safe
+void rtc_set_epoch_offset(int16_t offset_us)
+{
+    int16_t ticks = (int16_t)(((int32_t)offset_us*RTC_SAMPLING_FREQV+(offset_us<0?-500000L:500000L))/1000000L);
+    if (ticks>127) ticks=127;
+    if (ticks<-127) ticks=-127;
+    rtc_slew = ticks;
+}
+
+// ticks in current second
+uint16_t rtc_get_subsecond(void)
+{
+    return treset?0:tdiv; // time just set, its second starts with the next tick
+}
+
+// crystal drift estimate (0.1ppm, positive .. rtc runs fast), returns false if unknown
+bool rtc_get_drift(int16_t *drift)
+{
+    *drift = rtc_drift;
+    return rtc_drift_valid;
+}
+
+// set drift estimate (restored from persistent memory)
+void rtc_set_drift(int16_t drift)
+{
+    rtc_drift = drift;
+    rtc_drift_valid = true;
+}
+
+// get sampling ticks counter (free running)
+uint16_t rtc_get_ticks(void)
+{
+    return rtc_ticks;
+}
+
+// time stamp (ticks and timer counts within tick), a tick starts when timer reaches CCR0
+// (its interrupt may be still pending), timer runs from ACLK so it's read until stable
+uint16_t rtc_get_stamp(void)
+{
+    unsigned int istate = __get_interrupt_state();
+    uint16_t t, f;
+    __disable_interrupt();
+    f = CCTL0&CCIFG;
+    do t = TAR; while (t!=TAR);
+    if ((CCTL0&CCIFG)!=f)
+    {
+        // tick started between reads
+        f = CCIFG;
+        do t = TAR; while (t!=TAR);
+    }
+    t = rtc_ticks*RTC_STAMP_COUNTS+((t+1)&(RTC_STAMP_COUNTS-1))+(f?RTC_STAMP_COUNTS:0);
+    __set_interrupt_state(istate);
+    return t;
+}
+
+// cpu was held (flash erase/write) since stamp for about us microseconds with interrupts
+// disabled, only one tick interrupt stays pending, the others are lost, so they are added
+// (free running counter at once, time of day by slewing one per tick)
+// elapsed counts = seen counts + whole ticks, the number of ticks nearest to nominal time
+void rtc_hold_end(uint16_t stamp, uint16_t us)
+{
+    int16_t nominal = (int16_t)(((uint32_t)us*(32768/8)+500000L)/1000000L);
+    int16_t seen = (int16_t)(rtc_get_stamp()-stamp);
+    int16_t lost = nominal-seen+RTC_STAMP_COUNTS/2;
+    if (lost<RTC_STAMP_COUNTS) return;
+    lost /= RTC_STAMP_COUNTS;
+    rtc_ticks += lost;
+    lost = rtc_slew-lost;
+    rtc_slew = (lost<-127)?-127:lost;
 }
 
 // get time function
@@ -87,6 +309,22 @@ void rtc_timer_init(void)
 {
     RTC_LED_INIT();
 
+    // time state (cold start)
+    memset(tbuff,0,sizeof(tbuff));
+    tptr = 0;
+    treset = true;
+    tdiv = 0;
+    rtc_ticks = 0;
+    rtc_sync_age = 0;
+    rtc_synced = false;
+    rtc_drift = 0;
+    rtc_drift_valid = false;
+    rtc_drift_acc = 0;
+    rtc_anchor_age = 0;
+    rtc_anchor_err = 0;
+    rtc_comp = 0;
+    rtc_slew = 0;
+
 	CCTL0 = CCIE; // CCR0 interrupt enabled
 	#ifdef RTC_SAMPLING_FREQV
 	CCR0 = (32768/8/RTC_SAMPLING_FREQV)-1;
@@ -104,25 +342,44 @@ void rtc_timer_init(void)
 #pragma vector=TIMER0_A0_VECTOR
 __interrupt void Timer_A (void)
 {
-    static uint16_t tdiv = 0;
+    DUTY_BEGIN(duty);
+    rtc_ticks++;
     if (treset==false)
     {
-        // normal timing
-        tdiv++;
+        // normal timing (with drift compensation)
+        if (rtc_comp>0) rtc_comp=0; // dropped tick (clock fast)
+        else if (rtc_slew>0) rtc_slew--; // epoch slewing
+        else
+        {
+            tdiv++;
+            if (rtc_comp<0) {tdiv++;rtc_comp=0;} // added tick (clock slow)
+            else if (rtc_slew<0) {tdiv++;rtc_slew++;}
+        }
         #ifdef RTC_SAMPLING_FREQV
         if (tdiv>=RTC_SAMPLING_FREQV) // every one second
         #else
         if (tdiv>=4) // every one second
         #endif
         {
-            tdiv=0;
+            tdiv-=RTC_SAMPLING_FREQV; // added tick may cross the second boundary
             RTC_LED_ON();
             // continue with main after interrupt (as there was an second event)
-            __bic_SR_register_on_exit(CPUOFF); // Clear CPUOFF bit from 0(SR)
+            event_post(EVENT_SECOND);
 
             uint8_t nextptr=tptr^0x01;
             inc_one_second(&tbuff[tptr],&tbuff[nextptr]);
             tptr=nextptr;
+            rtc_sync_age++;
+            sched_second(&tbuff[tptr]); // scheduled outputs
+            link_second(&tbuff[tptr]); // time link master timecode
+
+            // drift compensation (accumulate drift, one tick correction when due)
+            if (rtc_drift_valid)
+            {
+                rtc_drift_acc += rtc_drift;
+                if (rtc_drift_acc>=RTC_DRIFT_TICK) {rtc_drift_acc-=RTC_DRIFT_TICK;rtc_comp=1;}
+                if (rtc_drift_acc<=-RTC_DRIFT_TICK) {rtc_drift_acc+=RTC_DRIFT_TICK;rtc_comp=-1;}
+            }
         }
         else
         {
@@ -136,10 +393,22 @@ __interrupt void Timer_A (void)
         tdiv=0;
         RTC_LED_ON();
         // continue with main after interrupt (as there was an sync. event)
-        __bic_SR_register_on_exit(CPUOFF); // Clear CPUOFF bit from 0(SR)
+        event_post(EVENT_SECOND);
 
         treset=false; // clear sync. flag
+        sched_second(&tbuff[tptr]); // scheduled outputs
+        link_second(&tbuff[tptr]); // time link master timecode
     }
 
+    power_tick(); // power mode time accounting
+
     dcf77_strobe();
+    button_tick(); // buttons debouncing
+    uart_tick(); // bus driver release
+
+    // delayed events and main loop wakeup (second, symbol, ...)
+    event_tick();
+    if (event_pending()) POWER_WAKEUP();
+
+    DUTY_END(DUTY_TIMER,duty);
 }
@@ -2,9 +2,19 @@
 #define __RTC_H__
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 // rtc sampling frequency (less - less interrupts, more - lower delay)
 #define RTC_SAMPLING_FREQV 512 // should be power of 2 (2,4,8 tested)
+// timer A runs at 32768/8 Hz, CCR0 period (rtc_timer_init) has to be whole
+#if (RTC_SAMPLING_FREQV&(RTC_SAMPLING_FREQV-1))!=0
+#error "RTC_SAMPLING_FREQV has to be power of 2"
+#endif
+#if ((32768/8)%RTC_SAMPLING_FREQV)!=0
+#error "RTC_SAMPLING_FREQV has to divide 32768/8"
+#endif
+// timer A counts per tick (time stamp resolution)
+#define RTC_STAMP_COUNTS (32768/8/RTC_SAMPLING_FREQV)
 
 // time structure
 typedef struct
@@ -15,8 +25,27 @@ typedef struct
     uint8_t dayow; // (day of week) 0..6
 } tstruct;
 
+// time quality
+typedef enum {
+    RTC_QUALITY_UNSYNC, // never synchronized or error bound too big
+    RTC_QUALITY_HOLD, // free running, error bound still small
+    RTC_QUALITY_SYNCED // synchronized recently
+} rtc_quality_type;
+
 void rtc_set_time(tstruct *tset); // time synchronization
+int16_t rtc_set_time_aligned(tstruct *tset, uint16_t age); // time synchronization (sync. event age ticks ago)
+void rtc_restore_time(tstruct *tset); // set time without synchronization
 void rtc_get_time(tstruct *tget); // get time function
+rtc_quality_type rtc_get_quality(uint16_t *err_ms); // time quality and error bound (ms)
+void rtc_set_epoch_offset(int16_t offset_us); // precise second epoch (phase modulation decoder)
+uint16_t rtc_get_subsecond(void); // ticks in current second
+void inc_one_second(tstruct *tbefore, tstruct *tafter); // time increment helper
+uint16_t rtc_get_ticks(void); // free running sampling ticks counter
+uint16_t rtc_get_stamp(void); // free running time stamp (timer A counts, RTC_STAMP_COUNTS per tick)
+void rtc_hold_end(uint16_t stamp, uint16_t us); // add ticks lost while cpu was held for ~us since stamp (interrupts disabled)
+uint32_t rtc_get_sync_age(void); // seconds since last synchronization
+bool rtc_get_drift(int16_t *drift); // crystal drift estimate (0.1ppm)
+void rtc_set_drift(int16_t drift); // restore drift estimate
 
 void rtc_timer_init(void); // init function
 
@@ -0,0 +1,229 @@
+/**
+ *
+ * output scheduler module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * table of (time, day of week mask, output, action) entries switching
+ * outputs, kept sorted by time of day in information memory (persistent,
+ * no ram copy), new entry position found by binary search, the table is
+ * rewritten through the flash scratch segment (no ram copy either)
+ *
+ * main loop looks one second ahead (cursor to the next due entry, so it's
+ * O(1) per second, binary search only after time jump) and arms output
+ * masks, rtc timer isr applies them exactly at the second boundary
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "flash.h"
+#include "uart.h"
+#include "sched.h" // self
+
+// outputs (port 1, output 0 .. P1.0 red led)
+#define SCHED_OUTPUTS 1
+#define SCHED_OUT P1OUT
+#define SCHED_DIR P1DIR
+const uint8_t sched_out_pins[SCHED_OUTPUTS] = {BIT0};
+// switch outputs only when time is trusted (synchronized or hold over within error bound)
+#define SCHED_MIN_QUALITY RTC_QUALITY_HOLD
+
+// table in information memory segment C (erased flash reads 0xFF count .. empty)
+typedef struct {
+    uint8_t count;
+    uint8_t reserved;
+    sched_entry entry[SCHED_MAX];
+} sched_table;
+
+#define SCHED_TABLE ((const sched_table*)FLASH_INFO_C)
+
+// cursor (next due entry) and last checked time key
+int sched_next = 0;
+uint32_t sched_last = 0xFFFFFFFF;
+
+// armed actions (for the second with time key sched_armed_key)
+volatile bool sched_armed = false;
+volatile uint16_t sched_armed_key; // low bits (armed just one second ahead)
+volatile uint8_t sched_armed_set, sched_armed_clr;
+
+/** local functions section **/
+
+// time key (sortable time of day)
+uint32_t sched_time_key(tstruct *t)
+{
+    return ((uint32_t)(t->hour*60+t->minute)<<6)|t->second;
+}
+
+uint32_t sched_entry_key(const sched_entry *e)
+{
+    return ((uint32_t)e->minute<<6)|(e->second_out>>2);
+}
+
+// key of the following second within the day (seconds field is 6 bits wide)
+uint32_t sched_key_next(uint32_t key)
+{
+    return ((key&0x3F)>=59)?((key|0x3F)+1):(key+1);
+}
+
+// first entry with key not less than given key
+int sched_lower_bound(uint32_t key)
+{
+    int lo=0, hi=sched_count();
+    while (lo<hi)
+    {
+        int mid=(lo+hi)>>1;
+        if (sched_entry_key(&SCHED_TABLE->entry[mid])<key) lo=mid+1;
+        else hi=mid;
+    }
+    return lo;
+}
+
+// rewrite table in flash: entries before i, new entry e (0 .. none), entries from j on
+// (new image is written into scratch segment from the old table, then copied back)
+void sched_store(int i, const sched_entry *e, int j)
+{
+    const sched_table *t = SCHED_TABLE;
+    uint8_t *s = FLASH_SCRATCH;
+    uint8_t head[2];
+    int n = sched_count();
+    head[0] = i+((e!=0)?1:0)+(n-j);
+    head[1] = 0;
+    flash_erase(s);
+    flash_write(s,head,2);
+    s += 2;
+    flash_write(s,(const uint8_t*)&t->entry[0],i*sizeof(sched_entry));
+    s += i*sizeof(sched_entry);
+    if (e!=0)
+    {
+        flash_write(s,(const uint8_t*)e,sizeof(sched_entry));
+        s += sizeof(sched_entry);
+    }
+    flash_write(s,(const uint8_t*)&t->entry[j],(n-j)*sizeof(sched_entry));
+    flash_erase(FLASH_INFO_C);
+    flash_write(FLASH_INFO_C,FLASH_SCRATCH,2+head[0]*sizeof(sched_entry));
+    sched_last = 0xFFFFFFFF; // seek cursor again
+}
+
+/** global functions section **/
+
+// init outputs (all off)
+void sched_init(void)
+{
+    int i;
+    for (i=0;i<SCHED_OUTPUTS;i++)
+    {
+        SCHED_DIR |= sched_out_pins[i];
+        SCHED_OUT &= ~sched_out_pins[i];
+    }
+}
+
+// number of entries
+int sched_count(void)
+{
+    uint8_t c = SCHED_TABLE->count;
+    return (c>SCHED_MAX)?0:c;
+}
+
+// get entry
+const sched_entry *sched_get(int i)
+{
+    if ((i<0)||(i>=sched_count())) return 0;
+    return &SCHED_TABLE->entry[i];
+}
+
+// insert entry (sorted)
+int sched_add(const sched_entry *e)
+{
+    int n = sched_count();
+    if ((n>=SCHED_MAX)||(e->minute>=1440)||((e->second_out>>2)>=60)) return -1;
+    int i = sched_lower_bound(sched_entry_key(e));
+    sched_store(i,e,i);
+    return i;
+}
+
+// remove entry
+int sched_remove(int i)
+{
+    int n = sched_count();
+    if ((i<0)||(i>=n)) return -1;
+    sched_store(i,0,i+1);
+    return 0;
+}
+
+// remove all entries
+void sched_clear(void)
+{
+    flash_erase(FLASH_INFO_C);
+    sched_last = 0xFFFFFFFF;
+}
+
+// prepare actions of the next second (call every second from main loop)
+void sched_check(tstruct *tnow)
+{
+    tstruct tnext;
+    uint8_t set=0, clr=0;
+    int n = sched_count();
+
+    inc_one_second(tnow,&tnext);
+    uint32_t key = sched_time_key(&tnext);
+    // time jump (sync., missed second or midnight) .. seek cursor
+    if (key!=sched_key_next(sched_last)) sched_next = sched_lower_bound(key);
+    sched_last = key;
+
+    // all entries due in the next second
+    while ((sched_next<n)&&(sched_entry_key(&SCHED_TABLE->entry[sched_next])==key))
+    {
+        const sched_entry *e = &SCHED_TABLE->entry[sched_next++];
+        uint8_t out = e->second_out&0x03;
+        if ((out>=SCHED_OUTPUTS)||((e->dow_action&(1<<tnext.dayow))==0)) continue;
+        if (e->dow_action&SCHED_ACTION_ON) set|=sched_out_pins[out];
+        else clr|=sched_out_pins[out];
+    }
+
+    // untrusted time .. skip (entries are not replayed after sync.)
+    uint16_t err;
+    if (rtc_get_quality(&err)<SCHED_MIN_QUALITY) set=clr=0;
+
+    __disable_interrupt();
+    sched_armed_key = key;
+    sched_armed_set = set;
+    sched_armed_clr = clr;
+    sched_armed = ((set|clr)!=0);
+    __enable_interrupt();
+}
+
+// apply armed actions (rtc timer isr, just after second increment)
+void sched_second(tstruct *tnow)
+{
+    if (sched_armed==false) return;
+    if ((uint16_t)sched_time_key(tnow)==sched_armed_key)
+    {
+        SCHED_OUT |= sched_armed_set;
+        SCHED_OUT &= ~sched_armed_clr;
+    }
+    sched_armed = false;
+}
+
+// format table line "NN hhhhhhhh\r\n" (index, entry bytes)
+int sched_report(int line, char *s, int len)
+{
+    const sched_entry *e = sched_get(line);
+    if ((e==0)||(len<14)) return -1;
+    s[0] = h2c(line>>4);
+    s[1] = h2c(line);
+    s[2] = ' ';
+    s[3] = h2c(e->minute>>12);
+    s[4] = h2c(e->minute>>8);
+    s[5] = h2c(e->minute>>4);
+    s[6] = h2c(e->minute);
+    s[7] = h2c(e->second_out>>4);
+    s[8] = h2c(e->second_out);
+    s[9] = h2c(e->dow_action>>4);
+    s[10] = h2c(e->dow_action);
+    s[11] = '\r';
+    s[12] = '\n';
+    s[13] = '\0';
+    return 0;
+}
@@ -0,0 +1,36 @@
+/**
+ *
+ * output scheduler module header
+ *
+ **/
+
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "rtc.h"
+
+// schedule entry (4 bytes, table sorted by time of day)
+typedef struct {
+    uint16_t minute; // minute of day (0..1439)
+    uint8_t second_out; // second (bits 2..7), output (bits 0..1)
+    uint8_t dow_action; // day of week mask (bit n .. dayow n), action (bit 7, 1 .. on, 0 .. off)
+} sched_entry;
+
+#define SCHED_ACTION_ON 0x80
+
+// table capacity (one information memory segment)
+#define SCHED_MAX 15
+
+void sched_init(void); // outputs init
+int sched_count(void); // number of entries
+const sched_entry *sched_get(int i); // get entry
+int sched_add(const sched_entry *e); // insert entry (returns index or -1)
+int sched_remove(int i); // remove entry
+void sched_clear(void); // remove all entries
+void sched_check(tstruct *tnow); // prepare next second actions (main loop, every second)
+void sched_second(tstruct *tnow); // apply prepared actions (rtc timer isr, second boundary)
+int sched_report(int line, char *s, int len); // format one table line (returns -1 after last line)
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ *
+ * ram and stack usage module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * ram between the end of static data (linker _end) and current stack
+ * pointer is painted by pattern at start, the stack high water mark is
+ * where the pattern is overwritten (searched from the bottom, so it's
+ * the deepest stack usage ever incl. interrupts)
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include "uart.h"
+#include "stack.h" // self
+
+#define STACK_PATTERN 0xA5
+#define STACK_MARGIN 8 // bytes under stack pointer left unpainted (stack_paint frame)
+
+// linker symbols (end of static data, initial stack pointer .. end of ram)
+extern uint8_t _end;
+extern uint8_t __stack;
+#define STACK_RAM_START ((uint8_t*)0x0200)
+
+// paint free ram
+void stack_paint(void)
+{
+    uint8_t *p = &_end;
+    uint8_t *sp = (uint8_t*)__read_stack_pointer()-STACK_MARGIN;
+    while (p<sp) *p++ = STACK_PATTERN;
+}
+
+// static ram size
+uint16_t stack_static(void)
+{
+    return &_end-STACK_RAM_START;
+}
+
+// never used ram (pattern not overwritten)
+uint16_t stack_free(void)
+{
+    uint8_t *p = &_end;
+    while ((p<&__stack)&&(*p==STACK_PATTERN)) p++;
+    return p-&_end;
+}
+
+// stack high water mark
+uint16_t stack_max(void)
+{
+    return (&__stack-&_end)-stack_free();
+}
+
+// report (R .. static ram, S .. stack high water mark, F .. free ram; bytes)
+int stack_report(int line, char *s, int len)
+{
+    uint16_t v;
+    if ((line>2)||(len<9)) return -1;
+    s[0] = "RSF"[line];
+    v = (line==0)?stack_static():((line==1)?stack_max():stack_free());
+    s[1] = ' ';
+    s[2] = h2c(v>>12); s[3] = h2c(v>>8); s[4] = h2c(v>>4); s[5] = h2c(v);
+    s[6] = '\r'; s[7] = '\n'; s[8] = '\0';
+    return 0;
+}
@@ -0,0 +1,18 @@
+/**
+ *
+ * ram and stack usage module header
+ *
+ **/
+
+#ifndef __STACK_H__
+#define __STACK_H__
+
+#include <inttypes.h>
+
+void stack_paint(void); // paint free ram (the very first call in main)
+uint16_t stack_static(void); // static ram (data, bss, noinit) bytes
+uint16_t stack_max(void); // stack high water mark (bytes)
+uint16_t stack_free(void); // never used ram between static data and stack (bytes)
+int stack_report(int line, char *s, int len); // format one report line (returns -1 after last one)
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ *
+ * reception statistics module
+ *
+ * author: ondrejh dot ck at gmail dot com
+ * date: 19.10.2026
+ *
+ * incremental (O(1) per symbol) statistics of dcf77 reception:
+ *      per minute mean/min signal quality, not detected symbols and
+ *      fine sync. corrections
+ *      minute block decoding results by failure reason
+ *      not detected symbols per hour of day (% of hour, last 24 hours)
+ *
+ **/
+
+/// include section
+#include <msp430g2553.h>
+#include <string.h>
+#include "rtc.h"
+#include "uart.h"
+#include "evlog.h"
+#include "stats.h" // self
+
+#define STATS_DECODE_RESULTS (DCF77_DECODE_RANGE+1)
+// maximal signal quality (dcf77 detection period)
+#define STATS_Q_MAX RTC_SAMPLING_FREQV
+#if (60L*STATS_Q_MAX)>0xFFFF
+#error "minute quality sum doesn't fit 16 bits"
+#endif
+
+// current minute accumulators
+uint16_t stats_q_sum = 0; // 60 symbols fit (max. 60*STATS_Q_MAX)
+int stats_q_min = STATS_Q_MAX;
+uint8_t stats_cnt = 0, stats_none = 0;
+uint16_t stats_shifts_last = 0;
+
+// last minute summary
+stats_minute stats_last = {0,0,0,0};
+
+// decoding results
+uint16_t stats_decodes[STATS_DECODE_RESULTS];
+
+// not detected symbols per hour of day (% of hour, rounded up) and current hour counter
+uint8_t stats_hour_none[24];
+uint16_t stats_hour_cnt = 0;
+uint8_t stats_hour = 0xFF;
+
+// quality to percent
+uint8_t stats_percent(uint32_t q, uint16_t n)
+{
+    return q*100/((uint32_t)n*STATS_Q_MAX);
+}
+
+// account one symbol
+void stats_symbol(dcf77_symbol_type sym, int sigQ)
+{
+    tstruct t;
+
+    // minute accumulators
+    stats_q_sum += sigQ;
+    if (sigQ<stats_q_min) stats_q_min = sigQ;
+    if (sym==DCF77_SYMBOL_NONE) stats_none++;
+    if (++stats_cnt>=60)
+    {
+        uint16_t shifts = dcf77_get_shifts();
+        stats_last.mean_q = stats_percent(stats_q_sum,60);
+        stats_last.min_q = stats_percent(stats_q_min,1);
+        stats_last.none = stats_none;
+        stats_last.shifts = shifts-stats_shifts_last;
+        stats_shifts_last = shifts;
+        evlog_add(EVLOG_QUALITY,stats_last.mean_q);
+        stats_q_sum = 0;
+        stats_q_min = STATS_Q_MAX;
+        stats_cnt = 0;
+        stats_none = 0;
+    }
+
+    // hour of day histogram (bin cleared when entering new hour), decoder without
+    // parity checks may set hours out of range
+    rtc_get_time(&t);
+    if (t.hour>=24) return;
+    if (t.hour!=stats_hour)
+    {
+        stats_hour = t.hour;
+        stats_hour_none[stats_hour] = 0;
+        stats_hour_cnt = 0;
+    }
+    if (sym==DCF77_SYMBOL_NONE)
+    {
+        stats_hour_cnt++;
+        stats_hour_none[stats_hour] = ((uint32_t)stats_hour_cnt*100+3599)/3600;
+    }
+}
+
+// account decoding result
+void stats_decode(dcf77_decode_result res)
+{
+    if (res<STATS_DECODE_RESULTS) stats_decodes[res]++;
+}
+
+// last minute summary
+const stats_minute *stats_get_minute(void)
+{
+    return &stats_last;
+}
+
+// format report lines
+//  "M qq mm nn ss\r\n" .. last minute mean and min quality (%), not detected symbols, corrections
+//  "Dr hhhh\r\n" .. decoding results (r: 0 ok, 1 invalid bits, 2 length, 3 marker, 4 parity, 5 range)
+//  "Hhh hhhh\r\n" .. not detected symbols in hour of day (% of hour)
+//  "T hhhh hhhh\r\n", "N hhhh hhhh\r\n", "S hhhh hhhh\r\n" .. signal quality threshold and
+//      symbol margin, noise and signal quality distribution (mean, deviation)
+//  "L hhhh\r\n" .. symbols lost by full isr to main loop queue
+//  "Cn hhhh*\r\n" .. receiver channel quality score (* .. primary channel)
+int stats_report(int line, char *s, int len)
+{
+    uint16_t v;
+    if (len<16) return -1;
+    if (line>=(1+STATS_DECODE_RESULTS+24))
+    {
+        dcf77_adapt_state a;
+        dcf77_get_adapt(&a);
+        line -= 1+STATS_DECODE_RESULTS+24;
+        if (line==3)
+        {
+            v = dcf77_get_queue_drops();
+            s[0] = 'L'; s[1] = ' ';
+            s[2] = h2c(v>>12); s[3] = h2c(v>>8); s[4] = h2c(v>>4); s[5] = h2c(v);
+            s[6] = '\r'; s[7] = '\n'; s[8] = '\0';
+            return 0;
+        }
+        if (line>3)
+        {
+            // receiver channels quality score (* .. primary channel)
+            uint8_t primary;
+            line -= 4;
+            if (line>=dcf77_get_channels(&primary)) return -1;
+            v = dcf77_get_channel_score(line);
+            s[0] = 'C'; s[1] = h2c(line); s[2] = ' ';
+            s[3] = h2c(v>>12); s[4] = h2c(v>>8); s[5] = h2c(v>>4); s[6] = h2c(v);
+            s[7] = (line==primary)?'*':' ';
+            s[8] = '\r'; s[9] = '\n'; s[10] = '\0';
+            return 0;
+        }
+        s[0] = "TNS"[line];
+        s[1] = ' ';
+        v = (line==0)?a.thr:((line==1)?a.noise_mean:a.signal_mean);
+        s[2] = h2c(v>>12); s[3] = h2c(v>>8); s[4] = h2c(v>>4); s[5] = h2c(v);
+        v = (line==0)?a.margin:((line==1)?a.noise_dev:a.signal_dev);
+        s[6] = ' ';
+        s[7] = h2c(v>>12); s[8] = h2c(v>>8); s[9] = h2c(v>>4); s[10] = h2c(v);
+        s[11] = '\r'; s[12] = '\n'; s[13] = '\0';
+        return 0;
+    }
+    if (line==0)
+    {
+        uint8_t *b = (uint8_t*)&stats_last;
+        int i;
+        s[0] = 'M';
+        for (i=0;i<4;i++)
+        {
+            s[1+3*i] = ' ';
+            s[2+3*i] = h2c(b[i]>>4);
+            s[3+3*i] = h2c(b[i]);
+        }
+        s[13] = '\r';
+        s[14] = '\n';
+        s[15] = '\0';
+        return 0;
+    }
+    line--;
+    if (line<STATS_DECODE_RESULTS)
+    {
+        s[0] = 'D';
+        s[1] = h2c(line);
+        v = stats_decodes[line];
+    }
+    else
+    {
+        line -= STATS_DECODE_RESULTS;
+        if (line>=24) return -1;
+        s[0] = 'H';
+        s[1] = h2c(line/10);
+        s[2] = h2c(line%10);
+        s++;
+        v = stats_hour_none[line];
+    }
+    s[2] = ' ';
+    s[3] = h2c(v>>12);
+    s[4] = h2c(v>>8);
+    s[5] = h2c(v>>4);
+    s[6] = h2c(v);
+    s[7] = '\r';
+    s[8] = '\n';
+    s[9] = '\0';
+    return 0;
+}
@@ -0,0 +1,26 @@
+/**
+ *
+ * reception statistics module header
+ *
+ **/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <inttypes.h>
+#include "dcf77.h"
+
+// last complete minute summary
+typedef struct {
+    uint8_t mean_q; // mean signal quality (%)
+    uint8_t min_q; // minimal signal quality (%)
+    uint8_t none; // symbols not detected
+    uint8_t shifts; // fine sync. corrections
+} stats_minute;
+
+void stats_symbol(dcf77_symbol_type sym, int sigQ); // account one symbol (main loop)
+void stats_decode(dcf77_decode_result res); // account minute block decoding (main loop)
+const stats_minute *stats_get_minute(void); // last minute summary
+int stats_report(int line, char *s, int len); // format one report line (returns -1 after last line)
+
+#endif
@@ -15,6 +15,13 @@
 #include <msp430g2553.h>
 
 #include "uart.h"
+#include "power.h"
+#include "duty.h"
+#include "event.h"
+#include "rtc.h"
+
+// uart clock source (1 .. ACLK 32kHz, runs in LPM3 too; 0 .. SMCLK, keeps DCO on while transmitting)
+#define UART_ACLK 1
 
 // uart TX led
 #define UART_TX_LED 0
@@ -31,15 +38,36 @@
 #endif
 #undef UART_TX_LED
 
+// rs485 driver enable (P1.6 instead of green led, active high)
+#if UART_BUS
+	#define UART_DE_INIT() {P1DIR|=BIT6;P1OUT&=~BIT6;}
+	#define UART_DE_ON() {P1OUT|=BIT6;}
+	#define UART_DE_OFF() {P1OUT&=~BIT6;}
+#else
+	#define UART_DE_INIT()
+	#define UART_DE_ON()
+	#define UART_DE_OFF()
+#endif
+
 // uart buffer length (mask preferred)
 #define UART_TX_BUFLEN 16
 #define UART_TX_BUFMASK 0x0F
 
 // uart circular buffer
 char uart_tx_buffer[UART_TX_BUFLEN]={'\0'};
-unsigned int uart_tx_inptr=0, uart_tx_outptr=0;
+uint8_t uart_tx_inptr=0, uart_tx_outptr=0;
 // uart transmit flag (0 not transmitting, 1 transmitting)
 bool uart_tx_transmitt = false;
+// last character moved to shift register (driver released when it's out)
+volatile bool uart_tx_done = false;
+// uart receive line buffer (command line, terminated by CR or LF), the longest line is
+// the bus schedule command "@aaSmmmmssaa" (12 chars), longer lines are dropped
+#define UART_RX_BUFLEN 16
+char uart_rx_buffer[UART_RX_BUFLEN+1]; // line and terminating zero (processed in place)
+uint8_t uart_rx_ptr = 0;
+volatile bool uart_rx_ready = false; // line received (buffer locked until read)
+bool uart_rx_drop = false; // chars lost (overrun, buffer locked) or line too long, rest of the line is dropped
+uint16_t uart_rx_mark = 0; // rtc time stamp at the line first char (time link)
 
 // local function definition
 int uart_start_tx(void);
@@ -64,29 +92,35 @@ int8_t c2h(char c)
 // RS485 like data direction controll
 void tx_output_enable(bool enable)
 {
-    /*if (enable)
+    if (enable)
     {
-        P1SEL |= BIT2;
-        P1SEL2 |= BIT2;
+        UART_DE_ON();
     }
     else
     {
-        P1SEL &= ~BIT2;
-        P1SEL2 &= ~BIT2;
-    }*/
+        UART_DE_OFF();
+    }
 }
 
 // uart initialization
 void uart_init(void)
 {
 	UART_TX_LED_INIT();
+	UART_DE_INIT();
 
 	P1SEL = BIT1 + BIT2 ;   // P1.1 = RXD, P1.2=TXD
 	P1SEL2 = BIT1 + BIT2 ;  // P1.1 = RXD, P1.2=TXD
+#if UART_ACLK
+	UCA0CTL1 |= UCSSEL_1;   // ACLK
+	UCA0BR0 = 3;            // 32kHz 9600
+	UCA0BR1 = 0;            // 32kHz 9600
+	UCA0MCTL = UCBRS_3;     // Modulation UCBRSx = 3
+#else
 	UCA0CTL1 |= UCSSEL_2;   // SMCLK
 	UCA0BR0 = 104;        // 1MHz 9600
 	UCA0BR1 = 0;            // 1MHz 9600*/
 	UCA0MCTL = UCBRS0;      // Modulation UCBRSx = 1
+#endif
 	UCA0CTL1 &= ~UCSWRST;   // **Initialize USCI state machine**
 	IE2 |= UCA0RXIE;        // Enable USCI_A0 RX interrupt
 }
@@ -100,6 +134,11 @@ int uart_start_tx(void)
 		return -1; // don't start when buffer empty
 	}
 	UART_TX_LED_ON(); // LED ON
+	uart_tx_done = false;
+	tx_output_enable(true); // take the bus
+#if !UART_ACLK
+	power_hold(POWER_HOLD_UART); // keep SMCLK while transmitting
+#endif
 	//while (!(IFG2&UCA0TXIFG));	// USCI_A0 TX buffer ready?
 #ifdef UART_TX_BUFMASK
 	unsigned int new_ptr = (uart_tx_outptr+1)&UART_TX_BUFMASK;
@@ -113,19 +152,26 @@ int uart_start_tx(void)
 	return 0; // return ok
 }
 
-// uart put char function
+// uart put char function (main loop and isr, timecode is sent from rtc timer isr)
 int uart_putc(char c)
 {
+	int ret = 0;
+	unsigned int istate = __get_interrupt_state();
+	__disable_interrupt();
 #ifdef UART_TX_BUFMASK
 	unsigned int new_ptr = (uart_tx_inptr+1)&UART_TX_BUFMASK;
 #else
 	int new_ptr = (uart_tx_inptr+1)%UART_TX_BUFLEN;
 #endif
-	if (new_ptr==uart_tx_outptr) return -1; // buffer full
-	uart_tx_buffer[new_ptr] = c;
-	uart_tx_inptr=new_ptr;
-	if (!uart_tx_transmitt) return uart_start_tx(); // return ok (if buffer not empty)
-	return 0; // return ok
+	if (new_ptr==uart_tx_outptr) ret = -1; // buffer full
+	else
+	{
+		uart_tx_buffer[new_ptr] = c;
+		uart_tx_inptr=new_ptr;
+		if (!uart_tx_transmitt) ret = uart_start_tx(); // return ok (if buffer not empty)
+	}
+	__set_interrupt_state(istate);
+	return ret; // return ok
 }
 
 // uart put string function
@@ -138,28 +184,105 @@ int uart_puts(char *s)
 	return ptr;
 }
 
+// free space in tx buffer
+int uart_tx_space(void)
+{
+	return (uart_tx_outptr-uart_tx_inptr-1)&UART_TX_BUFMASK;
+}
+
+// get received command line (zero terminated in the receive buffer, 0 if none), the buffer
+// is locked (next line chars are dropped) until uart_release_line, no copy on the stack
+char *uart_get_line(int *len)
+{
+	if (!uart_rx_ready) return 0;
+	uart_rx_buffer[uart_rx_ptr] = '\0';
+	*len = uart_rx_ptr;
+	return uart_rx_buffer;
+}
+
+// line processed, receive the next one
+void uart_release_line(void)
+{
+	uart_rx_ptr = 0;
+	uart_rx_ready = false; // unlock buffer
+}
+
+// rtc time stamp when the first char of the line being processed came
+uint16_t uart_get_line_mark(void)
+{
+	return uart_rx_mark;
+}
+
+// transmitter idle (buffer empty, shift register empty)
+bool uart_tx_idle(void)
+{
+	return (!uart_tx_transmitt)&&(uart_tx_inptr==uart_tx_outptr)&&(!(UCA0STAT&UCBUSY));
+}
+
+// release bus driver when the last character is shifted out (usci has no tx complete interrupt, polled by rtc tick)
+void uart_tick(void)
+{
+    if (uart_tx_done && !(UCA0STAT&UCBUSY))
+    {
+        uart_tx_done = false;
+        tx_output_enable(false);
+    }
+}
+
 // interrupt handlers
 
 // uart RX interrupt handler
 #pragma vector=USCIAB0RX_VECTOR
 __interrupt void USCI0RX_ISR(void)
 {
-    tx_output_enable(true);
+    DUTY_BEGIN(duty);
 	//UART_TX_LED_ON();
-	char c = UCA0RXBUF;		// read char
-    if (c=='?')
+	if (UCA0STAT&UCOE) uart_rx_drop = true; // a char lost (cpu held by flash), line is broken
+	char c = UCA0RXBUF;		// read char (clears UCOE)
+    if ((c=='?')&&(!UART_BUS)) // bus units answer addressed commands only
     {
         uart_puts("Hello World!\n");
 	}
+	else if ((c=='\r')||(c=='\n'))
+	{
+	    if (uart_rx_drop)
+	    {
+	        uart_rx_drop = false;
+	        if (!uart_rx_ready) uart_rx_ptr = 0;
+	    }
+	    else if ((uart_rx_ptr>0)&&(!uart_rx_ready))
+	    {
+	        uart_rx_ready = true; // processed in main loop
+	        event_post(EVENT_UART);
+	        POWER_WAKEUP();
+	    }
+	}
+	else if (uart_rx_ready) uart_rx_drop = true; // buffer locked, the rest of this line is lost
+	else if (!uart_rx_drop)
+	{
+	    if (uart_rx_ptr>=UART_RX_BUFLEN) uart_rx_drop = true; // too long (not truncated)
+	    else
+	    {
+	        if (uart_rx_ptr==0) uart_rx_mark = rtc_get_stamp();
+	        uart_rx_buffer[uart_rx_ptr++] = c;
+	    }
+	}
+    DUTY_END(DUTY_UART_RX,duty);
 }
 
 // uart TX interrupt handler
 #pragma vector=USCIAB0TX_VECTOR
 __interrupt void USCI0TX_ISR(void)
 {
+    DUTY_BEGIN(duty);
     if (uart_start_tx()!=0)
     {
         UART_TX_LED_OFF();
         IE2 &= ~UCA0TXIE;		// Disable USCI_A0 TX interrupt
+        uart_tx_done = true; // driver released by uart_tick
+#if !UART_ACLK
+        power_release(POWER_HOLD_UART); // SMCLK not needed anymore
+#endif
     }
+    DUTY_END(DUTY_UART_TX,duty);
 }
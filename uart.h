@@ -9,6 +9,12 @@
  *  	uart_init .. initialization
  *  	uart_putc .. put char function
  *  	uart_puts .. put string function
+ *  	uart_tx_space .. free space in transmit buffer
+ *  	uart_get_line .. received command line (in place, locked until uart_release_line)
+ *  	uart_release_line .. line processed, receive the next one
+ *  	uart_tick .. driver enable release (rs485 bus)
+ *  	uart_tx_idle .. nothing is being transmitted
+ *  	uart_get_line_mark .. rtc time stamp of the received line start
  */
 
 #ifndef UART_H_
@@ -17,6 +23,11 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+// rs485 multi drop bus (1 .. addressed commands, driver enable on P1.6; 0 .. point to point, time streamed)
+#ifndef UART_BUS
+#define UART_BUS 0
+#endif
+
 char h2c(unsigned int h); // hex to char
 int8_t c2h(char c); // char to hex
 
@@ -24,5 +35,11 @@ int8_t c2h(char c); // char to hex
 void uart_init(void); // initialization
 int uart_putc(char c); // put char function
 int uart_puts(char *s); // put string function
+int uart_tx_space(void); // free space in tx buffer
+char *uart_get_line(int *len); // received command line (0 if none, locked until released)
+void uart_release_line(void); // unlock line buffer (receive the next line)
+void uart_tick(void); // called from rtc timer interrupt
+bool uart_tx_idle(void); // transmitter idle (next char starts immediately)
+uint16_t uart_get_line_mark(void); // rtc time stamp when the first char of the last line came
 
 #endif /* UART_H_ */